@@ -0,0 +1,64 @@
+/*
+** Memory resources for node based containers: slow paths.
+*/
+
+#include "allocator.hh"
+
+
+
+namespace ADT {
+
+    pool_resource::pool_resource(size_t slab_size)
+        : m_slab_size{slab_size < sizeof(Slab) + MAX_POOLED ? sizeof(Slab) + MAX_POOLED : slab_size} {}
+
+    void pool_resource::new_slab() {
+        // The tail of the old slab, smaller than the block needed, is given up.
+        Slab* s = static_cast<Slab*>(::operator new(m_slab_size));
+        s -> next = m_slabs;
+        m_slabs = s;
+        ++m_slab_count;
+        m_cur = reinterpret_cast<char*>(s) + sizeof(Slab);
+        m_end = reinterpret_cast<char*>(s) + m_slab_size;
+    }
+
+    void pool_resource::release() {
+        while (m_slabs) {
+            Slab* next = m_slabs -> next;
+            ::operator delete(m_slabs);
+            m_slabs = next;
+        }
+        for (auto& f : m_free)
+            f = nullptr;
+        m_cur = m_end = nullptr;
+        m_slab_count = 0;
+    }
+
+
+    monotonic_arena::monotonic_arena(size_t block_size)
+        : m_block_size{block_size < 2 * sizeof(Block) ? 2 * sizeof(Block) : block_size} {}
+
+    void* monotonic_arena::allocate_slow(size_t bytes, size_t align) {
+        // New block, big enough for an oversized request.
+        size_t need = sizeof(Block) + bytes + align;
+        size_t size = need > m_block_size ? need : m_block_size;
+        Block* b = static_cast<Block*>(::operator new(size));
+        b -> next = m_blocks;
+        m_blocks = b;
+        ++m_block_count;
+        m_cur = reinterpret_cast<char*>(b) + sizeof(Block);
+        m_end = reinterpret_cast<char*>(b) + size;
+        return allocate(bytes, align);
+    }
+
+    void monotonic_arena::release() {
+        while (m_blocks) {
+            Block* next = m_blocks -> next;
+            ::operator delete(m_blocks);
+            m_blocks = next;
+        }
+        m_cur = m_end = nullptr;
+        m_block_count = 0;
+    }
+
+
+}
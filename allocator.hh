@@ -0,0 +1,262 @@
+/*
+** Memory resources and allocators for node based containers.
+**
+** pool_resource: size-class free lists over large slabs. Allocating or freeing a
+**     node is a pointer pop or push, with no lock and no call into malloc.
+** monotonic_arena: bump allocation, deallocate() is a no-op. All memory is
+**     returned at once by release().
+**
+** resource_allocator<T, Resource> adapts a resource to the std::allocator interface,
+** so ADT::unordered_map, the lists and the trees can allocate from it:
+**     ADT::pool_resource pool;
+**     ADT::LinkedList<int, ADT::pool_allocator<int>> ll {ADT::pool_allocator<int>(pool)};
+** Resources are not thread-safe; give each thread its own. A resource must outlive
+** every container allocating from it.
+**
+** counting_allocator<T, Alloc> forwards to Alloc and counts allocations and
+** bytes into an allocation_stats, for the containers without counters of
+** their own:
+**     ADT::allocation_stats st;
+**     AVLTree<int, ADT::counting_allocator<int>> t {ADT::counting_allocator<int>(st)};
+**     st.dump(std::cout);
+*/
+
+
+#ifndef __ALLOCATOR_H_
+#define __ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <type_traits>
+
+
+namespace ADT {
+
+    class pool_resource {
+        public:
+            static constexpr size_t GRANULE = 16;  // size class step and block alignment
+            static constexpr size_t MAX_POOLED = 512;  // larger blocks go to operator new
+            static constexpr size_t DEFAULT_SLAB_SIZE = 64 * 1024;
+
+            explicit pool_resource(size_t slab_size = DEFAULT_SLAB_SIZE);
+            pool_resource(const pool_resource&) = delete;
+            pool_resource& operator=(const pool_resource&) = delete;
+            ~pool_resource() { release(); }
+
+            void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+                if (align > GRANULE)
+                    return ::operator new(bytes, std::align_val_t(align));
+                if (bytes > MAX_POOLED)
+                    return ::operator new(bytes);
+                size_t c = size_class(bytes);
+                if (FreeBlock* b = m_free[c]) {
+                    m_free[c] = b -> next;
+                    return b;
+                }
+                size_t n = (c + 1) * GRANULE;
+                if (size_t(m_end - m_cur) < n)
+                    new_slab();
+                void* p = m_cur;
+                m_cur += n;
+                return p;
+            }
+
+            void deallocate(void* p, size_t bytes, size_t align = alignof(std::max_align_t)) {
+                if (align > GRANULE) {
+                    ::operator delete(p, std::align_val_t(align));
+                    return;
+                }
+                if (bytes > MAX_POOLED) {
+                    ::operator delete(p);
+                    return;
+                }
+                FreeBlock* b = static_cast<FreeBlock*>(p);
+                size_t c = size_class(bytes);
+                b -> next = m_free[c];
+                m_free[c] = b;
+            }
+
+            // Free all slabs. Every block from this pool becomes invalid.
+            void release();
+
+            size_t slab_count() const noexcept { return m_slab_count; }
+
+        private:
+            struct FreeBlock { FreeBlock* next; };
+            struct alignas(GRANULE) Slab { Slab* next; };
+            static constexpr size_t NUM_CLASSES = MAX_POOLED / GRANULE;
+            static size_t size_class(size_t bytes) { return bytes == 0 ? 0 : (bytes - 1) / GRANULE; }
+
+            void new_slab();
+
+            FreeBlock* m_free[NUM_CLASSES] = {};
+            char* m_cur = nullptr;  // bump region of the newest slab
+            char* m_end = nullptr;
+            Slab* m_slabs = nullptr;
+            size_t m_slab_size;
+            size_t m_slab_count = 0;
+    };
+
+
+    class monotonic_arena {
+        public:
+            static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+            explicit monotonic_arena(size_t block_size = DEFAULT_BLOCK_SIZE);
+            monotonic_arena(const monotonic_arena&) = delete;
+            monotonic_arena& operator=(const monotonic_arena&) = delete;
+            ~monotonic_arena() { release(); }
+
+            void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+                std::uintptr_t p = (reinterpret_cast<std::uintptr_t>(m_cur) + align - 1) & ~(align - 1);
+                if (m_cur == nullptr || p + bytes > reinterpret_cast<std::uintptr_t>(m_end))
+                    return allocate_slow(bytes, align);
+                m_cur = reinterpret_cast<char*>(p + bytes);
+                return reinterpret_cast<void*>(p);
+            }
+
+            void deallocate(void*, size_t, size_t = alignof(std::max_align_t)) {}
+
+            // Free all blocks at once.
+            void release();
+
+            size_t block_count() const noexcept { return m_block_count; }
+
+        private:
+            struct alignas(std::max_align_t) Block { Block* next; };
+
+            void* allocate_slow(size_t bytes, size_t align);
+
+            char* m_cur = nullptr;
+            char* m_end = nullptr;
+            Block* m_blocks = nullptr;
+            size_t m_block_size;
+            size_t m_block_count = 0;
+    };
+
+
+    template <typename T, typename Resource>
+    class resource_allocator {
+        /*
+        ** std::allocator compatible handle to a memory resource.
+        ** Copies and rebound copies share the resource and compare equal.
+         */
+        public:
+            using value_type = T;
+            template <typename U> struct rebind { using other = resource_allocator<U, Resource>; };
+
+            explicit resource_allocator(Resource& res) noexcept : m_res{&res} {}
+            template <typename U>
+            resource_allocator(const resource_allocator<U, Resource>& a) noexcept : m_res{a.resource()} {}
+
+            T* allocate(size_t n) {
+                return static_cast<T*>(m_res -> allocate(n * sizeof(T), alignof(T)));
+            }
+            void deallocate(T* p, size_t n) noexcept {
+                m_res -> deallocate(p, n * sizeof(T), alignof(T));
+            }
+
+            Resource* resource() const noexcept { return m_res; }
+
+        private:
+            Resource* m_res;
+    };
+
+    template <typename T, typename U, typename R>
+    bool operator==(const resource_allocator<T, R>& a, const resource_allocator<U, R>& b) {
+        return a.resource() == b.resource();
+    }
+
+    template <typename T, typename U, typename R>
+    bool operator!=(const resource_allocator<T, R>& a, const resource_allocator<U, R>& b) {
+        return !(a == b);
+    }
+
+    template <typename T> using pool_allocator = resource_allocator<T, pool_resource>;
+    template <typename T> using arena_allocator = resource_allocator<T, monotonic_arena>;
+
+
+    // Allocators whose deallocate() is a no-op. Containers can drop trivially
+    // destructible nodes without visiting them; the memory comes back with
+    // monotonic_arena::release().
+    template <typename Alloc> struct is_monotonic_allocator : std::false_type {};
+    template <typename T>
+    struct is_monotonic_allocator<resource_allocator<T, monotonic_arena>> : std::true_type {};
+
+
+
+    struct allocation_stats {
+        size_t allocations = 0;
+        size_t deallocations = 0;
+        size_t bytes = 0;        // currently allocated
+        size_t peak_bytes = 0;
+        size_t total_bytes = 0;  // ever allocated
+
+        void dump(std::ostream& os) const {
+            os << "allocations " << allocations << ", deallocations " << deallocations
+               << ", bytes " << bytes << ", peak " << peak_bytes << ", total " << total_bytes << '\n';
+        }
+    };
+
+    template <typename T, typename Alloc = std::allocator<T>>
+    class counting_allocator {
+        /*
+        ** Copies and rebound copies share the stats, and compare equal if
+        ** their upstream allocators do. Not thread-safe, like the resources.
+        ** Never monotonic, even over an arena, so that containers hand back
+        ** every node and the stats return to zero.
+         */
+        using traits = std::allocator_traits<Alloc>;
+
+        public:
+            using value_type = T;
+            template <typename U> struct rebind {
+                using other = counting_allocator<U, typename traits::template rebind_alloc<U>>;
+            };
+
+            explicit counting_allocator(allocation_stats& stats, const Alloc& upstream = Alloc()) noexcept
+                : m_stats{&stats}, m_upstream{upstream} {}
+            template <typename U, typename A>
+            counting_allocator(const counting_allocator<U, A>& a) noexcept
+                : m_stats{a.stats()}, m_upstream{a.upstream()} {}
+
+            T* allocate(size_t n) {
+                T* p = traits::allocate(m_upstream, n);
+                ++m_stats -> allocations;
+                m_stats -> bytes += n * sizeof(T);
+                m_stats -> total_bytes += n * sizeof(T);
+                if (m_stats -> bytes > m_stats -> peak_bytes)
+                    m_stats -> peak_bytes = m_stats -> bytes;
+                return p;
+            }
+            void deallocate(T* p, size_t n) noexcept {
+                traits::deallocate(m_upstream, p, n);
+                ++m_stats -> deallocations;
+                m_stats -> bytes -= n * sizeof(T);
+            }
+
+            allocation_stats* stats() const noexcept { return m_stats; }
+            const Alloc& upstream() const noexcept { return m_upstream; }
+
+        private:
+            allocation_stats* m_stats;
+            Alloc m_upstream;
+    };
+
+    template <typename T, typename A, typename U, typename B>
+    bool operator==(const counting_allocator<T, A>& a, const counting_allocator<U, B>& b) {
+        return a.stats() == b.stats() && a.upstream() == b.upstream();
+    }
+
+    template <typename T, typename A, typename U, typename B>
+    bool operator!=(const counting_allocator<T, A>& a, const counting_allocator<U, B>& b) {
+        return !(a == b);
+    }
+
+}  // end of namespace ADT
+
+
+#endif // __ALLOCATOR_H_
@@ -0,0 +1,96 @@
+/*
+** The parts of the benchmark harness shared by adt_bench and adt_gbench.
+*/
+
+#include "bench.hh"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <unordered_set>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+namespace BENCH {
+
+    allocation_counter& allocations() {
+        static allocation_counter counter;
+        return counter;
+    }
+
+    std::vector<std::uint64_t> random_keys(size_t n, std::uint64_t seed) {
+        std::mt19937_64 g(seed);
+        std::vector<std::uint64_t> keys;
+        keys.reserve(n);
+        std::unordered_set<std::uint64_t> seen;
+        seen.reserve(n);
+        while (keys.size() < n) {
+            std::uint64_t k = g();
+            if (seen.insert(k).second)
+                keys.push_back(k);
+        }
+        return keys;
+    }
+
+    void state::report(const result& r) {
+        std::printf("%-28s %-30s %10zu %12.2f ns/op %8.3f allocs/op", r.name.c_str(), r.impl.c_str(), r.n,
+                    r.ns_per_op, r.allocs_per_op);
+        if (r.cache_misses_per_op >= 0)
+            std::printf(" %8.3f misses/op", r.cache_misses_per_op);
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+
+    namespace detail {
+
+        std::uint64_t now_ns() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+#if defined(__linux__)
+        cache_miss_counter::cache_miss_counter() {
+            perf_event_attr pe{};
+            pe.type = PERF_TYPE_HARDWARE;
+            pe.size = sizeof(pe);
+            pe.config = PERF_COUNT_HW_CACHE_MISSES;
+            pe.disabled = 1;
+            pe.exclude_kernel = 1;
+            pe.exclude_hv = 1;
+            m_fd = int(::syscall(SYS_perf_event_open, &pe, 0, -1, -1, 0));
+        }
+
+        cache_miss_counter::~cache_miss_counter() {
+            if (m_fd >= 0)
+                ::close(m_fd);
+        }
+
+        void cache_miss_counter::start() {
+            if (m_fd >= 0) {
+                ::ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+                ::ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+
+        void cache_miss_counter::stop() {
+            if (m_fd < 0)
+                return;
+            ::ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+            std::int64_t count = 0;
+            if (::read(m_fd, &count, sizeof(count)) == sizeof(count))
+                m_total += count;
+        }
+#else
+        cache_miss_counter::cache_miss_counter() {}
+        cache_miss_counter::~cache_miss_counter() {}
+        void cache_miss_counter::start() {}
+        void cache_miss_counter::stop() {}
+#endif
+
+    }  // end of namespace detail
+
+}  // end of namespace BENCH
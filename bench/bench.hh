@@ -0,0 +1,173 @@
+/*
+** Benchmark harness of adt_bench.
+**
+** BENCH_CASE(group, name, sizes...) { ... } registers a benchmark, run once
+** per size with st.n set to it. The body prepares its input, then times
+** each implementation with st.measure, the ADT one and its std:: counterpart
+** side by side:
+**
+**     st.measure("std::vector", st.n, [&] { ... st.n operations ... });
+**     st.measure("ADT::vector", st.n, setup, run);  // setup() is not timed
+**
+** measure repeats setup() and run() until --min-time has passed, and reports
+** the time, heap allocations and last level cache misses per operation.
+** Allocations are counted in one more run, so counting costs no time, and
+** cache misses are null where perf_event_open is not allowed.
+*/
+
+#ifndef __BENCH_H_
+#define __BENCH_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace BENCH {
+
+    class state;
+
+    struct bench_case {
+        std::string name;  // group/name
+        std::vector<size_t> sizes;
+        void (*run)(state&);
+    };
+
+    inline std::vector<bench_case>& registry() {
+        static std::vector<bench_case> cases;
+        return cases;
+    }
+
+    struct registrar {
+        registrar(const char* group, const char* name, std::vector<size_t> sizes, void (*run)(state&)) {
+            registry().push_back({std::string(group) + "/" + name, std::move(sizes), run});
+        }
+    };
+
+    struct result {
+        std::string name;
+        std::string impl;
+        size_t n;
+        size_t iterations;
+        double ns_per_op;
+        double allocs_per_op;
+        double bytes_per_op;
+        double cache_misses_per_op;  // negative if not counted
+    };
+
+    // Heap allocations, counted by the operator new of adt_bench while
+    // counting is set.
+    struct allocation_counter {
+        std::atomic<bool> counting{false};
+        std::atomic<size_t> allocs{0};
+        std::atomic<size_t> bytes{0};
+    };
+    allocation_counter& allocations();
+
+    // Keep the compiler from optimizing x, or the memory it may point to,
+    // away.
+    template <typename T>
+    inline void do_not_optimize(const T& x) { asm volatile("" : : "r,m"(x) : "memory"); }
+
+    namespace detail {
+
+        // Monotonic nanoseconds.
+        std::uint64_t now_ns();
+
+        // Last level cache misses of this thread, -1 when unavailable.
+        class cache_miss_counter {
+            public:
+                cache_miss_counter();
+                ~cache_miss_counter();
+                cache_miss_counter(const cache_miss_counter&) = delete;
+                cache_miss_counter& operator=(const cache_miss_counter&) = delete;
+                bool available() const { return m_fd >= 0; }
+                void start();
+                void stop();
+                std::int64_t total() const { return m_total; }
+            private:
+                int m_fd = -1;
+                std::int64_t m_total = 0;
+        };
+
+    }
+
+    class state {
+        public:
+            // An adapter runs each measure itself, e.g. in a Google Benchmark
+            // loop, in place of the timing of adt_bench.
+            using adapter_fn = std::function<void(const char* impl, size_t ops,
+                                                  const std::function<void()>& setup,
+                                                  const std::function<void()>& run)>;
+
+            state(std::string name, size_t n, double min_time, std::vector<result>* results,
+                  adapter_fn adapter = nullptr)
+                : n{n}, m_name{std::move(name)}, m_min_time{min_time}, m_results{results},
+                  m_adapter{std::move(adapter)} {}
+
+            const size_t n;
+
+            template <typename Run>
+            void measure(const char* impl, size_t ops, Run run) {
+                measure(impl, ops, [] {}, run);
+            }
+
+            template <typename Setup, typename Run>
+            void measure(const char* impl, size_t ops, Setup setup, Run run) {
+                if (m_adapter) {
+                    m_adapter(impl, ops, setup, run);
+                    return;
+                }
+                setup();  // warm up
+                run();
+                detail::cache_miss_counter misses;
+                std::uint64_t elapsed = 0, limit = std::uint64_t(m_min_time * 1e9);
+                size_t iterations = 0;
+                do {
+                    setup();
+                    misses.start();
+                    std::uint64_t t0 = detail::now_ns();
+                    run();
+                    elapsed += detail::now_ns() - t0;
+                    misses.stop();
+                    ++iterations;
+                } while (elapsed < limit);
+
+                setup();
+                auto& a = allocations();
+                size_t allocs = a.allocs, bytes = a.bytes;
+                a.counting = true;
+                run();
+                a.counting = false;
+                allocs = a.allocs - allocs;
+                bytes = a.bytes - bytes;
+
+                double total_ops = double(iterations) * (ops ? ops : 1);
+                m_results -> push_back({m_name, impl, n, iterations, elapsed / total_ops,
+                                        allocs / double(ops ? ops : 1), bytes / double(ops ? ops : 1),
+                                        misses.available() ? misses.total() / total_ops : -1.0});
+                report(m_results -> back());
+            }
+
+        private:
+            static void report(const result& r);
+
+            std::string m_name;
+            double m_min_time;
+            std::vector<result>* m_results;
+            adapter_fn m_adapter;
+    };
+
+    // Random 64-bit keys, distinct, from a fixed seed.
+    std::vector<std::uint64_t> random_keys(size_t n, std::uint64_t seed = 1);
+
+}  // end of namespace BENCH
+
+#define BENCH_CASE(group, name, ...)                                         \
+    static void group##_##name(::BENCH::state&);                             \
+    static ::BENCH::registrar group##_##name##_registrar(#group, #name, {__VA_ARGS__}, &group##_##name); \
+    static void group##_##name(::BENCH::state& st)
+
+#endif // __BENCH_H_
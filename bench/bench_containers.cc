@@ -0,0 +1,201 @@
+/*
+** ADT::vector against std::vector, the stacks and queues against
+** std::stack and std::queue, and the search trees against std::set.
+*/
+
+#include "bench.hh"
+#include "vector.hh"
+#include "stack.hh"
+#include "queue.hh"
+#include "trees.hh"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <random>
+#include <set>
+#include <stack>
+#include <string>
+#include <vector>
+
+#define CONTAINER_SIZES 1000, 10000, 100000, 1000000
+
+
+namespace {
+
+    template <typename T> struct type_tag { using type = T; };
+
+    // A string too long for the small string buffer of std::string.
+    std::string value_string(size_t i) { return "value number " + std::to_string(i) + " of the benchmark"; }
+
+}
+
+
+BENCH_CASE(vector, push_back_int, CONTAINER_SIZES) {
+    auto run = [&](auto tag, const char* impl) {
+        using Vec = typename decltype(tag)::type;
+        std::unique_ptr<Vec> v;
+        st.measure(impl, st.n, [&] { v = std::make_unique<Vec>(); },
+                   [&] {
+                       for (size_t i = 0; i < st.n; ++i)
+                           v -> push_back(int(i));
+                       BENCH::do_not_optimize(v -> back());
+                   });
+    };
+    run(type_tag<std::vector<int>>(), "std::vector");
+    run(type_tag<ADT::vector<int>>(), "ADT::vector");
+}
+
+BENCH_CASE(vector, push_back_string, CONTAINER_SIZES) {
+    std::vector<std::string> values;
+    for (size_t i = 0; i < st.n; ++i)
+        values.push_back(value_string(i));
+    auto run = [&](auto tag, const char* impl) {
+        using Vec = typename decltype(tag)::type;
+        std::unique_ptr<Vec> v;
+        st.measure(impl, st.n, [&] { v = std::make_unique<Vec>(); },
+                   [&] {
+                       for (const auto& s : values)
+                           v -> push_back(s);
+                   });
+    };
+    run(type_tag<std::vector<std::string>>(), "std::vector");
+    run(type_tag<ADT::vector<std::string>>(), "ADT::vector");
+}
+
+BENCH_CASE(vector, insert_middle, 1000, 10000, 100000) {
+    auto run = [&](auto tag, const char* impl) {
+        using Vec = typename decltype(tag)::type;
+        std::unique_ptr<Vec> v;
+        st.measure(impl, st.n, [&] { v = std::make_unique<Vec>(); },
+                   [&] {
+                       for (size_t i = 0; i < st.n; ++i)
+                           v -> insert(v -> begin() + v -> size() / 2, int(i));
+                   });
+    };
+    run(type_tag<std::vector<int>>(), "std::vector");
+    run(type_tag<ADT::vector<int>>(), "ADT::vector");
+}
+
+BENCH_CASE(stack, push_pop, CONTAINER_SIZES) {
+    // n pushes, then n pops.
+    {
+        std::unique_ptr<std::stack<int>> s;
+        st.measure("std::stack", 2 * st.n, [&] { s = std::make_unique<std::stack<int>>(); },
+                   [&] {
+                       for (size_t i = 0; i < st.n; ++i)
+                           s -> push(int(i));
+                       for (size_t i = 0; i < st.n; ++i)
+                           s -> pop();
+                   });
+    }
+    {
+        std::unique_ptr<ADT::ArrayStack<int>> s;
+        st.measure("ADT::ArrayStack", 2 * st.n, [&] { s = std::make_unique<ADT::ArrayStack<int>>(); },
+                   [&] {
+                       for (size_t i = 0; i < st.n; ++i)
+                           s -> push(int(i));
+                       int sum = 0;
+                       for (size_t i = 0; i < st.n; ++i)
+                           sum += s -> pop();
+                       BENCH::do_not_optimize(sum);
+                   });
+    }
+    {
+        std::unique_ptr<ADT::LinkedStack<int>> s;
+        st.measure("ADT::LinkedStack", 2 * st.n, [&] { s = std::make_unique<ADT::LinkedStack<int>>(); },
+                   [&] {
+                       for (size_t i = 0; i < st.n; ++i)
+                           s -> push(int(i));
+                       for (size_t i = 0; i < st.n; ++i)
+                           s -> pop();
+                   });
+    }
+}
+
+BENCH_CASE(queue, enqueue_dequeue, CONTAINER_SIZES) {
+    // n enqueues, then n dequeues.
+    {
+        std::unique_ptr<std::queue<int>> q;
+        st.measure("std::queue", 2 * st.n, [&] { q = std::make_unique<std::queue<int>>(); },
+                   [&] {
+                       for (size_t i = 0; i < st.n; ++i)
+                           q -> push(int(i));
+                       for (size_t i = 0; i < st.n; ++i)
+                           q -> pop();
+                   });
+    }
+    {
+        std::unique_ptr<ADT::LinkedQueue<int>> q;
+        st.measure("ADT::LinkedQueue", 2 * st.n, [&] { q = std::make_unique<ADT::LinkedQueue<int>>(); },
+                   [&] {
+                       for (size_t i = 0; i < st.n; ++i)
+                           q -> enqueue(int(i));
+                       for (size_t i = 0; i < st.n; ++i)
+                           q -> dequeue();
+                   });
+    }
+    {
+        std::unique_ptr<ADT::Deque<int>> q;
+        st.measure("ADT::Deque", 2 * st.n, [&] { q = std::make_unique<ADT::Deque<int>>(); },
+                   [&] {
+                       for (size_t i = 0; i < st.n; ++i)
+                           q -> insert_back(int(i));
+                       for (size_t i = 0; i < st.n; ++i)
+                           q -> remove_front();
+                   });
+    }
+}
+
+BENCH_CASE(tree, insert, CONTAINER_SIZES) {
+    std::vector<int> keys(st.n);
+    for (size_t i = 0; i < st.n; ++i)
+        keys[i] = int(i);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(4));
+    auto run = [&](auto tag, const char* impl) {
+        using Tree = typename decltype(tag)::type;
+        std::unique_ptr<Tree> t;
+        st.measure(impl, st.n, [&] { t.reset(); t = std::make_unique<Tree>(); },
+                   [&] {
+                       for (int k : keys)
+                           t -> insert(k);
+                   });
+    };
+    run(type_tag<std::set<int>>(), "std::set");
+    run(type_tag<BinarySearchTree<int>>(), "BinarySearchTree");
+    run(type_tag<AVLTree<int>>(), "AVLTree");
+}
+
+BENCH_CASE(tree, search, CONTAINER_SIZES) {
+    // Every key once, in random order, half of them absent.
+    std::vector<int> keys(st.n), probes(st.n);
+    for (size_t i = 0; i < st.n; ++i) {
+        keys[i] = int(2 * i);
+        probes[i] = int(i);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(5));
+    std::shuffle(probes.begin(), probes.end(), std::mt19937_64(6));
+    {
+        std::set<int> s(keys.begin(), keys.end());
+        st.measure("std::set", st.n, [&] {
+            size_t found = 0;
+            for (int k : probes)
+                found += s.count(k);
+            BENCH::do_not_optimize(found);
+        });
+    }
+    auto run = [&](auto tag, const char* impl) {
+        using Tree = typename decltype(tag)::type;
+        Tree t;
+        for (int k : keys)
+            t.insert(k);
+        st.measure(impl, st.n, [&] {
+            size_t found = 0;
+            for (int k : probes)
+                found += t.search(k);
+            BENCH::do_not_optimize(found);
+        });
+    };
+    run(type_tag<BinarySearchTree<int>>(), "BinarySearchTree");
+    run(type_tag<AVLTree<int>>(), "AVLTree");
+}
@@ -0,0 +1,66 @@
+/*
+** The DP exercises of dp.hh. They have no std:: counterpart; the variants
+** of an exercise are compared with each other.
+*/
+
+#include "bench.hh"
+#include "dp.hh"
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+
+namespace {
+
+    // The words of news.txt, the text of the dp driver.
+    const DP::Document& news() {
+        static const DP::Document doc = [] {
+            std::ifstream in(ADT_SOURCE_DIR "/news.txt");
+            if (!in)
+                throw std::runtime_error("cannot open " ADT_SOURCE_DIR "/news.txt");
+            return DP::read_document(in);
+        }();
+        return doc;
+    }
+
+}
+
+
+BENCH_CASE(dp, fib64, 94) {
+    // fib(0) to fib(93), memoized, bottom-up and by doubling.
+    auto run = [&](const char* impl, std::uint64_t (*f)(unsigned)) {
+        st.measure(impl, st.n, [&] {
+            std::uint64_t sum = 0;
+            for (unsigned i = 0; i < st.n; ++i)
+                sum += f(i);
+            BENCH::do_not_optimize(sum);
+        });
+    };
+    run("DP::fib", DP::fib);
+    run("DP::fib_bottomup", DP::fib_bottomup);
+    run("DP::fib_doubling", DP::fib_doubling);
+}
+
+BENCH_CASE(dp, fib_big, 1000, 10000, 100000, 1000000) {
+    st.measure("DP::fib_big", 1, [&] { BENCH::do_not_optimize(DP::fib_big(unsigned(st.n)).size()); });
+}
+
+BENCH_CASE(dp, justify_words, 16, 40, 80) {
+    // n is the page width; an operation is a word.
+    const DP::Document& doc = news();
+    std::vector<double> dp;
+    std::vector<unsigned> parents;
+    st.measure("DP::justify_words", doc.size(), [&] {
+        BENCH::do_not_optimize(DP::justify_words(doc.prefix, unsigned(st.n), dp, parents));
+    });
+}
+
+BENCH_CASE(dp, blackjack_solve, 1, 8, 64) {
+    // n is the number of decks in the shoe; an operation is a card.
+    std::mt19937_64 rng(7);
+    std::vector<int> deck = DP::blackjack_shoe(unsigned(st.n), rng), best;
+    st.measure("DP::blackjack_solve", deck.size(), [&] {
+        BENCH::do_not_optimize(DP::blackjack_solve(deck, best));
+    });
+}
@@ -0,0 +1,110 @@
+/*
+** unordered_map and flat_hash_map against std::unordered_map, on random
+** 64-bit keys: inserts into an empty map, lookups that hit and miss, erases
+** of every key.
+*/
+
+#include "bench.hh"
+#include "unordered_map.hh"
+#include "flat_hash_map.hh"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#define HASH_MAP_SIZES 1000, 10000, 100000, 1000000, 10000000, 100000000
+
+
+namespace {
+
+    using K = std::uint64_t;
+    using V = std::uint64_t;
+
+    using std_map = std::unordered_map<K, V>;
+    using adt_map = ADT::unordered_map<K, V>;
+    using adt_incremental_map = ADT::unordered_map<K, V, ADT::hasher<K>, ADT::power_of_two_policy,
+                                                   ADT::incremental_rehash<>>;
+    using adt_flat_map = ADT::flat_hash_map<K, V>;
+
+    template <typename T> struct type_tag { using type = T; };
+
+    // Call f(type_tag<Map>(), impl) for every map type.
+    template <typename F>
+    void for_each_map(F f) {
+        f(type_tag<std_map>(), "std::unordered_map");
+        f(type_tag<adt_map>(), "ADT::unordered_map");
+        f(type_tag<adt_incremental_map>(), "ADT::unordered_map incremental");
+        f(type_tag<adt_flat_map>(), "ADT::flat_hash_map");
+    }
+
+    template <typename Map>
+    std::unique_ptr<Map> filled(const std::vector<K>& keys) {
+        auto m = std::make_unique<Map>();
+        for (K k : keys)
+            (*m)[k] = k;
+        return m;
+    }
+
+}
+
+
+BENCH_CASE(hash_map, insert, HASH_MAP_SIZES) {
+    auto keys = BENCH::random_keys(st.n);
+    for_each_map([&](auto tag, const char* impl) {
+        using Map = typename decltype(tag)::type;
+        std::unique_ptr<Map> m;
+        st.measure(impl, st.n, [&] { m.reset(); m = std::make_unique<Map>(); },
+                   [&] {
+                       for (K k : keys)
+                           (*m)[k] = k;
+                   });
+    });
+}
+
+BENCH_CASE(hash_map, find_hit, HASH_MAP_SIZES) {
+    auto keys = BENCH::random_keys(st.n);
+    auto probes = keys;
+    std::shuffle(probes.begin(), probes.end(), std::mt19937_64(2));
+    for_each_map([&](auto tag, const char* impl) {
+        using Map = typename decltype(tag)::type;
+        auto m = filled<Map>(keys);
+        st.measure(impl, st.n, [&] {
+            V sum = 0;
+            for (K k : probes)
+                sum += m -> find(k) -> second;
+            BENCH::do_not_optimize(sum);
+        });
+    });
+}
+
+BENCH_CASE(hash_map, find_miss, HASH_MAP_SIZES) {
+    auto keys = BENCH::random_keys(2 * st.n);
+    std::vector<K> present(keys.begin(), keys.begin() + st.n), absent(keys.begin() + st.n, keys.end());
+    for_each_map([&](auto tag, const char* impl) {
+        using Map = typename decltype(tag)::type;
+        auto m = filled<Map>(present);
+        st.measure(impl, st.n, [&] {
+            size_t found = 0;
+            for (K k : absent)
+                found += m -> find(k) != m -> end();
+            BENCH::do_not_optimize(found);
+        });
+    });
+}
+
+BENCH_CASE(hash_map, erase, HASH_MAP_SIZES) {
+    auto keys = BENCH::random_keys(st.n);
+    auto order = keys;
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(3));
+    for_each_map([&](auto tag, const char* impl) {
+        using Map = typename decltype(tag)::type;
+        std::unique_ptr<Map> m;
+        st.measure(impl, st.n, [&] { m.reset(); m = filled<Map>(keys); },
+                   [&] {
+                       for (K k : order)
+                           m -> erase(k);
+                   });
+    });
+}
@@ -0,0 +1,100 @@
+/*
+** PriorityQueue and IndexedPriorityQueue against std::priority_queue, on
+** random 64-bit keys. push_pop_mix is the hold model of event queues: a
+** queue of n elements pops its top and pushes a new element n times, so
+** the size stays at n. fill_drain pushes n elements, then pops them all.
+*/
+
+#include "bench.hh"
+#include "priority_queue.hh"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#define PQ_SIZES 1000, 10000, 100000, 1000000, 10000000
+
+
+namespace {
+
+    using T = std::uint64_t;
+
+    template <typename PQ> struct type_tag { using type = PQ; };
+
+    // Call f(type_tag<PQ>(), impl) for every queue type.
+    template <typename F>
+    void for_each_queue(F f) {
+        f(type_tag<std::priority_queue<T>>(), "std::priority_queue");
+        f(type_tag<ADT::PriorityQueue<T, std::less<T>, 2>>(), "ADT::PriorityQueue D=2");
+        f(type_tag<ADT::PriorityQueue<T>>(), "ADT::PriorityQueue D=4");
+        f(type_tag<ADT::PriorityQueue<T, std::less<T>, 8>>(), "ADT::PriorityQueue D=8");
+        f(type_tag<ADT::IndexedPriorityQueue<T>>(), "ADT::IndexedPriorityQueue");
+    }
+
+    std::vector<T> random_values(size_t n, std::uint64_t seed) {
+        std::mt19937_64 g(seed);
+        std::vector<T> v(n);
+        for (auto& x : v)
+            x = g();
+        return v;
+    }
+
+    // std::priority_queue::pop returns void.
+    template <typename PQ>
+    T pop(PQ& q) {
+        if constexpr (std::is_void<decltype(q.pop())>::value) {
+            T x = q.top();
+            q.pop();
+            return x;
+        }
+        else
+            return q.pop();
+    }
+
+}
+
+
+BENCH_CASE(priority_queue, push_pop_mix, PQ_SIZES) {
+    // Every new element is the popped one minus a random step of up to
+    // 2^56, as when an event is rescheduled later on a max-queue clock: it
+    // lands among the top n / 256 elements on average.
+    std::vector<T> initial = random_values(st.n, 9), steps = random_values(st.n, 10);
+    for (auto& s : steps)
+        s >>= 8;
+    for_each_queue([&](auto tag, const char* impl) {
+        using PQ = typename decltype(tag)::type;
+        std::unique_ptr<PQ> q;
+        st.measure(impl, st.n,
+                   [&] {
+                       q = std::make_unique<PQ>();
+                       for (T x : initial)
+                           q -> push(x);
+                   },
+                   [&] {
+                       for (T s : steps)
+                           q -> push(pop(*q) - s);
+                       BENCH::do_not_optimize(q -> top());
+                   });
+    });
+}
+
+BENCH_CASE(priority_queue, fill_drain, PQ_SIZES) {
+    // An operation is one push and one pop.
+    std::vector<T> values = random_values(st.n, 11);
+    for_each_queue([&](auto tag, const char* impl) {
+        using PQ = typename decltype(tag)::type;
+        std::unique_ptr<PQ> q;
+        st.measure(impl, st.n, [&] { q = std::make_unique<PQ>(); },
+                   [&] {
+                       for (T x : values)
+                           q -> push(x);
+                       T sum = 0;
+                       while (!q -> empty())
+                           sum += pop(*q);
+                       BENCH::do_not_optimize(sum);
+                   });
+    });
+}
@@ -0,0 +1,59 @@
+/*
+** The sorts of sorting.hh and radix_sort.hh against std::sort and
+** std::stable_sort, on 32-bit keys: uniform, sorted, reversed, and with few
+** unique values. An operation is one element sorted.
+*/
+
+#include "bench.hh"
+#include "sorting.hh"
+#include "radix_sort.hh"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+
+#define SORT_SIZES 1000, 10000, 100000, 1000000, 10000000
+
+
+namespace {
+
+    enum class shape { uniform, sorted, reversed, few_unique };
+
+    std::vector<std::int32_t> make_input(size_t n, shape s) {
+        std::mt19937_64 g(8);
+        std::vector<std::int32_t> v(n);
+        for (auto& x : v)
+            x = s == shape::few_unique ? std::int32_t(g() % 16) : std::int32_t(g());
+        if (s == shape::sorted)
+            std::sort(v.begin(), v.end());
+        else if (s == shape::reversed)
+            std::sort(v.begin(), v.end(), std::greater<>());
+        return v;
+    }
+
+    void run_sorts(BENCH::state& st, shape s) {
+        const std::vector<std::int32_t> input = make_input(st.n, s);
+        std::vector<std::int32_t> v;
+        auto run = [&](const char* impl, auto sort) {
+            st.measure(impl, st.n, [&] { v = input; }, [&] {
+                sort(v.begin(), v.end());
+                BENCH::do_not_optimize(v.data());
+            });
+        };
+        using It = std::vector<std::int32_t>::iterator;
+        run("std::sort", [](It f, It l) { std::sort(f, l); });
+        run("SORT::sort", [](It f, It l) { SORT::sort(f, l); });
+        run("SORT::radix_sort", [](It f, It l) { SORT::radix_sort(f, l); });
+        run("std::stable_sort", [](It f, It l) { std::stable_sort(f, l); });
+        run("SORT::merge_sort", [](It f, It l) { SORT::merge_sort(f, l); });
+        run("SORT::heap_sort", [](It f, It l) { SORT::heap_sort(f, l); });
+    }
+
+}
+
+
+BENCH_CASE(sort, uniform, SORT_SIZES) { run_sorts(st, shape::uniform); }
+BENCH_CASE(sort, sorted, SORT_SIZES) { run_sorts(st, shape::sorted); }
+BENCH_CASE(sort, reversed, SORT_SIZES) { run_sorts(st, shape::reversed); }
+BENCH_CASE(sort, few_unique, SORT_SIZES) { run_sorts(st, shape::few_unique); }
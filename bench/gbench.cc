@@ -0,0 +1,67 @@
+/*
+** Runner of adt_gbench: the cases of adt_bench under Google Benchmark, for
+** its statistics, repetitions and reporters. Every implementation at every
+** size is one benchmark, named group/name/impl/n; the Google Benchmark flags
+** apply, plus --max-size n (default 1000000). Allocations and cache misses
+** are not counted.
+*/
+
+#include "bench.hh"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+int main(int argc, char* argv[]) {
+    size_t max_size = 1000000;
+    std::vector<char*> args;
+    for (int i = 0; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--max-size") && i + 1 < argc)
+            max_size = std::strtoull(argv[++i], nullptr, 10);
+        else
+            args.push_back(argv[i]);
+    }
+
+    for (const auto& c : BENCH::registry()) {
+        // A dry run at the smallest size lists the implementations.
+        std::vector<std::string> impls;
+        BENCH::state list(c.name, c.sizes.front(), 0, nullptr,
+                          [&impls](const char* impl, size_t, const auto&, const auto&) { impls.push_back(impl); });
+        c.run(list);
+        for (size_t n : c.sizes) {
+            if (n > max_size)
+                continue;
+            for (const std::string& impl : impls) {
+                auto run = c.run;
+                std::string label = c.name + "/" + impl + "/" + std::to_string(n);
+                benchmark::RegisterBenchmark(label.c_str(), [run, impl, name = c.name, n](benchmark::State& gs) {
+                    BENCH::state st(name, n, 0, nullptr,
+                                    [&](const char* i, size_t ops, const std::function<void()>& setup,
+                                        const std::function<void()>& body) {
+                        if (impl != i)
+                            return;
+                        for (auto _ : gs) {
+                            gs.PauseTiming();
+                            setup();
+                            gs.ResumeTiming();
+                            body();
+                        }
+                        gs.SetItemsProcessed(gs.iterations() * int64_t(ops));
+                    });
+                    run(st);
+                });
+            }
+        }
+    }
+
+    int gargc = int(args.size());
+    benchmark::Initialize(&gargc, args.data());
+    if (benchmark::ReportUnrecognizedArguments(gargc, args.data()))
+        return 2;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
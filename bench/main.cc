@@ -0,0 +1,122 @@
+/*
+** Runner of adt_bench:
+**
+**     adt_bench [--filter substring] [--max-size n] [--min-time seconds] [--json file]
+**
+** runs the benchmarks whose group/name contains the filter, at every size up
+** to --max-size (default 1000000, the largest sizes need gigabytes), each
+** implementation for at least --min-time seconds (default 0.2). --json
+** writes the results as an array of objects, one per implementation and
+** size.
+*/
+
+#include "bench.hh"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+
+
+// Count the allocations of the measured runs. The array and nothrow forms
+// of libstdc++ call these.
+void* operator new(size_t n) {
+    auto& a = BENCH::allocations();
+    if (a.counting.load(std::memory_order_relaxed)) {
+        a.allocs.fetch_add(1, std::memory_order_relaxed);
+        a.bytes.fetch_add(n, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t n, std::align_val_t align) {
+    auto& a = BENCH::allocations();
+    if (a.counting.load(std::memory_order_relaxed)) {
+        a.allocs.fetch_add(1, std::memory_order_relaxed);
+        a.bytes.fetch_add(n, std::memory_order_relaxed);
+    }
+    size_t al = size_t(align);
+    if (void* p = std::aligned_alloc(al, (n + al - 1) / al * al))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+
+namespace {
+
+    void write_json(const std::string& path, const std::vector<BENCH::result>& results) {
+        std::ofstream out(path);
+        out << "[\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            char buf[512];
+            std::snprintf(buf, sizeof(buf),
+                          "  {\"benchmark\": \"%s\", \"impl\": \"%s\", \"n\": %zu, \"iterations\": %zu, "
+                          "\"ns_per_op\": %.4f, \"allocs_per_op\": %.4f, \"bytes_per_op\": %.4f, ",
+                          r.name.c_str(), r.impl.c_str(), r.n, r.iterations, r.ns_per_op,
+                          r.allocs_per_op, r.bytes_per_op);
+            out << buf;
+            if (r.cache_misses_per_op >= 0) {
+                std::snprintf(buf, sizeof(buf), "\"cache_misses_per_op\": %.4f}", r.cache_misses_per_op);
+                out << buf;
+            }
+            else
+                out << "\"cache_misses_per_op\": null}";
+            out << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "]\n";
+        if (!out)
+            throw std::runtime_error("cannot write " + path);
+    }
+
+    [[noreturn]] void usage(const char* argv0) {
+        std::cerr << "usage: " << argv0
+                  << " [--filter substring] [--max-size n] [--min-time seconds] [--json file]" << std::endl;
+        std::exit(2);
+    }
+
+}
+
+
+int main(int argc, char* argv[]) {
+    std::string filter, json;
+    size_t max_size = 1000000;
+    double min_time = 0.2;
+    for (int i = 1; i < argc; ++i) {
+        auto arg = [&] { return i + 1 < argc ? argv[++i] : (usage(argv[0]), nullptr); };
+        if (!std::strcmp(argv[i], "--filter"))
+            filter = arg();
+        else if (!std::strcmp(argv[i], "--max-size"))
+            max_size = std::strtoull(arg(), nullptr, 10);
+        else if (!std::strcmp(argv[i], "--min-time"))
+            min_time = std::strtod(arg(), nullptr);
+        else if (!std::strcmp(argv[i], "--json"))
+            json = arg();
+        else
+            usage(argv[0]);
+    }
+
+    std::vector<BENCH::result> results;
+    for (const auto& c : BENCH::registry()) {
+        if (c.name.find(filter) == std::string::npos)
+            continue;
+        for (size_t n : c.sizes) {
+            if (n > max_size)
+                continue;
+            BENCH::state st(c.name, n, min_time, &results);
+            c.run(st);
+        }
+    }
+    if (!json.empty())
+        write_json(json, results);
+    return 0;
+}
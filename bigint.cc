@@ -0,0 +1,214 @@
+/*
+** Arbitrary precision unsigned integers.
+*/
+
+#include <algorithm>
+#include <utility>
+#include "bigint.hh"
+
+
+namespace ADT {
+
+    namespace {
+        using limb = BigUnsigned::limb;
+        using wide = std::uint64_t;
+        constexpr int LIMB_BITS = 32;
+
+        // Length of a[0, n) without its leading zero limbs.
+        size_t trimmed(const limb* a, size_t n) {
+            while (n > 0 && a[n - 1] == 0)
+                --n;
+            return n;
+        }
+
+        // r += x << (off limbs), growing r as needed.
+        void add_at(std::vector<limb>& r, size_t off, const limb* x, size_t nx) {
+            if (r.size() < off + nx)
+                r.resize(off + nx, 0);
+            wide carry = 0;
+            size_t k = 0;
+            for (; k < nx; ++k) {
+                wide t = wide(r[off + k]) + x[k] + carry;
+                r[off + k] = limb(t);
+                carry = t >> LIMB_BITS;
+            }
+            for (size_t i = off + k; carry; ++i) {
+                if (i == r.size()) {
+                    r.push_back(limb(carry));
+                    break;
+                }
+                wide t = wide(r[i]) + carry;
+                r[i] = limb(t);
+                carry = t >> LIMB_BITS;
+            }
+        }
+
+        // r -= x << (off limbs), which must not go below zero.
+        void sub_at(std::vector<limb>& r, size_t off, const limb* x, size_t nx) {
+            nx = trimmed(x, nx);
+            wide borrow = 0;
+            size_t k = 0;
+            for (; k < nx; ++k) {
+                wide t = wide(r[off + k]) - x[k] - borrow;
+                r[off + k] = limb(t);
+                borrow = (t >> LIMB_BITS) & 1;
+            }
+            for (size_t i = off + k; borrow; ++i) {
+                wide t = wide(r[i]) - borrow;
+                r[i] = limb(t);
+                borrow = (t >> LIMB_BITS) & 1;
+            }
+        }
+
+        std::vector<limb> mul_school(const limb* a, size_t na, const limb* b, size_t nb) {
+            std::vector<limb> r(na + nb, 0);
+            for (size_t i = 0; i < na; ++i) {
+                wide carry = 0;
+                for (size_t j = 0; j < nb; ++j) {
+                    wide t = wide(a[i]) * b[j] + r[i + j] + carry;
+                    r[i + j] = limb(t);
+                    carry = t >> LIMB_BITS;
+                }
+                r[i + nb] = limb(carry);
+            }
+            return r;
+        }
+
+        // a * b, possibly with leading zero limbs.
+        std::vector<limb> mul(const limb* a, size_t na, const limb* b, size_t nb) {
+            na = trimmed(a, na);
+            nb = trimmed(b, nb);
+            if (na < nb) {
+                std::swap(a, b);
+                std::swap(na, nb);
+            }
+            if (nb == 0)
+                return {};
+            if (nb < BigUnsigned::KARATSUBA_THRESHOLD)
+                return mul_school(a, na, b, nb);
+
+            std::vector<limb> r(na + nb, 0);
+            if (2 * nb <= na) {
+                // Unbalanced: slices of a as long as b.
+                for (size_t off = 0; off < na; off += nb) {
+                    auto p = mul(a + off, std::min(nb, na - off), b, nb);
+                    add_at(r, off, p.data(), p.size());
+                }
+                return r;
+            }
+            /*
+            ** a = a1 B^m + a0 and b = b1 B^m + b0, with m limbs in a0 and b0.
+            ** a b = z2 B^2m + z1 B^m + z0, where z0 = a0 b0, z2 = a1 b1 and
+            ** z1 = (a0 + a1)(b0 + b1) - z0 - z2.
+            */
+            size_t m = na / 2;
+            auto z0 = mul(a, m, b, m);
+            auto z2 = mul(a + m, na - m, b + m, nb - m);
+            std::vector<limb> sa(a, a + m), sb(b, b + m);
+            add_at(sa, 0, a + m, na - m);
+            add_at(sb, 0, b + m, nb - m);
+            auto z1 = mul(sa.data(), sa.size(), sb.data(), sb.size());
+            sub_at(z1, 0, z0.data(), z0.size());
+            sub_at(z1, 0, z2.data(), z2.size());
+            add_at(r, 0, z0.data(), z0.size());
+            add_at(r, m, z1.data(), z1.size());
+            add_at(r, 2 * m, z2.data(), z2.size());
+            return r;
+        }
+    }
+
+
+    BigUnsigned::BigUnsigned(std::uint64_t v) {
+        for (; v; v >>= LIMB_BITS)
+            m_limbs.push_back(limb(v));
+    }
+
+    void BigUnsigned::trim() {
+        m_limbs.resize(trimmed(m_limbs.data(), m_limbs.size()));
+    }
+
+    size_t BigUnsigned::bits() const {
+        if (m_limbs.empty())
+            return 0;
+        size_t n = LIMB_BITS * (m_limbs.size() - 1);
+        for (limb top = m_limbs.back(); top; top >>= 1)
+            ++n;
+        return n;
+    }
+
+    BigUnsigned& BigUnsigned::operator+=(const BigUnsigned& rhs) {
+        if (this == &rhs)
+            return *this <<= 1;
+        add_at(m_limbs, 0, rhs.m_limbs.data(), rhs.m_limbs.size());
+        return *this;
+    }
+
+    BigUnsigned& BigUnsigned::operator-=(const BigUnsigned& rhs) {
+        if (this == &rhs) {
+            m_limbs.clear();
+            return *this;
+        }
+        sub_at(m_limbs, 0, rhs.m_limbs.data(), rhs.m_limbs.size());
+        trim();
+        return *this;
+    }
+
+    BigUnsigned& BigUnsigned::operator<<=(unsigned shift) {
+        if (m_limbs.empty())
+            return *this;
+        unsigned whole = shift / LIMB_BITS, part = shift % LIMB_BITS;
+        if (part) {
+            limb carry = 0;
+            for (auto& l : m_limbs) {
+                limb next = l >> (LIMB_BITS - part);
+                l = (l << part) | carry;
+                carry = next;
+            }
+            if (carry)
+                m_limbs.push_back(carry);
+        }
+        m_limbs.insert(m_limbs.begin(), whole, 0);
+        return *this;
+    }
+
+    BigUnsigned operator*(const BigUnsigned& lhs, const BigUnsigned& rhs) {
+        BigUnsigned r;
+        r.m_limbs = mul(lhs.m_limbs.data(), lhs.m_limbs.size(), rhs.m_limbs.data(), rhs.m_limbs.size());
+        r.trim();
+        return r;
+    }
+
+    bool operator<(const BigUnsigned& lhs, const BigUnsigned& rhs) {
+        if (lhs.size() != rhs.size())
+            return lhs.size() < rhs.size();
+        return std::lexicographical_compare(lhs.m_limbs.rbegin(), lhs.m_limbs.rend(),
+                                            rhs.m_limbs.rbegin(), rhs.m_limbs.rend());
+    }
+
+    std::string BigUnsigned::to_string() const {
+        if (m_limbs.empty())
+            return "0";
+        // Peel off 9 decimal digits at a time, lowest first.
+        constexpr limb CHUNK = 1000000000;
+        std::vector<limb> q = m_limbs;
+        std::vector<limb> chunks;
+        while (!q.empty()) {
+            wide rem = 0;
+            for (size_t i = q.size(); i-- > 0; ) {
+                wide cur = (rem << LIMB_BITS) | q[i];
+                q[i] = limb(cur / CHUNK);
+                rem = cur % CHUNK;
+            }
+            chunks.push_back(limb(rem));
+            q.resize(trimmed(q.data(), q.size()));
+        }
+        std::string s = std::to_string(chunks.back());
+        for (size_t i = chunks.size() - 1; i-- > 0; ) {
+            std::string c = std::to_string(chunks[i]);
+            s.append(9 - c.size(), '0');
+            s += c;
+        }
+        return s;
+    }
+
+}
@@ -0,0 +1,63 @@
+/*
+** Arbitrary precision unsigned integers.
+**
+** Magnitudes are vectors of 32-bit limbs, least significant first, with no
+** leading zero limbs, so zero has no limbs. Products of operands above
+** KARATSUBA_THRESHOLD limbs are split in halves and take three half size
+** products instead of four, which is O(n^1.58) instead of O(n^2).
+*/
+
+#ifndef __BIGINT_H_
+#define __BIGINT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+namespace ADT {
+
+    class BigUnsigned {
+        public:
+            using limb = std::uint32_t;
+
+            // Operands with fewer limbs than this are multiplied schoolbook.
+            static constexpr size_t KARATSUBA_THRESHOLD = 32;
+
+            BigUnsigned(std::uint64_t v = 0);
+
+            bool is_zero() const { return m_limbs.empty(); }
+            size_t size() const { return m_limbs.size(); }  // in limbs
+            size_t bits() const;
+            const std::vector<limb>& limbs() const { return m_limbs; }
+
+            BigUnsigned& operator+=(const BigUnsigned& rhs);
+            // Requires *this >= rhs.
+            BigUnsigned& operator-=(const BigUnsigned& rhs);
+            BigUnsigned& operator*=(const BigUnsigned& rhs) { return *this = *this * rhs; }
+            BigUnsigned& operator<<=(unsigned shift);
+
+            friend BigUnsigned operator+(BigUnsigned lhs, const BigUnsigned& rhs) { return lhs += rhs; }
+            friend BigUnsigned operator-(BigUnsigned lhs, const BigUnsigned& rhs) { return lhs -= rhs; }
+            friend BigUnsigned operator*(const BigUnsigned& lhs, const BigUnsigned& rhs);
+            friend BigUnsigned operator<<(BigUnsigned lhs, unsigned shift) { return lhs <<= shift; }
+
+            friend bool operator==(const BigUnsigned& lhs, const BigUnsigned& rhs) { return lhs.m_limbs == rhs.m_limbs; }
+            friend bool operator!=(const BigUnsigned& lhs, const BigUnsigned& rhs) { return !(lhs == rhs); }
+            friend bool operator<(const BigUnsigned& lhs, const BigUnsigned& rhs);
+
+            // Decimal digits; O(n^2) in the number of limbs.
+            std::string to_string() const;
+            friend std::ostream& operator<<(std::ostream& os, const BigUnsigned& x) { return os << x.to_string(); }
+
+        private:
+            void trim();
+            std::vector<limb> m_limbs;
+    };
+
+}
+
+
+#endif // __BIGINT_H_
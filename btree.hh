@@ -0,0 +1,654 @@
+/*
+** B+ tree ordered map and set.
+**
+** Compared to BinarySearchTree and AVLTree in trees.hh, a node holds dozens of
+** keys in one contiguous array, sized so a node spans a few cache lines
+** (NodeBytes). A lookup touches about log_B(n) nodes instead of log_2(n), and
+** there is no per-key pointer or control block. All elements live in the leaves,
+** which are linked for in-order iteration and range scans; inner nodes only
+** hold separator keys.
+**     ADT::btree_map<int, std::string> m;
+**     m.insert(3, "c");
+**     m[1] = "a";
+**     for (auto it = m.lower_bound(2); it != m.end(); ++it)
+**         std::cout << it -> first << ' ' << it -> second;
+**     ADT::btree_set<long> s;
+**
+** Keys and values are stored in fixed arrays, so K and V must be default
+** constructible and move assignable. Inserting or erasing invalidates iterators
+** (elements move within and between nodes).
+*/
+
+
+#ifndef __BTREE_H_
+#define __BTREE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+
+namespace ADT {
+
+    // Value type placeholder of btree_set.
+    struct btree_no_value {};
+
+    template <typename K, typename V, size_t N>
+    struct btree_leaf_slots {
+        K keys[N];
+        V vals[N];
+    };
+
+    template <typename K, size_t N>
+    struct btree_leaf_slots<K, void, N> {
+        K keys[N];
+    };
+
+
+    template <typename K, typename V, typename Compare = std::less<K>, size_t NodeBytes = 256>
+    class btree {
+        /*
+        ** Unique keys. V = void makes a set.
+        ** Inner node keys[i] separates children[i] and children[i+1]: keys in
+        ** children[i] are < keys[i] <= keys in children[i+1]. A separator may go
+        ** stale when the smallest key of its right subtree is erased; it still
+        ** separates correctly.
+        ** Leaves hold between LEAF_SLOTS / 2 and LEAF_SLOTS elements, inner nodes
+        ** between INNER_SLOTS / 2 and INNER_SLOTS keys, except at the root.
+        */
+        static constexpr bool is_set = std::is_void<V>::value;
+
+        public:
+            using key_type = K;
+            using mapped_type = std::conditional_t<is_set, btree_no_value, V>;
+            class iterator;
+
+            btree() = default;
+            explicit btree(const Compare& comp) : m_comp{comp} {}
+            btree(const btree&) = delete;
+            btree& operator=(const btree&) = delete;
+            btree(btree&& t) noexcept { swap(*this, t); }
+            btree& operator=(btree&& t) noexcept {
+                swap(*this, t);
+                return *this;
+            }
+            ~btree() { clear(); }
+
+            friend void swap(btree& a, btree& b) noexcept {
+                std::swap(a.m_root, b.m_root);
+                std::swap(a.m_first, b.m_first);
+                std::swap(a.m_last, b.m_last);
+                std::swap(a.m_size, b.m_size);
+                std::swap(a.m_height, b.m_height);
+                std::swap(a.m_comp, b.m_comp);
+            }
+
+            // Iterators
+            iterator begin() const { return iterator(this, m_first, 0); }
+            iterator end() const { return iterator(this, nullptr, 0); }
+
+            // Capacity
+            bool empty() const noexcept { return m_size == 0; }
+            size_t size() const noexcept { return m_size; }
+            size_t height() const noexcept { return m_height; }  // 0 when empty, 1 for a single leaf
+
+            // Lookup
+            iterator find(const K& key) const;
+            bool contains(const K& key) const { return find(key) != end(); }
+            size_t count(const K& key) const { return contains(key); }
+            iterator lower_bound(const K& key) const;  // first element >= key
+            iterator upper_bound(const K& key) const;  // first element > key
+            std::pair<iterator, iterator> equal_range(const K& key) const {
+                return {lower_bound(key), upper_bound(key)};
+            }
+
+            // Modifiers. The set forms take a key only, the map forms a key and a value.
+            std::pair<iterator, bool> insert(const K& key) {
+                static_assert(is_set, "btree_map::insert needs a value");
+                return insert_unique(key, btree_no_value());
+            }
+            std::pair<iterator, bool> insert(const K& key, const mapped_type& val) {
+                static_assert(!is_set, "btree_set::insert takes a key only");
+                return insert_unique(key, val);
+            }
+            std::pair<iterator, bool> insert(const std::pair<K, mapped_type>& kv) {
+                return insert(kv.first, kv.second);
+            }
+            // Insert key, or overwrite its value. Returns true if key was inserted.
+            bool insert_or_assign(const K& key, const mapped_type& val) {
+                static_assert(!is_set, "btree_set has no values");
+                auto r = insert_unique(key, val);
+                if (!r.second)
+                    r.first.value() = val;
+                return r.second;
+            }
+            mapped_type& operator[](const K& key) {
+                static_assert(!is_set, "btree_set has no values");
+                return insert_unique(key, mapped_type()).first.value();
+            }
+            size_t erase(const K& key);
+            void clear();
+
+        private:
+            struct Node {
+                bool leaf;
+                unsigned short count;
+            };
+
+            static constexpr size_t value_bytes = is_set ? 0 : sizeof(mapped_type);
+            static constexpr size_t fit(size_t room, size_t slot) {
+                return room / slot < 3 ? 3 : room / slot;
+            }
+
+        public:
+            static constexpr size_t LEAF_SLOTS = fit(NodeBytes - sizeof(Node) - 2 * sizeof(void*), sizeof(K) + value_bytes);
+            static constexpr size_t INNER_SLOTS = fit(NodeBytes - sizeof(Node) - sizeof(void*), sizeof(K) + sizeof(void*));
+            static_assert(LEAF_SLOTS < 65536 && INNER_SLOTS < 65536, "node too wide for its count field");
+
+        private:
+            struct Leaf : Node, btree_leaf_slots<K, V, LEAF_SLOTS> {
+                Leaf* prev;
+                Leaf* next;
+            };
+            struct Inner : Node {
+                K keys[INNER_SLOTS];
+                Node* children[INNER_SLOTS + 1];
+            };
+
+            // Result of inserting into a subtree that had to split.
+            struct Split {
+                Node* right = nullptr;  // new right sibling, or null if no split
+                K sep;  // smallest key under right
+            };
+
+            size_t lower_index(const K* keys, size_t n, const K& key) const;
+            size_t upper_index(const K* keys, size_t n, const K& key) const;
+            Leaf* find_leaf(const K& key) const;
+
+            static Leaf* new_leaf() {
+                Leaf* l = new Leaf;
+                l -> leaf = true;
+                l -> count = 0;
+                l -> prev = l -> next = nullptr;
+                return l;
+            }
+            static Inner* new_inner() {
+                Inner* n = new Inner;
+                n -> leaf = false;
+                n -> count = 0;
+                return n;
+            }
+            static void move_slot(Leaf* dst, size_t j, Leaf* src, size_t i) {
+                dst -> keys[j] = std::move(src -> keys[i]);
+                if constexpr (!is_set)
+                    dst -> vals[j] = std::move(src -> vals[i]);
+            }
+            static void free_subtree(Node* n);
+
+            std::pair<iterator, bool> insert_unique(const K& key, const mapped_type& val);
+            Split insert_into(Node* n, const K& key, const mapped_type& val, Leaf*& at, size_t& pos, bool& inserted);
+            Split insert_into_leaf(Leaf* l, size_t i, const K& key, const mapped_type& val, Leaf*& at, size_t& pos);
+            bool erase_from(Node* n, const K& key);
+            void fix_child(Inner* p, size_t i);
+
+            Node* m_root = nullptr;
+            Leaf* m_first = nullptr;
+            Leaf* m_last = nullptr;
+            size_t m_size = 0;
+            size_t m_height = 0;
+            Compare m_comp;
+
+        public:  // iterator
+            class iterator {
+                /*
+                ** Bidirectional iterator over a leaf slot. Map iterators dereference
+                ** to a std::pair<const K&, V&> proxy, set iterators to const K&.
+                 */
+                public:
+                    using iterator_category = std::bidirectional_iterator_tag;
+                    using value_type = std::conditional_t<is_set, K, std::pair<const K, mapped_type>>;
+                    using difference_type = std::ptrdiff_t;
+                    using reference = std::conditional_t<is_set, const K&, std::pair<const K&, mapped_type&>>;
+                    struct arrow_proxy {
+                        std::pair<const K&, mapped_type&> ref;
+                        std::pair<const K&, mapped_type&>* operator->() { return &ref; }
+                    };
+                    using pointer = std::conditional_t<is_set, const K*, arrow_proxy>;
+
+                    iterator() = default;
+                    iterator(const btree* t, Leaf* l, size_t i) : m_tree{t}, m_leaf{l}, m_idx{i} {}
+
+                    const K& key() const { return m_leaf -> keys[m_idx]; }
+                    mapped_type& value() const {
+                        static_assert(!is_set, "btree_set has no values");
+                        return m_leaf -> vals[m_idx];
+                    }
+                    reference operator*() const {
+                        if constexpr (is_set)
+                            return key();
+                        else
+                            return reference(key(), value());
+                    }
+                    pointer operator->() const {
+                        if constexpr (is_set)
+                            return &key();
+                        else
+                            return arrow_proxy{**this};
+                    }
+
+                    iterator& operator++() {
+                        if (++m_idx == m_leaf -> count) {
+                            m_leaf = m_leaf -> next;
+                            m_idx = 0;
+                        }
+                        return *this;
+                    }
+                    iterator operator++(int) {
+                        iterator old(*this);
+                        ++*this;
+                        return old;
+                    }
+                    iterator& operator--() {
+                        if (!m_leaf) {  // end
+                            m_leaf = m_tree -> m_last;
+                            m_idx = m_leaf -> count;
+                        }
+                        else if (m_idx == 0) {
+                            m_leaf = m_leaf -> prev;
+                            m_idx = m_leaf -> count;
+                        }
+                        --m_idx;
+                        return *this;
+                    }
+                    iterator operator--(int) {
+                        iterator old(*this);
+                        --*this;
+                        return old;
+                    }
+
+                    bool operator==(const iterator& it) const {
+                        return m_leaf == it.m_leaf && m_idx == it.m_idx;
+                    }
+                    bool operator!=(const iterator& it) const {
+                        return !(*this == it);
+                    }
+
+                private:
+                    friend class btree;
+                    const btree* m_tree = nullptr;
+                    Leaf* m_leaf = nullptr;  // null at end
+                    size_t m_idx = 0;
+            };
+    };
+
+
+    template <typename K, typename V, typename Compare = std::less<K>, size_t NodeBytes = 256>
+    using btree_map = btree<K, V, Compare, NodeBytes>;
+
+    template <typename K, typename Compare = std::less<K>, size_t NodeBytes = 256>
+    using btree_set = btree<K, void, Compare, NodeBytes>;
+
+
+#define BTREE_TEMPLATE template <typename K, typename V, typename Compare, size_t NodeBytes>
+#define BTREE btree<K, V, Compare, NodeBytes>
+
+    BTREE_TEMPLATE
+    size_t BTREE::lower_index(const K* keys, size_t n, const K& key) const {
+        // Index of the first key >= key. Arithmetic keys are counted without
+        // branches, which the compiler vectorizes; others are binary searched.
+        if constexpr (std::is_arithmetic<K>::value && std::is_same<Compare, std::less<K>>::value) {
+            size_t i = 0;
+            for (size_t j = 0; j < n; ++j)
+                i += keys[j] < key;
+            return i;
+        }
+        else
+            return std::lower_bound(keys, keys + n, key, m_comp) - keys;
+    }
+
+    BTREE_TEMPLATE
+    size_t BTREE::upper_index(const K* keys, size_t n, const K& key) const {
+        // Index of the first key > key.
+        if constexpr (std::is_arithmetic<K>::value && std::is_same<Compare, std::less<K>>::value) {
+            size_t i = 0;
+            for (size_t j = 0; j < n; ++j)
+                i += keys[j] <= key;
+            return i;
+        }
+        else
+            return std::upper_bound(keys, keys + n, key, m_comp) - keys;
+    }
+
+    BTREE_TEMPLATE
+    typename BTREE::Leaf* BTREE::find_leaf(const K& key) const {
+        // The leaf whose range holds key.
+        Node* n = m_root;
+        while (!n -> leaf) {
+            Inner* in = static_cast<Inner*>(n);
+            n = in -> children[upper_index(in -> keys, in -> count, key)];
+        }
+        return static_cast<Leaf*>(n);
+    }
+
+    BTREE_TEMPLATE
+    typename BTREE::iterator BTREE::lower_bound(const K& key) const {
+        if (!m_root)
+            return end();
+        Leaf* l = find_leaf(key);
+        size_t i = lower_index(l -> keys, l -> count, key);
+        if (i == l -> count)  // all keys of the next leaf are > key
+            return iterator(this, l -> next, 0);
+        return iterator(this, l, i);
+    }
+
+    BTREE_TEMPLATE
+    typename BTREE::iterator BTREE::upper_bound(const K& key) const {
+        if (!m_root)
+            return end();
+        Leaf* l = find_leaf(key);
+        size_t i = upper_index(l -> keys, l -> count, key);
+        if (i == l -> count)
+            return iterator(this, l -> next, 0);
+        return iterator(this, l, i);
+    }
+
+    BTREE_TEMPLATE
+    typename BTREE::iterator BTREE::find(const K& key) const {
+        if (!m_root)
+            return end();
+        Leaf* l = find_leaf(key);
+        size_t i = lower_index(l -> keys, l -> count, key);
+        if (i < l -> count && !m_comp(key, l -> keys[i]))
+            return iterator(this, l, i);
+        return end();
+    }
+
+    BTREE_TEMPLATE
+    std::pair<typename BTREE::iterator, bool> BTREE::insert_unique(const K& key, const mapped_type& val) {
+        if (!m_root) {
+            m_root = m_first = m_last = new_leaf();
+            m_height = 1;
+        }
+        Leaf* at;
+        size_t pos;
+        bool inserted = false;
+        Split s = insert_into(m_root, key, val, at, pos, inserted);
+        if (s.right) {  // grow a new root
+            Inner* r = new_inner();
+            r -> keys[0] = std::move(s.sep);
+            r -> children[0] = m_root;
+            r -> children[1] = s.right;
+            r -> count = 1;
+            m_root = r;
+            ++m_height;
+        }
+        if (inserted)
+            ++m_size;
+        return {iterator(this, at, pos), inserted};
+    }
+
+    BTREE_TEMPLATE
+    typename BTREE::Split BTREE::insert_into(Node* n, const K& key, const mapped_type& val,
+                                             Leaf*& at, size_t& pos, bool& inserted) {
+        // Insert into the subtree at n. Sets at/pos to the slot of key, inserted if it
+        // was new, and returns the new right sibling of n if n split.
+        if (n -> leaf) {
+            Leaf* l = static_cast<Leaf*>(n);
+            size_t i = lower_index(l -> keys, l -> count, key);
+            if (i < l -> count && !m_comp(key, l -> keys[i])) {  // already there
+                at = l;
+                pos = i;
+                return {};
+            }
+            inserted = true;
+            return insert_into_leaf(l, i, key, val, at, pos);
+        }
+
+        Inner* in = static_cast<Inner*>(n);
+        size_t i = upper_index(in -> keys, in -> count, key);
+        Split s = insert_into(in -> children[i], key, val, at, pos, inserted);
+        if (!s.right)
+            return {};
+
+        // Add separator s.sep and child s.right after children[i].
+        Split up;
+        Inner* dst = in;
+        if (in -> count == INNER_SLOTS) {
+            // Split first: keys[mid] moves up, the right half goes to a new node.
+            size_t mid = INNER_SLOTS / 2;
+            Inner* r = new_inner();
+            r -> count = INNER_SLOTS - mid - 1;
+            for (size_t j = 0; j < r -> count; ++j) {
+                r -> keys[j] = std::move(in -> keys[mid + 1 + j]);
+                r -> children[j] = in -> children[mid + 1 + j];
+            }
+            r -> children[r -> count] = in -> children[INNER_SLOTS];
+            up.sep = std::move(in -> keys[mid]);
+            up.right = r;
+            in -> count = mid;
+            if (i > mid) {
+                dst = r;
+                i -= mid + 1;
+            }
+        }
+        for (size_t j = dst -> count; j > i; --j) {
+            dst -> keys[j] = std::move(dst -> keys[j - 1]);
+            dst -> children[j + 1] = dst -> children[j];
+        }
+        dst -> keys[i] = std::move(s.sep);
+        dst -> children[i + 1] = s.right;
+        ++dst -> count;
+        return up;
+    }
+
+    BTREE_TEMPLATE
+    typename BTREE::Split BTREE::insert_into_leaf(Leaf* l, size_t i, const K& key, const mapped_type& val,
+                                                  Leaf*& at, size_t& pos) {
+        // Insert key at slot i of l, splitting l in halves if it is full.
+        Split up;
+        Leaf* dst = l;
+        if (l -> count == LEAF_SLOTS) {
+            size_t mid = (LEAF_SLOTS + 1) / 2;
+            Leaf* r = new_leaf();
+            r -> count = LEAF_SLOTS - mid;
+            for (size_t j = 0; j < r -> count; ++j)
+                move_slot(r, j, l, mid + j);
+            l -> count = mid;
+            r -> next = l -> next;
+            r -> prev = l;
+            if (l -> next)
+                l -> next -> prev = r;
+            else
+                m_last = r;
+            l -> next = r;
+            if (i > mid) {
+                dst = r;
+                i -= mid;
+            }
+            up.right = r;
+        }
+        for (size_t j = dst -> count; j > i; --j)
+            move_slot(dst, j, dst, j - 1);
+        dst -> keys[i] = key;
+        if constexpr (!is_set)
+            dst -> vals[i] = val;
+        ++dst -> count;
+        if (up.right)
+            up.sep = static_cast<Leaf*>(up.right) -> keys[0];
+        at = dst;
+        pos = i;
+        return up;
+    }
+
+    BTREE_TEMPLATE
+    size_t BTREE::erase(const K& key) {
+        if (!m_root || !erase_from(m_root, key))
+            return 0;
+        --m_size;
+        if (m_root -> leaf) {
+            if (m_root -> count == 0) {
+                delete static_cast<Leaf*>(m_root);
+                m_root = m_first = m_last = nullptr;
+                m_height = 0;
+            }
+        }
+        else if (m_root -> count == 0) {  // shrink: the root's only child takes over
+            Inner* old = static_cast<Inner*>(m_root);
+            m_root = old -> children[0];
+            delete old;
+            --m_height;
+        }
+        return 1;
+    }
+
+    BTREE_TEMPLATE
+    bool BTREE::erase_from(Node* n, const K& key) {
+        // Erase key from the subtree at n, which may be left underfull.
+        if (n -> leaf) {
+            Leaf* l = static_cast<Leaf*>(n);
+            size_t i = lower_index(l -> keys, l -> count, key);
+            if (i == l -> count || m_comp(key, l -> keys[i]))
+                return false;
+            for (size_t j = i + 1; j < l -> count; ++j)
+                move_slot(l, j - 1, l, j);
+            --l -> count;
+            return true;
+        }
+        Inner* in = static_cast<Inner*>(n);
+        size_t i = upper_index(in -> keys, in -> count, key);
+        if (!erase_from(in -> children[i], key))
+            return false;
+        fix_child(in, i);
+        return true;
+    }
+
+    BTREE_TEMPLATE
+    void BTREE::fix_child(Inner* p, size_t i) {
+        // Refill children[i] of p from a sibling, or merge it with one, if it
+        // fell below half full.
+        Node* c = p -> children[i];
+        Node* left = i > 0 ? p -> children[i - 1] : nullptr;
+        Node* right = i < p -> count ? p -> children[i + 1] : nullptr;
+
+        if (c -> leaf) {
+            Leaf* cl = static_cast<Leaf*>(c);
+            if (cl -> count >= LEAF_SLOTS / 2)
+                return;
+            Leaf* ll = static_cast<Leaf*>(left);
+            Leaf* rl = static_cast<Leaf*>(right);
+            if (ll && ll -> count > LEAF_SLOTS / 2) {  // borrow the last of left
+                for (size_t j = cl -> count; j > 0; --j)
+                    move_slot(cl, j, cl, j - 1);
+                move_slot(cl, 0, ll, --ll -> count);
+                ++cl -> count;
+                p -> keys[i - 1] = cl -> keys[0];
+                return;
+            }
+            if (rl && rl -> count > LEAF_SLOTS / 2) {  // borrow the first of right
+                move_slot(cl, cl -> count++, rl, 0);
+                for (size_t j = 1; j < rl -> count; ++j)
+                    move_slot(rl, j - 1, rl, j);
+                --rl -> count;
+                p -> keys[i] = rl -> keys[0];
+                return;
+            }
+            // Merge the right one of a pair into the left one.
+            if (ll) {
+                rl = cl;
+                --i;
+            }
+            else
+                ll = cl;
+            for (size_t j = 0; j < rl -> count; ++j)
+                move_slot(ll, ll -> count + j, rl, j);
+            ll -> count += rl -> count;
+            ll -> next = rl -> next;
+            if (rl -> next)
+                rl -> next -> prev = ll;
+            else
+                m_last = ll;
+            delete rl;
+        }
+        else {
+            Inner* ci = static_cast<Inner*>(c);
+            if (ci -> count >= INNER_SLOTS / 2)
+                return;
+            Inner* li = static_cast<Inner*>(left);
+            Inner* ri = static_cast<Inner*>(right);
+            if (li && li -> count > INNER_SLOTS / 2) {  // rotate through the separator
+                for (size_t j = ci -> count; j > 0; --j)
+                    ci -> keys[j] = std::move(ci -> keys[j - 1]);
+                for (size_t j = ci -> count + 1; j > 0; --j)
+                    ci -> children[j] = ci -> children[j - 1];
+                ci -> keys[0] = std::move(p -> keys[i - 1]);
+                ci -> children[0] = li -> children[li -> count];
+                p -> keys[i - 1] = std::move(li -> keys[li -> count - 1]);
+                --li -> count;
+                ++ci -> count;
+                return;
+            }
+            if (ri && ri -> count > INNER_SLOTS / 2) {
+                ci -> keys[ci -> count] = std::move(p -> keys[i]);
+                ci -> children[ci -> count + 1] = ri -> children[0];
+                ++ci -> count;
+                p -> keys[i] = std::move(ri -> keys[0]);
+                for (size_t j = 1; j < ri -> count; ++j)
+                    ri -> keys[j - 1] = std::move(ri -> keys[j]);
+                for (size_t j = 1; j <= ri -> count; ++j)
+                    ri -> children[j - 1] = ri -> children[j];
+                --ri -> count;
+                return;
+            }
+            if (li) {
+                ri = ci;
+                --i;
+            }
+            else
+                li = ci;
+            // The separator comes down between the two halves.
+            li -> keys[li -> count] = std::move(p -> keys[i]);
+            for (size_t j = 0; j < ri -> count; ++j)
+                li -> keys[li -> count + 1 + j] = std::move(ri -> keys[j]);
+            for (size_t j = 0; j <= ri -> count; ++j)
+                li -> children[li -> count + 1 + j] = ri -> children[j];
+            li -> count += ri -> count + 1;
+            delete ri;
+        }
+        // Drop separator i and child i + 1 (the merged away node) from p.
+        for (size_t j = i + 1; j < p -> count; ++j) {
+            p -> keys[j - 1] = std::move(p -> keys[j]);
+            p -> children[j] = p -> children[j + 1];
+        }
+        --p -> count;
+    }
+
+    BTREE_TEMPLATE
+    void BTREE::free_subtree(Node* n) {
+        if (n -> leaf) {
+            delete static_cast<Leaf*>(n);
+            return;
+        }
+        Inner* in = static_cast<Inner*>(n);
+        for (size_t i = 0; i <= in -> count; ++i)
+            free_subtree(in -> children[i]);
+        delete in;
+    }
+
+    BTREE_TEMPLATE
+    void BTREE::clear() {
+        if (m_root)
+            free_subtree(m_root);
+        m_root = m_first = m_last = nullptr;
+        m_size = m_height = 0;
+    }
+
+#undef BTREE
+#undef BTREE_TEMPLATE
+
+}  // end of namespace ADT
+
+
+#endif // __BTREE_H_
@@ -0,0 +1,89 @@
+/*
+** Bucket and rehash policies for ADT::unordered_map.
+**
+** A bucket policy decides how many buckets to allocate for a requested count, and
+** how to reduce a 64-bit hash to a bucket index:
+**   static size_t bucket_count(size_t n);  // smallest supported count >= n, at least 1
+**   static size_t index(hash_t h, size_t bucket_count);
+**
+** A rehash policy decides how many old buckets are migrated per operation when
+** the table grows:
+**   static constexpr size_t migrate_step;  // 0 relinks everything at once
+*/
+
+
+#ifndef __BUCKET_POLICY_H_
+#define __BUCKET_POLICY_H_
+
+#include <cstddef>
+#include "hash.hh"
+
+
+namespace ADT {
+
+    struct power_of_two_policy {
+        /*
+        ** Power of 2 bucket counts, index is the low bits of the hash (one AND).
+        ** Needs a mixing hash like ADT::hasher, whose low bits depend on every key bit.
+         */
+        static size_t bucket_count(size_t n) {
+            size_t c = 1;
+            while (c < n)
+                c <<= 1;
+            return c;
+        }
+        static size_t index(hash_t h, size_t bucket_count) {
+            return static_cast<size_t>(h) & (bucket_count - 1);
+        }
+    };
+
+    struct fastrange_policy {
+        /*
+        ** Any bucket count, index is the high half of h * bucket_count, which maps
+        ** [0, 2^64) onto [0, bucket_count) with a multiply instead of a division.
+        ** Lemire, "A fast alternative to the modulo reduction", 2016.
+        ** Uses the high bits of the hash.
+         */
+        static size_t bucket_count(size_t n) {
+            return n < 1 ? 1 : n;
+        }
+        static size_t index(hash_t h, size_t bucket_count) {
+            hash_t hi = bucket_count;
+            hash_mum(h, hi);
+            return static_cast<size_t>(hi);
+        }
+    };
+
+    struct modulo_policy {
+        /*
+        ** Any bucket count, index is h % bucket_count. An integer division per lookup,
+        ** but tolerates weak hash functions.
+         */
+        static size_t bucket_count(size_t n) {
+            return n < 1 ? 1 : n;
+        }
+        static size_t index(hash_t h, size_t bucket_count) {
+            return static_cast<size_t>(h % bucket_count);
+        }
+    };
+
+
+    struct eager_rehash {
+        // Relink every node inside the insert that crosses the load limit.
+        static constexpr size_t migrate_step = 0;
+    };
+
+    template <size_t Step = 8>
+    struct incremental_rehash {
+        /*
+        ** Keep the old bucket array while growing, and migrate Step old buckets per
+        ** operator[], find and erase. Bounds the per-insert latency of growth.
+         */
+        static_assert(Step > 0, "incremental_rehash needs a positive step");
+        static constexpr size_t migrate_step = Step;
+    };
+
+}  // end of namespace ADT
+
+
+#endif // __BUCKET_POLICY_H_
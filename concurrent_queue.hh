@@ -0,0 +1,316 @@
+/*
+** Bounded lock-free queues for producer/consumer pipelines.
+**
+** SpscQueue: one producer thread, one consumer thread. A circular array like
+**     ArrayQueue, with the capacity rounded up to a power of 2. Head and tail
+**     are free running counters, each on its own cache line, published with
+**     release stores and read with acquire loads.
+** MpmcQueue: any number of producers and consumers. Dmitry Vyukov's bounded
+**     MPMC queue: every cell carries a sequence number telling whether it is
+**     ready to be written or read in the current lap, so a push or pop costs one
+**     CAS on the shared counter and no lock.
+**
+** Both queues move elements in and out, so move-only types work:
+**     ADT::SpscQueue<std::unique_ptr<Job>> q(1024);
+**     q.try_push(std::make_unique<Job>());      // false when full
+**     std::unique_ptr<Job> j;
+**     if (q.try_pop(j)) ...                     // false when empty
+**
+** Destroy a queue only after every thread using it is done.
+*/
+
+
+#ifndef __CONCURRENT_QUEUE_H_
+#define __CONCURRENT_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace ADT {
+
+    // Separates data written by different threads. std::hardware_destructive_interference_size
+    // is missing or warns in common compilers, and 64 is right for x86-64 and most ARM cores.
+    constexpr size_t CACHE_LINE_SIZE = 64;
+
+    inline size_t queue_capacity(size_t n) {
+        size_t c = 2;
+        while (c < n)
+            c <<= 1;
+        return c;
+    }
+
+
+    template <typename T>
+    class SpscQueue {
+        /*
+        ** Single producer, single consumer bounded queue.
+        ** try_push* may only be called from the producer thread and try_pop* from
+        ** the consumer thread. Each side keeps a cached copy of the other side's
+        ** counter and reloads it only when the queue looks full (or empty), so the
+        ** shared cache lines are touched about once per lap.
+         */
+        public:
+            explicit SpscQueue(size_t capacity)
+                : m_mask{queue_capacity(capacity) - 1},
+                  m_slots{std::allocator<T>().allocate(m_mask + 1)} {}
+            SpscQueue(const SpscQueue&) = delete;
+            SpscQueue& operator=(const SpscQueue&) = delete;
+            ~SpscQueue() {
+                size_t t = m_tail.load(std::memory_order_relaxed);
+                for (size_t h = m_head.load(std::memory_order_relaxed); h != t; ++h)
+                    m_slots[h & m_mask].~T();
+                std::allocator<T>().deallocate(m_slots, m_mask + 1);
+            }
+
+            size_t capacity() const { return m_mask + 1; }
+
+            // Number of elements at some recent point; exact only from a quiescent queue.
+            size_t size_approx() const {
+                size_t h = m_head.load(std::memory_order_acquire);
+                size_t t = m_tail.load(std::memory_order_acquire);
+                return t - h;
+            }
+            bool empty() const { return size_approx() == 0; }
+
+            bool try_push(const T& x) { return try_emplace(x); }
+            bool try_push(T&& x) { return try_emplace(std::move(x)); }
+
+            template <typename... Args>
+            bool try_emplace(Args&&... args) {
+                size_t t = m_tail.load(std::memory_order_relaxed);
+                if (t - m_head_cache > m_mask) {
+                    m_head_cache = m_head.load(std::memory_order_acquire);
+                    if (t - m_head_cache > m_mask)
+                        return false;
+                }
+                new (m_slots + (t & m_mask)) T(std::forward<Args>(args)...);
+                m_tail.store(t + 1, std::memory_order_release);
+                return true;
+            }
+
+            bool try_pop(T& out) {
+                size_t h = m_head.load(std::memory_order_relaxed);
+                if (h == m_tail_cache) {
+                    m_tail_cache = m_tail.load(std::memory_order_acquire);
+                    if (h == m_tail_cache)
+                        return false;
+                }
+                T& x = m_slots[h & m_mask];
+                out = std::move(x);
+                x.~T();
+                m_head.store(h + 1, std::memory_order_release);
+                return true;
+            }
+
+            // Push elements of [first, last) until the queue is full, with one
+            // release store for the whole batch. Returns the number pushed.
+            template <typename InputIt>
+            size_t try_push_batch(InputIt first, InputIt last) {
+                size_t t = m_tail.load(std::memory_order_relaxed);
+                size_t room = capacity() - (t - m_head_cache);
+                if (room < capacity()) {
+                    m_head_cache = m_head.load(std::memory_order_acquire);
+                    room = capacity() - (t - m_head_cache);
+                }
+                size_t k = 0;
+                try {
+                    for (; k < room && first != last; ++k, ++first)
+                        new (m_slots + ((t + k) & m_mask)) T(std::move(*first));
+                }
+                catch (...) {
+                    m_tail.store(t + k, std::memory_order_release);
+                    throw;
+                }
+                m_tail.store(t + k, std::memory_order_release);
+                return k;
+            }
+
+            // Pop up to max elements into out, with one release store for the batch.
+            // Returns the number popped.
+            template <typename OutputIt>
+            size_t try_pop_batch(OutputIt out, size_t max) {
+                size_t h = m_head.load(std::memory_order_relaxed);
+                if (m_tail_cache - h < max)
+                    m_tail_cache = m_tail.load(std::memory_order_acquire);
+                size_t n = m_tail_cache - h;
+                if (n > max)
+                    n = max;
+                size_t k = 0;
+                try {
+                    for (; k < n; ++k) {
+                        T& x = m_slots[(h + k) & m_mask];
+                        *out = std::move(x);
+                        ++out;
+                        x.~T();
+                    }
+                }
+                catch (...) {
+                    m_head.store(h + k, std::memory_order_release);
+                    throw;
+                }
+                m_head.store(h + n, std::memory_order_release);
+                return n;
+            }
+
+        private:
+            // Read-only after construction.
+            const size_t m_mask;
+            T* const m_slots;
+            // Written by the consumer.
+            alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head{0};
+            size_t m_tail_cache = 0;
+            // Written by the producer.
+            alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail{0};
+            size_t m_head_cache = 0;
+    };
+
+
+    template <typename T>
+    class MpmcQueue {
+        /*
+        ** Multi producer, multi consumer bounded queue.
+        ** http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+        ** Cell i is writable in lap L when its sequence is L * capacity + i, and
+        ** readable when it is one more. A producer claims a cell by a CAS on the
+        ** enqueue counter, constructs the element, then publishes it by bumping the
+        ** sequence; a consumer does the same on the dequeue counter.
+        ** A claimed cell must always be published, so elements are built before
+        ** the claim and moved in, and the move must not throw.
+         */
+        static_assert(std::is_nothrow_move_constructible<T>::value,
+                      "MpmcQueue needs a nothrow move constructor");
+
+        public:
+            explicit MpmcQueue(size_t capacity)
+                : m_mask{queue_capacity(capacity) - 1}, m_cells{new Cell[m_mask + 1]} {
+                for (size_t i = 0; i <= m_mask; ++i)
+                    m_cells[i].seq.store(i, std::memory_order_relaxed);
+            }
+            MpmcQueue(const MpmcQueue&) = delete;
+            MpmcQueue& operator=(const MpmcQueue&) = delete;
+            ~MpmcQueue() {
+                size_t t = m_enqueue.load(std::memory_order_relaxed);
+                for (size_t h = m_dequeue.load(std::memory_order_relaxed); h != t; ++h)
+                    m_cells[h & m_mask].value()->~T();
+                delete[] m_cells;
+            }
+
+            size_t capacity() const { return m_mask + 1; }
+
+            // Number of elements at some recent point; exact only from a quiescent queue.
+            size_t size_approx() const {
+                size_t h = m_dequeue.load(std::memory_order_acquire);
+                size_t t = m_enqueue.load(std::memory_order_acquire);
+                return t > h ? t - h : 0;
+            }
+            bool empty() const { return size_approx() == 0; }
+
+            bool try_push(const T& x) {
+                T copy(x);
+                return try_push(std::move(copy));
+            }
+
+            bool try_push(T&& x) {
+                size_t pos = m_enqueue.load(std::memory_order_relaxed);
+                Cell* c;
+                for (;;) {
+                    c = &m_cells[pos & m_mask];
+                    size_t seq = c -> seq.load(std::memory_order_acquire);
+                    intptr_t diff = intptr_t(seq) - intptr_t(pos);
+                    if (diff == 0) {
+                        if (m_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                            break;
+                    }
+                    else if (diff < 0)
+                        return false;  // full: the cell still holds last lap's element
+                    else
+                        pos = m_enqueue.load(std::memory_order_relaxed);
+                }
+                new (c -> storage) T(std::move(x));
+                c -> seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+
+            template <typename... Args>
+            bool try_emplace(Args&&... args) {
+                return try_push(T(std::forward<Args>(args)...));
+            }
+
+            bool try_pop(T& out) {
+                return pop_with([&](T&& x) { out = std::move(x); });
+            }
+
+            // Push elements of [first, last) until the queue is full. Returns the number pushed.
+            template <typename InputIt>
+            size_t try_push_batch(InputIt first, InputIt last) {
+                size_t k = 0;
+                for (; first != last && try_push(std::move(*first)); ++first)
+                    ++k;
+                return k;
+            }
+
+            // Pop up to max elements into out. Returns the number popped.
+            template <typename OutputIt>
+            size_t try_pop_batch(OutputIt out, size_t max) {
+                size_t k = 0;
+                while (k < max && pop_with([&](T&& x) { *out = std::move(x); ++out; }))
+                    ++k;
+                return k;
+            }
+
+        private:
+            struct Cell {
+                std::atomic<size_t> seq;
+                alignas(T) unsigned char storage[sizeof(T)];
+                T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+            };
+
+            // Claim the next readable cell and hand its element to f.
+            template <typename F>
+            bool pop_with(F&& f) {
+                size_t pos = m_dequeue.load(std::memory_order_relaxed);
+                Cell* c;
+                for (;;) {
+                    c = &m_cells[pos & m_mask];
+                    size_t seq = c -> seq.load(std::memory_order_acquire);
+                    intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+                    if (diff == 0) {
+                        if (m_dequeue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                            break;
+                    }
+                    else if (diff < 0)
+                        return false;  // empty: the cell is not written yet in this lap
+                    else
+                        pos = m_dequeue.load(std::memory_order_relaxed);
+                }
+                // Free and publish the cell even if f throws; the element is then lost.
+                struct Release {
+                    Cell* c;
+                    size_t seq;
+                    ~Release() {
+                        c -> value() -> ~T();
+                        c -> seq.store(seq, std::memory_order_release);
+                    }
+                } release{c, pos + m_mask + 1};
+                f(std::move(*c -> value()));
+                return true;
+            }
+
+            // Read-only after construction.
+            const size_t m_mask;
+            Cell* const m_cells;
+            alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_enqueue{0};
+            alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_dequeue{0};
+    };
+
+}  // end of namespace ADT
+
+
+#endif // __CONCURRENT_QUEUE_H_
@@ -0,0 +1,163 @@
+/*
+** Hash map shared by many reader and writer threads.
+**
+** The key space is split over Shards independent ADT::unordered_map shards, each
+** guarded by its own reader-writer lock, so threads touching different shards
+** never wait on each other and readers of one shard run in parallel.
+**     ADT::concurrent_unordered_map<int, std::string> m;
+**     m.insert_or_assign(1, "one");
+**     if (auto v = m.find(1)) ...                      // std::optional<std::string>
+**     m.compute_if_absent(2, [] { return std::string("two"); });
+** Lookups return copies of values: a reference could be invalidated by another
+** thread as soon as the shard lock is released.
+*/
+
+
+#ifndef __CONCURRENT_UNORDERED_MAP_H_
+#define __CONCURRENT_UNORDERED_MAP_H_
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include "unordered_map.hh"
+#include "concurrent_queue.hh"  // CACHE_LINE_SIZE
+
+
+namespace ADT {
+
+template <typename K, typename V, typename Hash = hasher<K>, size_t Shards = 64>
+class concurrent_unordered_map {
+    /*
+    ** A key's shard is picked by the high bits of its hash; the shard map indexes
+    ** buckets by the low bits, so the two choices are independent.
+    ** Shards use eager rehashing, so a lookup under a shared lock never writes.
+    */
+    static_assert(Shards > 0 && (Shards & (Shards - 1)) == 0, "Shards must be a power of 2");
+
+    using map_type = unordered_map<K, V, Hash, power_of_two_policy, eager_rehash>;
+
+    public:
+        explicit concurrent_unordered_map(size_t bucket_count = 16 * Shards, const Hash& hash = Hash())
+            : m_hash{hash}, m_shards{std::allocator<Shard>().allocate(Shards)} {
+            size_t per_shard = (bucket_count + Shards - 1) / Shards;
+            for (size_t i = 0; i < Shards; ++i)
+                new (m_shards + i) Shard(per_shard, hash);
+        }
+        concurrent_unordered_map(const concurrent_unordered_map&) = delete;
+        concurrent_unordered_map& operator=(const concurrent_unordered_map&) = delete;
+        ~concurrent_unordered_map() {
+            for (size_t i = 0; i < Shards; ++i)
+                m_shards[i].~Shard();
+            std::allocator<Shard>().deallocate(m_shards, Shards);
+        }
+
+        static constexpr size_t shard_count() { return Shards; }
+
+        // Sum of the shard sizes, each read at a different moment.
+        size_t size() const {
+            size_t n = 0;
+            for (size_t i = 0; i < Shards; ++i) {
+                std::shared_lock<std::shared_mutex> lock(m_shards[i].mtx);
+                n += m_shards[i].map.size();
+            }
+            return n;
+        }
+        bool empty() const { return size() == 0; }
+
+        // Copy of the value of key, if present.
+        std::optional<V> find(const K& key) const {
+            Shard& s = shard(key);
+            std::shared_lock<std::shared_mutex> lock(s.mtx);
+            auto it = s.map.find(key);
+            if (it == s.map.end())
+                return std::nullopt;
+            return it -> second;
+        }
+
+        bool contains(const K& key) const {
+            Shard& s = shard(key);
+            std::shared_lock<std::shared_mutex> lock(s.mtx);
+            return s.map.find(key) != s.map.end();
+        }
+
+        // Set key to value. Returns true if key was inserted, false if assigned.
+        bool insert_or_assign(const K& key, const V& value) {
+            Shard& s = shard(key);
+            std::unique_lock<std::shared_mutex> lock(s.mtx);
+            return s.map.insert_or_assign(key, value).second;
+        }
+
+        size_t erase(const K& key) {
+            Shard& s = shard(key);
+            std::unique_lock<std::shared_mutex> lock(s.mtx);
+            return s.map.erase(key);
+        }
+
+        // Return the value of key, first inserting f() if key is absent. f runs
+        // at most once per inserted key, under the shard's write lock, so it must
+        // not call back into this map.
+        template <typename F>
+        V compute_if_absent(const K& key, F&& f) {
+            Shard& s = shard(key);
+            {
+                std::shared_lock<std::shared_mutex> lock(s.mtx);
+                auto it = s.map.find(key);
+                if (it != s.map.end())
+                    return it -> second;
+            }
+            std::unique_lock<std::shared_mutex> lock(s.mtx);
+            auto it = s.map.find(key);  // another writer may have won
+            if (it != s.map.end())
+                return it -> second;
+            return s.map.try_emplace(key, f()).first -> second;
+        }
+
+        // Call f(key, value) on every element. Each shard is visited under its
+        // read lock, so f sees a consistent snapshot of a shard, but not of the
+        // whole map. f must not call back into this map.
+        template <typename F>
+        void for_each(F&& f) const {
+            for (size_t i = 0; i < Shards; ++i) {
+                std::shared_lock<std::shared_mutex> lock(m_shards[i].mtx);
+                for (auto& kv : m_shards[i].map)
+                    f(static_cast<const K&>(kv.first), static_cast<const V&>(kv.second));
+            }
+        }
+
+        void clear() {
+            for (size_t i = 0; i < Shards; ++i) {
+                std::unique_lock<std::shared_mutex> lock(m_shards[i].mtx);
+                m_shards[i].map.clear();
+            }
+        }
+
+    private:
+        struct alignas(CACHE_LINE_SIZE) Shard {
+            Shard(size_t bucket_count, const Hash& hash) : map(bucket_count, hash) {}
+            mutable std::shared_mutex mtx;
+            mutable map_type map;  // read only under a shared lock
+        };
+
+        static constexpr unsigned SHARD_BITS = [] {
+            unsigned b = 0;
+            while ((size_t(1) << b) < Shards)
+                ++b;
+            return b;
+        }();
+
+        Shard& shard(const K& key) const {
+            if constexpr (Shards == 1)
+                return m_shards[0];
+            else
+                return m_shards[m_hash(key) >> (64 - SHARD_BITS)];
+        }
+
+        Hash m_hash;
+        Shard* m_shards;
+};
+
+}  // end of namespace ADT
+
+
+#endif // __CONCURRENT_UNORDERED_MAP_H_
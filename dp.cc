@@ -3,18 +3,21 @@
  */
 
 #include "dp.hh"
+#include "exception.hh"
 #include <iostream> 
 #include <vector>
 #include <cstdlib>
 #include <climits>
+#include <cctype>
 #include <cmath>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <chrono>
 #include <iterator>
 #include <limits>
 #include <numeric>
-#include <ctime>
+#include <shared_mutex>
 
 using std::cin;
 using std::cout;
@@ -25,23 +28,221 @@ using std::string;
 
 namespace DP {
 
-    // Recursive DP & memoizing to compute Fibonacci numbers.
-    unsigned fib(unsigned n) {
-        static vector<int> memo {0, 1, 1};
-        unsigned f;
-        if (n >= memo.size() || memo[n] == 0) {
-            f = fib(n - 1) + fib(n - 2);
-            memo[n] = f;
+    namespace {
+        void check_fib_n(unsigned n) {
+            if (n > FIB_MAX_N)
+                throw ADT::Overflow("Fibonacci(" + std::to_string(n) + ") does not fit in 64 bits");
         }
+    }
+
+    // Memoizing to compute Fibonacci numbers.
+    uint64_t fib(unsigned n) {
+        /*
+        ** Lookups of known values share the lock. A miss takes it exclusively
+        ** and extends the memo up to n. The memo is reserved once, so it is
+        ** never reallocated.
+        */
+        static vector<uint64_t> memo = [] {
+            vector<uint64_t> m;
+            m.reserve(FIB_MAX_N + 1);
+            m.push_back(0);
+            m.push_back(1);
+            return m;
+        }();
+        static std::shared_mutex memo_mtx;
+        check_fib_n(n);
+        {
+            std::shared_lock<std::shared_mutex> lock(memo_mtx);
+            if (n < memo.size())
+                return memo[n];
+        }
+        std::unique_lock<std::shared_mutex> lock(memo_mtx);
+        while (memo.size() <= n)
+            memo.push_back(memo[memo.size() - 1] + memo[memo.size() - 2]);
         return memo[n];
     }
 
     // Bottom-up DP to compute Fibonacci numbers.
-    unsigned fib_bottomup(unsigned n) {
-        vector<int> tbl {0, 1, 1};
-        for (unsigned i = 3; i <= n; i++)
-            tbl[i] = tbl[i-1] + tbl[i-2]; 
-        return tbl[n];
+    uint64_t fib_bottomup(unsigned n) {
+        check_fib_n(n);
+        uint64_t prev = 1, cur = 0;  // F(-1), F(0)
+        for (unsigned i = 0; i < n; i++) {
+            uint64_t next = prev + cur;
+            prev = cur;
+            cur = next;
+        }
+        return cur;
+    }
+
+    uint64_t fib_doubling(unsigned n) {
+        check_fib_n(n);
+        // a = F(k), b = F(k+1) for k the bits of n above the current one.
+        // F(k+1) of the last step may wrap, but only F(k) is returned.
+        uint64_t a = 0, b = 1;
+        int top = 31;
+        while (top > 0 && !((n >> top) & 1))
+            --top;
+        for (int bit = top; bit >= 0; --bit) {
+            uint64_t c = a * (2 * b - a);  // F(2k)
+            uint64_t d = a * a + b * b;    // F(2k+1)
+            if ((n >> bit) & 1) {
+                a = d;
+                b = c + d;
+            }
+            else {
+                a = c;
+                b = d;
+            }
+        }
+        return a;
+    }
+
+    ADT::BigUnsigned fib_big(unsigned n) {
+        if (n == 0)
+            return 0;
+        int top = 31;
+        while (!((n >> top) & 1))
+            --top;
+        ADT::BigUnsigned a = 1, b = 1;  // F(k), F(k+1) for k the bits of n from top
+        for (int bit = top - 1; bit > 0; --bit) {
+            ADT::BigUnsigned c = a * ((b << 1) - a);  // F(2k)
+            ADT::BigUnsigned d = a * a + b * b;       // F(2k+1)
+            if ((n >> bit) & 1) {
+                a = std::move(d);
+                b = a + c;
+            }
+            else {
+                a = std::move(c);
+                b = std::move(d);
+            }
+        }
+        if (top == 0)
+            return a;
+        // Last bit: only F(n) is needed.
+        return (n & 1) ? a * a + b * b : a * ((b << 1) - a);
+    }
+
+    bool WordReader::fill() {
+        m_in.read(m_buf.data(), m_buf.size());
+        m_pos = 0;
+        m_end = m_in.gcount();
+        return m_end > 0;
+    }
+
+    bool WordReader::read(string& text, vector<size_t>& prefix, bool paragraph) {
+        size_t start = prefix.size();
+        bool in_word = false;
+        unsigned newlines = 0;  // since the last word
+        while (m_pos < m_end || fill()) {
+            char c = m_buf[m_pos++];
+            if (!std::isspace(static_cast<unsigned char>(c))) {
+                text += c;
+                in_word = true;
+                newlines = 0;
+                continue;
+            }
+            if (in_word) {
+                text += ' ';
+                prefix.push_back(text.size());
+                in_word = false;
+            }
+            if (c == '\n' && ++newlines == 2 && paragraph && prefix.size() > start)
+                return true;  // blank line after the paragraph
+        }
+        if (in_word) {
+            text += ' ';
+            prefix.push_back(text.size());
+        }
+        return prefix.size() > start;
+    }
+
+    double justify_words(const vector<size_t>& prefix, unsigned page_width,
+                         vector<double>& dp, vector<unsigned>& parents) {
+        /*
+        ** Bottom-up: dp[i] = min over j of badness(i, j) + dp[j], with dp[n] = 0.
+        ** Widths only grow with j, so the scan stops at the first overflow.
+        */
+        size_t n = prefix.size() - 1;
+        dp.assign(n + 1, 0);
+        parents.assign(n, n);
+        for (size_t i = n; i-- > 0; ) {
+            double best = std::numeric_limits<double>::infinity();
+            size_t best_j = i + 1;
+            for (size_t j = i + 1; j <= n; ++j) {
+                size_t width = prefix[j] - prefix[i] - 1;
+                if (width > page_width) {
+                    if (j == i + 1)
+                        best = dp[j];  // word too wide for any line
+                    break;
+                }
+                double slack = page_width - width;
+                double cost = slack * slack * slack + dp[j];
+                if (cost < best) {
+                    best = cost;
+                    best_j = j;
+                }
+            }
+            dp[i] = best;
+            parents[i] = best_j;
+        }
+        return dp[0];
+    }
+
+    size_t justify_stream(std::istream& in, std::ostream& out, unsigned page_width) {
+        page_width = std::max(1U, page_width);
+        WordReader reader(in);
+        string text;
+        vector<size_t> prefix {0};
+        vector<double> dp;         // reused by every paragraph
+        vector<unsigned> parents;
+        size_t words = 0;
+        while (reader.read(text, prefix, true)) {
+            if (words > 0)
+                out.put('\n');
+            justify_words(prefix, page_width, dp, parents);
+            size_t n = prefix.size() - 1;
+            for (size_t i = 0; i < n; i = parents[i]) {
+                out.write(text.data() + prefix[i], prefix[parents[i]] - prefix[i] - 1);
+                out.put('\n');
+            }
+            words += n;
+            text.clear();
+            prefix.resize(1);
+        }
+        return words;
+    }
+
+    Document read_document(std::istream& in) {
+        Document doc;
+        WordReader reader(in);
+        reader.read(doc.text, doc.prefix, false);
+        return doc;
+    }
+
+    vector<vector<Justified>> justify_batch(const vector<Document>& docs,
+                                            const vector<unsigned>& page_widths,
+                                            ADT::thread_pool& pool) {
+        vector<vector<Justified>> result(docs.size(), vector<Justified>(page_widths.size()));
+        ADT::task_group tasks(pool);
+        for (size_t d = 0; d < docs.size(); ++d) {
+            for (size_t w = 0; w < page_widths.size(); ++w) {
+                tasks.run([&docs, &result, &page_widths, d, w] {
+                    // The tables are reused by the tasks of each thread.
+                    static thread_local vector<double> dp;
+                    static thread_local vector<unsigned> parents;
+                    Justified& out = result[d][w];
+                    out.page_width = std::max(1U, page_widths[w]);
+                    out.cost = justify_words(docs[d].prefix, out.page_width, dp, parents);
+                    size_t n = docs[d].size();
+                    out.breaks.clear();
+                    for (size_t i = 0; i < n; i = parents[i])
+                        out.breaks.push_back(i);
+                    out.breaks.push_back(n);
+                });
+            }
+        }
+        tasks.wait();
+        return result;
     }
 
     TextJustify::TextJustify(const string& text_file, unsigned page_width) {
@@ -51,59 +252,29 @@ namespace DP {
 
     void TextJustify::read_text(const string& text_file) {
         std::ifstream text {text_file};
-        string word;
-        while (text >> word)
-            m_words.push_back(word);
+        WordReader reader(text);
+        reader.read(m_text, m_prefix, false);
         m_dp.clear();
         m_parents.clear();
     }
 
-    double TextJustify::badness(unsigned i, unsigned j) {
-        /*
-        ** The cost function of how bad to use words[i, j] as a line.
-        ** Assume 0 <= i <= j <= n.
-        ** badness(i, j) = (page width - total width) ^ 3, if fit.
-        **              or INF, if don't fit.
-        */
-        unsigned total_width;
-        for (size_t idx = i; idx < j; idx++)
-            total_width += m_words[idx].length();
-        if (total_width > m_page_width)
-            return std::numeric_limits<double>::infinity();
-        else
-            return std::pow(m_page_width - total_width, 3); 
-    }
-
-    void TextJustify::justify(unsigned page_width=0) {
+    void TextJustify::justify(unsigned page_width) {
         /*
         ** Justify words by bottom-up dynamic programming table.
         ** Second line starts at j-th word, j is from 1 to n.
         */
-        if (m_words.empty())  // no text
+        if (size() == 0)  // no text
             return;
+        if (page_width == 0)
+            page_width = m_page_width;
         if (!m_dp.empty() and !m_parents.empty() and m_page_width == page_width)
             return;  // text has been justified
-        if (page_width != 0)
-            m_page_width = page_width;
-        unsigned n = m_words.size();
-        m_dp.clear();
-        m_dp.assign(n+1, std::numeric_limits<double>::infinity());  // index 0 to n
-        m_dp[n] = 0;  // base case
-        m_parents.clear();
-        m_parents.assign(n, n);  // parent pointers. possible values: 1 to n.
-        // solve subproblem from n-1 to 0.
-        for (int i = n-1; i >= 0; --i) {
-            vector<double> guesses;
-            for (size_t j = i+1; j <= n; ++j)
-                guesses.push_back(m_dp[j] + badness(i, j));
-            auto it_min = min_element(guesses.begin(), guesses.end());
-            m_dp[i] = *it_min;
-            m_parents[i] = i + 1 + (it_min - guesses.begin());
-        }
+        m_page_width = page_width;
+        justify_words(m_prefix, m_page_width, m_dp, m_parents);
     }
 
     void TextJustify::print_justified() {
-        if (m_words.empty()) {
+        if (size() == 0) {
             cout << "Empty Text." << endl;
             return;
         }
@@ -114,12 +285,10 @@ namespace DP {
         string justified;
         vector<double> cost;
         unsigned i = 0;
-        while (i < m_words.size()) {
+        while (i < size()) {
             unsigned j = m_parents[i];
-            std::ostringstream oss;
-            std::copy(m_words.begin() + i, m_words.begin() + j,
-                      std::ostream_iterator<string>(oss, " "));
-            justified += oss.str() + "\n";
+            justified.append(m_text, m_prefix[i], m_prefix[j] - m_prefix[i]);
+            justified += "\n";
             cost.push_back(m_dp[i]);
             i = j;
         }
@@ -131,80 +300,110 @@ namespace DP {
         cout << cost.back() << endl;
     }
 
-    int blackjack_dp(int i, vector<int>& deck) {
+    int blackjack_solve(const vector<int>& deck, vector<int>& best) {
         /*
-        ** After i cards played, find the max possible winnings by DP.
+        ** best[i] is the max winnings after i cards are played, filled from
+        ** the end of the shoe. The round starting at card i deals cards i
+        ** and i+2 to the player and i+1 and i+3 to the dealer. The player
+        ** hits p-2 times, then the dealer draws to 17 or more, so the next
+        ** round starts at card i+p+d for a dealer hand of d cards.
+        ** best[i] = max over p of the round's outcome + best[i+p+d].
+        ** Hands are running sums: each hit adds one card to the player's
+        ** total, and the dealer's hand is replayed only from its two cards.
+        ** Face cards count 10, and an ace 11 when that does not bust.
         */
-        int n = deck.size();
-        if (n - i < 4)
-            return 0;  // base case: not enough cards.
-        
-        vector<int> options;
-        for (int p = 2; p <= n-i-2; ++p) {  // Number of cards taken by player
-            // run player strategy
-            vector<int> player_cards;
-            player_cards.push_back(deck[i]);
-            player_cards.push_back(deck[i+2]);
-            for (int j = i+4; j < i + 2 + p; ++j)
-                player_cards.push_back(deck[j]);
-            int ace = std::count(player_cards.begin(), player_cards.end(), 1);
-            int player_score = std::accumulate(player_cards.begin(), player_cards.end(), 0);
-            // decide if ace is 1 or 11 for maximum score
-            while (ace > 0 && (21 - player_score) / 10 > 0) {
-                player_score += 10;
-                --ace;
-            }
-            
-            // player bust case
-            if (player_score > 21) {
-                options.push_back(-1 + blackjack_dp(i+2+2, deck));
-                break;
-            }
-
-            // run dealer strategy
-            int dealer_score;
-            int d;
-            for (d = 2; d <= n-i-p; ++d) {
-                vector<int> dealer_cards;
-                dealer_cards.push_back(deck[i+1]);
-                dealer_cards.push_back(deck[i+3]);
-                for (int j = i+p+2; j < i+p+d; ++j)
-                    dealer_cards.push_back(deck[j]);
-                dealer_score = std::accumulate(dealer_cards.begin(), dealer_cards.end(), 0);
-                dealer_score += 10 * std::count(dealer_cards.begin(), dealer_cards.end(), 1);
-                if (dealer_score >= 17)
+        auto value = [&deck](size_t k) { return std::min(deck[k], 10); };
+        auto score = [](int hard, bool ace) { return ace && hard <= 11 ? hard + 10 : hard; };
+        size_t n = deck.size();
+        best.assign(n + 1, 0);  // base case: not enough cards for a round
+        for (size_t i = n < 4 ? 0 : n - 4 + 1; i-- > 0; ) {
+            int player_hard = value(i) + value(i + 2);
+            bool player_ace = deck[i] == 1 || deck[i + 2] == 1;
+            int dealer_hard0 = value(i + 1) + value(i + 3);
+            bool dealer_ace0 = deck[i + 1] == 1 || deck[i + 3] == 1;
+            int options = std::numeric_limits<int>::min();
+            for (size_t p = 2; i + p + 2 <= n; ++p) {  // cards taken by player
+                if (p > 2) {
+                    player_hard += value(i + p + 1);
+                    player_ace |= deck[i + p + 1] == 1;
+                }
+                int player_score = score(player_hard, player_ace);
+                if (player_score > 21) {  // player bust, round ends
+                    options = std::max(options, -1 + best[i + p + 2]);
                     break;
+                }
+                // run dealer strategy
+                int dealer_hard = dealer_hard0;
+                bool dealer_ace = dealer_ace0;
+                size_t next = i + p + 2;  // next card to deal
+                while (score(dealer_hard, dealer_ace) < 17 && next < n) {
+                    dealer_hard += value(next);
+                    dealer_ace |= deck[next] == 1;
+                    ++next;
+                }
+                int dealer_score = score(dealer_hard, dealer_ace);
+                if (dealer_score > 21)  // dealer bust
+                    dealer_score = 0;
+                int profit_loss = (player_score > dealer_score) - (dealer_score > player_score);  // could be 0 for tie
+                options = std::max(options, profit_loss + best[next]);
             }
-            if (dealer_score > 21)  // dealer bust
-                dealer_score = 0;
-                
-            // compute recurrence
-            int profit_loss = (player_score > dealer_score) - (dealer_score > player_score);  // could be 0 for tie
-            options.push_back(profit_loss + blackjack_dp(i+p+d, deck));
+            best[i] = options;
         }
+        return best[0];
+    }
+
+    int blackjack_solve(const vector<int>& deck) {
+        vector<int> best;
+        return blackjack_solve(deck, best);
+    }
+
+    vector<int> blackjack_shoe(unsigned decks, std::mt19937_64& rng) {
+        vector<int> deck;
+        deck.reserve(52 * decks);
+        for (unsigned k = 0; k < decks; k++)
+            for (int suit = 0; suit < 4; suit++)
+                for (int i = 1; i < 14; i++)
+                    deck.push_back(i);
+        std::shuffle(deck.begin(), deck.end(), rng);
+        return deck;
+    }
 
-        return *std::max_element(options.begin(), options.end());
+    vector<BlackjackRun> blackjack_batch(size_t shoes, unsigned decks, uint64_t seed,
+                                         ADT::thread_pool& pool) {
+        vector<BlackjackRun> runs(shoes);
+        ADT::task_group tasks(pool);
+        for (size_t k = 0; k < shoes; ++k) {
+            tasks.run([&runs, decks, seed, k] {
+                static thread_local vector<int> best;
+                std::mt19937_64 rng(seed + k);
+                vector<int> deck = blackjack_shoe(decks, rng);
+                auto start = std::chrono::steady_clock::now();
+                runs[k].profit = blackjack_solve(deck, best);
+                runs[k].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            });
+        }
+        tasks.wait();
+        return runs;
     }
-    
-    void blackjack() {
+
+    void blackjack(unsigned decks) {
         /*
-        ** Perfect-information blackjack game, solved by recursive DP.
+        ** Perfect-information blackjack game, solved by bottom-up DP.
         */
-        vector<int> deck;
-        for (int suit = 0; suit < 4; suit++)
-            for (int i = 1; i < 14; i++)
-                deck.push_back(i);
-        std::srand(std::time(0));
-        std::random_shuffle(deck.begin(), deck.end());
+        std::mt19937_64 rng(std::random_device{}());
+        vector<int> deck = blackjack_shoe(std::max(1U, decks), rng);
         cout << "Deck:" << endl;
         for (auto const& card : deck)
             cout << card << ", ";
         cout << endl;
-        cout << "Max profit: " << blackjack_dp(0, deck) << endl;
+        cout << "Max profit: " << blackjack_solve(deck) << endl;
     }
 
 }
 
+
+#ifndef DP_NO_MAIN  // defined when dp.cc is built into a library, e.g. by CMake
+
 unsigned ask_fib_n() {
     unsigned n; 
     while (true) {
@@ -218,27 +417,147 @@ unsigned ask_fib_n() {
     return n;
 }
 
+void fib_benchmark(unsigned n) {
+    /*
+    ** Time every Fibonacci variant: the 64-bit ones at min(n, FIB_MAX_N),
+    ** the big integer one at n.
+    */
+    using clock = std::chrono::steady_clock;
+    unsigned m = std::min(n, DP::FIB_MAX_N);
+    auto per_call = [m](const char* name, uint64_t (*f)(unsigned)) {
+        constexpr int CALLS = 1000000;
+        volatile uint64_t sink = 0;
+        auto start = clock::now();
+        for (int k = 0; k < CALLS; ++k)
+            sink = sink + f(m - k % 2);
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / CALLS;
+        cout << name << "(" << m << ") = " << f(m) << ", " << ns << " ns/call" << endl;
+    };
+    per_call("Memoized fib", DP::fib);
+    per_call("Bottom-up fib", DP::fib_bottomup);
+    per_call("Fast doubling fib", DP::fib_doubling);
+
+    auto start = clock::now();
+    ADT::BigUnsigned f = DP::fib_big(n);
+    double sec = std::chrono::duration<double>(clock::now() - start).count();
+    cout << "Big integer fib(" << n << "): " << f.bits() << " bits, " << sec << " s" << endl;
+    if (f.bits() <= (1u << 20)) {  // decimal conversion is quadratic
+        string digits = f.to_string();
+        if (digits.size() > 60)
+            digits = digits.substr(0, 25) + "..." + digits.substr(digits.size() - 25)
+                     + " (" + std::to_string(digits.size()) + " digits)";
+        cout << "  = " << digits << endl;
+    }
+    if (DP::fib_big(m) != ADT::BigUnsigned(DP::fib_doubling(m)))
+        cout << "Mismatch between big integer and 64-bit results!" << endl;
+}
+
+void justify_benchmark(const string& text_file, unsigned docs) {
+    /*
+    ** Justify docs copies of the text, each repeated to 100k words or more,
+    ** at five page widths, sequentially and with justify_batch().
+    */
+    std::ifstream text {text_file};
+    DP::Document base = DP::read_document(text);
+    if (base.size() == 0) {
+        cout << "Empty Text." << endl;
+        return;
+    }
+    DP::Document doc;
+    while (doc.size() < 100000) {
+        for (size_t i = 1; i < base.prefix.size(); ++i)
+            doc.prefix.push_back(doc.text.size() + base.prefix[i]);
+        doc.text += base.text;
+    }
+    vector<DP::Document> corpus(std::max(1U, docs), doc);
+    vector<unsigned> page_widths {40, 60, 80, 100, 120};
+    double words = double(corpus.size()) * doc.size() * page_widths.size();
+
+    auto report = [words](const char* name, std::chrono::steady_clock::duration t) {
+        double sec = std::chrono::duration<double>(t).count();
+        cout << name << ": " << sec << " s, " << words / sec / 1e6 << " Mwords/s" << endl;
+    };
+    cout << corpus.size() << " documents of " << doc.size() << " words at "
+         << page_widths.size() << " page widths" << endl;
+
+    auto start = std::chrono::steady_clock::now();
+    vector<double> dp;
+    vector<unsigned> parents;
+    for (auto const& d : corpus)
+        for (unsigned w : page_widths)
+            DP::justify_words(d.prefix, w, dp, parents);
+    report("sequential", std::chrono::steady_clock::now() - start);
+
+    ADT::thread_pool pool;
+    start = std::chrono::steady_clock::now();
+    DP::justify_batch(corpus, page_widths, pool);
+    report("justify_batch", std::chrono::steady_clock::now() - start);
+    cout << "(" << pool.size() << " threads)" << endl;
+}
+
+void blackjack_benchmark(size_t shoes, unsigned decks) {
+    /*
+    ** Solve shoes shuffled shoes of decks decks on a thread pool and report
+    ** how long each shoe took.
+    */
+    shoes = std::max<size_t>(1, shoes);
+    decks = std::max(1U, decks);
+    ADT::thread_pool pool;
+    auto start = std::chrono::steady_clock::now();
+    auto runs = DP::blackjack_batch(shoes, decks, 1, pool);
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    vector<double> seconds;
+    double profit = 0;
+    for (auto const& run : runs) {
+        seconds.push_back(run.seconds);
+        profit += run.profit;
+    }
+    std::sort(seconds.begin(), seconds.end());
+    cout << shoes << " shoes of " << decks << " decks on " << pool.size() << " threads: "
+         << total << " s, " << shoes / total << " shoes/s" << endl;
+    cout << "Per shoe: min " << seconds.front() * 1e6 << " us, median "
+         << seconds[seconds.size() / 2] * 1e6 << " us, max " << seconds.back() * 1e6 << " us" << endl;
+    cout << "Mean max profit: " << profit / shoes << endl;
+}
+
 int main(int argc, char** argv) {
     cout << endl;
-    auto test_n = std::strtol(argv[1], nullptr, 10);
-    if (argc <= 1 || test_n < 0 || test_n > 3) {
-        cout << "Select a test between 0 and 3 as the argument." << endl;
-        cout << "0 - Fibonacci recusive and memoizing." << endl;
+    auto test_n = argc > 1 ? std::strtol(argv[1], nullptr, 10) : -1;
+    if (test_n < 0 || test_n > 7) {
+        cout << "Select a test between 0 and 7 as the argument." << endl;
+        cout << "0 - Fibonacci memoizing." << endl;
         cout << "1 - Fibonacci bottom up." << endl;
         cout << "2 - Text justificaiton." << endl;
-        cout << "3 - Blackjack." << endl << endl;
+        cout << "3 - Blackjack: 3 [decks]." << endl;
+        cout << "4 - Text justification, streamed by paragraph: 4 [file] [page width]." << endl;
+        cout << "5 - Batch text justification benchmark: 5 [file] [documents]." << endl;
+        cout << "6 - Blackjack benchmark: 6 [shoes] [decks]." << endl;
+        cout << "7 - Fibonacci benchmark of every variant: 7 [n]." << endl << endl;
         return 0;
     }
 
     switch (test_n) {
         case 0: {
             unsigned n = ask_fib_n();
-            cout << "Recursive fib(" << n << ") = " << DP::fib(n) << endl;
+            try {
+                uint64_t f = DP::fib(n);
+                cout << "Memoized fib(" << n << ") = " << f << endl;
+            }
+            catch (const ADT::Overflow& e) {
+                cout << e.what() << endl;
+            }
             break;
         }
         case 1: {
             unsigned n = ask_fib_n();
-            cout << "Bottom-up fib(" << n << ") = " << DP::fib_bottomup(n) << endl;
+            try {
+                uint64_t f = DP::fib_bottomup(n);
+                cout << "Bottom-up fib(" << n << ") = " << f << endl;
+            }
+            catch (const ADT::Overflow& e) {
+                cout << e.what() << endl;
+            }
             break;
         }
         case 2: {
@@ -248,7 +567,27 @@ int main(int argc, char** argv) {
             break;
         }
         case 3:
-            DP::blackjack();
+            DP::blackjack(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1);
+            break;
+        case 4: {
+            std::ifstream text {argc > 2 ? argv[2] : "news.txt"};
+            unsigned page_width = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 80;
+            DP::justify_stream(text, cout, page_width);
+            break;
+        }
+        case 5:
+            justify_benchmark(argc > 2 ? argv[2] : "news.txt",
+                              argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 16);
+            break;
+        case 6:
+            blackjack_benchmark(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000,
+                                argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 6);
+            break;
+        case 7:
+            fib_benchmark(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : ask_fib_n());
+            break;
     }
     return 0;
 }
+
+#endif // DP_NO_MAIN
@@ -5,33 +5,139 @@
 #ifndef __DP_H_
 #define __DP_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <random>
 #include <string>
+#include <string_view>
 #include <vector>
+#include "bigint.hh"
+#include "thread_pool.hh"
 
 namespace DP {
-    // Recursive DP & memoizing to compute Fibonacci numbers.
-    unsigned fib(unsigned n);
+    // Largest n whose Fibonacci number fits in 64 bits. The 64-bit
+    // versions throw ADT::Overflow above it.
+    constexpr unsigned FIB_MAX_N = 93;
+
+    // Memoizing to compute Fibonacci numbers. The memo is shared by all
+    // threads and grows in place up to FIB_MAX_N.
+    std::uint64_t fib(unsigned n);
 
     // Bottom-up DP to compute Fibonacci numbers.
-    unsigned fib_bottomup(unsigned n);
+    std::uint64_t fib_bottomup(unsigned n);
+
+    // Fast doubling, O(log n):
+    // F(2k) = F(k) (2 F(k+1) - F(k)), F(2k+1) = F(k)^2 + F(k+1)^2.
+    std::uint64_t fib_doubling(unsigned n);
+
+    // Fast doubling on big integers, for any n. Dominated by the last
+    // products, which are Karatsuba multiplications of n * 0.69 / 32 limbs.
+    ADT::BigUnsigned fib_big(unsigned n);
+
+    // Reads whitespace separated words from a stream in fixed size chunks.
+    // Words are appended to a text buffer, each followed by one space, and
+    // their end offsets to a prefix array: starting from prefix[0] == 0, word
+    // k is text[prefix[k], prefix[k+1] - 1), and prefix[j] - prefix[i] - 1 is
+    // the width of words [i, j) set on one line. Widths are in bytes.
+    class WordReader {
+        public:
+            static constexpr size_t CHUNK_SIZE = 1 << 16;
+
+            explicit WordReader(std::istream& in) : m_in{in}, m_buf(CHUNK_SIZE) {}
+            // Append the words up to the next blank line, or up to the end of
+            // the input if !paragraph. Returns false if there were none left.
+            bool read(std::string& text, std::vector<size_t>& prefix, bool paragraph);
+        private:
+            bool fill();
+            std::istream& m_in;
+            std::vector<char> m_buf;
+            size_t m_pos = 0;
+            size_t m_end = 0;
+    };
+
+    // Line breaks of least total badness for the words of a prefix array as
+    // above, badness being the cube of a line's free columns. parents[i] is
+    // the word after the line starting at word i, dp[i] the cost of words
+    // [i, n). A line stops at the first word that does not fit, so this is
+    // O(n * w) for at most w words per line. A word wider than the page gets
+    // a line of its own at no cost. Returns dp[0].
+    double justify_words(const std::vector<size_t>& prefix, unsigned page_width,
+                         std::vector<double>& dp, std::vector<unsigned>& parents);
+
+    // Justify the text of in paragraph by paragraph, paragraphs being
+    // separated by blank lines, and write it to out. Only one paragraph is
+    // held at a time. Returns the number of words.
+    size_t justify_stream(std::istream& in, std::ostream& out, unsigned page_width);
+
+    // Tokenized text, shared by every page width it is justified at.
+    struct Document {
+        std::string text;               // words, see WordReader
+        std::vector<size_t> prefix {0};
+
+        size_t size() const { return prefix.size() - 1; }
+        // Words [i, j) separated by single spaces.
+        std::string_view words(size_t i, size_t j) const {
+            return std::string_view(text).substr(prefix[i], prefix[j] - prefix[i] - 1);
+        }
+    };
+
+    // Every word of in as one Document.
+    Document read_document(std::istream& in);
+
+    // Line breaks of a Document at one page width. Line k is words
+    // [breaks[k], breaks[k+1]); breaks.back() is the number of words.
+    struct Justified {
+        unsigned page_width;
+        double cost;
+        std::vector<unsigned> breaks;
+    };
+
+    // Justify every document at every page width, one task per pair on
+    // pool. result[d][w] is docs[d] at page_widths[w].
+    std::vector<std::vector<Justified>> justify_batch(const std::vector<Document>& docs,
+                                                      const std::vector<unsigned>& page_widths,
+                                                      ADT::thread_pool& pool);
 
     // Split text (list of words) into lines with DP.
     class TextJustify {
         public:
             TextJustify(const std::string& text_file, unsigned page_width=1);
             void read_text(const std::string& text_file);
-            void justify(unsigned page_width);
+            void justify(unsigned page_width=0);
             void print_justified();
         private:
+            size_t size() const { return m_prefix.size() - 1; }
             unsigned m_page_width;
-            double badness(unsigned i, unsigned j);
-            std::vector<std::string> m_words;
+            std::string m_text;                     // words, see WordReader
+            std::vector<size_t> m_prefix {0};
             std::vector<double> m_dp;
             std::vector<unsigned> m_parents;
     };
 
+    // Max winnings over a shoe of the player who knows the order of every
+    // card, and so picks how many cards to take each round. deck holds
+    // card ranks from 1 (ace) to 13 in dealing order. best is the DP table,
+    // kept by the caller to be reused.
+    int blackjack_solve(const std::vector<int>& deck, std::vector<int>& best);
+    int blackjack_solve(const std::vector<int>& deck);
+
+    // A shoe of `decks` 52-card decks, shuffled with rng.
+    std::vector<int> blackjack_shoe(unsigned decks, std::mt19937_64& rng);
+
+    struct BlackjackRun {
+        int profit;
+        double seconds;  // to solve this shoe
+    };
+
+    // Solve `shoes` shoes of `decks` decks, one task per shoe on pool.
+    // Shoe k is shuffled with seed + k, so runs are reproducible.
+    std::vector<BlackjackRun> blackjack_batch(size_t shoes, unsigned decks, uint64_t seed,
+                                              ADT::thread_pool& pool);
+
     // Perfect-information blackjack game, solved by DP.
-    void blackjack();
+    void blackjack(unsigned decks=1);
             
 }
 
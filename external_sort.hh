@@ -0,0 +1,432 @@
+/*
+** External merge sort of fixed-size binary records, for files larger than RAM.
+**
+**     struct Entry { uint64_t time; char line[120]; };
+**     SORT::external_sort_options opt;
+**     opt.memory_bytes = size_t(8) << 30;                  // 8 GB budget
+**     SORT::external_sort<Entry>("logs.bin", "sorted.bin", opt, {}, &Entry::time);
+**
+** Run formation streams the input in chunks as large as the memory budget.
+** Each chunk is sorted in memory with SORT::sort, or SORT::parallel_sort when
+** a pool is given, and spilled to an unnamed temp file. parallel_sort merges
+** through a buffer as large as the chunk, so with a pool the chunks are half
+** the budget. Runs are then merged
+** up to fan_in at a time through a loser tree, which finds the next record
+** with log2(k) comparisons against the stored losers and no sift down. Every
+** run is read through two aligned blocks: while the merge consumes one, the
+** next is read into the other by a pool task, so the merge waits on the disk
+** only when it outruns it. Passes repeat until one run is left, which goes
+** to the output file.
+**
+** Records are copied with read(2)/write(2), so T must be trivially copyable
+** and the input size a multiple of sizeof(T). Equal records come out in no
+** particular order. Errors from the OS are thrown as std::system_error.
+** POSIX only.
+*/
+
+
+#ifndef __EXTERNAL_SORT_H_
+#define __EXTERNAL_SORT_H_
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "sorting.hh"
+#include "parallel_sort.hh"
+#include "thread_pool.hh"
+
+
+namespace SORT {
+
+    struct external_sort_options {
+        size_t memory_bytes = size_t(256) << 20;  // budget for records in memory
+        size_t block_bytes = size_t(1) << 20;     // one read or write buffer
+        std::string temp_dir;                     // empty: $TMPDIR, else /tmp
+        ADT::thread_pool* pool = nullptr;         // sorts runs and prefetches; null: a private I/O thread
+    };
+
+
+    namespace detail {
+
+        constexpr size_t IO_ALIGNMENT = 4096;
+
+        [[noreturn]] inline void throw_errno(const std::string& what) {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        // Owned file descriptor with full-length positional reads and writes.
+        class file {
+            public:
+                file() = default;
+                explicit file(int fd) : m_fd{fd} {}
+                file(const std::string& path, int flags, mode_t mode = 0644)
+                    : m_fd{::open(path.c_str(), flags | O_CLOEXEC, mode)} {
+                    if (m_fd < 0)
+                        throw_errno("open " + path);
+                }
+                file(file&& f) noexcept : m_fd{std::exchange(f.m_fd, -1)} {}
+                file& operator=(file&& f) noexcept {
+                    std::swap(m_fd, f.m_fd);
+                    return *this;
+                }
+                ~file() {
+                    if (m_fd >= 0)
+                        ::close(m_fd);
+                }
+
+                // An unnamed file in dir, removed when closed.
+                static file temporary(const std::string& dir) {
+                    std::string path = dir + "/adt-sort-XXXXXX";
+                    int fd = ::mkstemp(&path[0]);
+                    if (fd < 0)
+                        throw_errno("mkstemp " + path);
+                    ::unlink(path.c_str());
+                    return file(fd);
+                }
+
+                size_t size() const {
+                    struct stat st;
+                    if (::fstat(m_fd, &st) < 0)
+                        throw_errno("fstat");
+                    return size_t(st.st_size);
+                }
+
+                // Read n bytes at offset; fewer only at the end of the file.
+                size_t read_at(void* buf, size_t n, size_t offset) const {
+                    size_t done = 0;
+                    while (done < n) {
+                        ssize_t r = ::pread(m_fd, static_cast<char*>(buf) + done, n - done, off_t(offset + done));
+                        if (r < 0 && errno == EINTR)
+                            continue;
+                        if (r < 0)
+                            throw_errno("pread");
+                        if (r == 0)
+                            break;
+                        done += size_t(r);
+                    }
+                    return done;
+                }
+
+                // Read exactly n bytes at offset. The file was sized before
+                // sorting began, so a short read means it shrank meanwhile.
+                void read_all(void* buf, size_t n, size_t offset) const {
+                    if (read_at(buf, n, offset) != n)
+                        throw std::runtime_error("short read: file truncated while being sorted");
+                }
+
+                // Whether path names this file, also through another link.
+                bool is(const std::string& path) const {
+                    struct stat mine, other;
+                    if (::fstat(m_fd, &mine) < 0)
+                        throw_errno("fstat");
+                    if (::stat(path.c_str(), &other) < 0)
+                        return false;
+                    return mine.st_dev == other.st_dev && mine.st_ino == other.st_ino;
+                }
+
+                void write_at(const void* buf, size_t n, size_t offset) const {
+                    size_t done = 0;
+                    while (done < n) {
+                        ssize_t r = ::pwrite(m_fd, static_cast<const char*>(buf) + done, n - done, off_t(offset + done));
+                        if (r < 0 && errno == EINTR)
+                            continue;
+                        if (r < 0)
+                            throw_errno("pwrite");
+                        done += size_t(r);
+                    }
+                }
+
+            private:
+                int m_fd = -1;
+        };
+
+        // Uninitialized, page aligned array of n records.
+        template <typename T>
+        struct aligned_block {
+            struct release {
+                void operator()(T* p) const { ::operator delete(p, std::align_val_t(IO_ALIGNMENT)); }
+            };
+            explicit aligned_block(size_t n)
+                : data{static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(IO_ALIGNMENT)))} {}
+            std::unique_ptr<T, release> data;
+        };
+
+        // A sorted run: count records at offset in a file.
+        struct run {
+            std::shared_ptr<file> f;
+            size_t offset;
+            size_t count;
+        };
+
+        // Appends records to a file through one block.
+        template <typename T>
+        class run_writer {
+            public:
+                run_writer(const file& f, size_t offset, size_t block)
+                    : m_file{f}, m_offset{offset}, m_block{block}, m_buf{block} {}
+                void push(const T& x) {
+                    m_buf.data.get()[m_len++] = x;
+                    if (m_len == m_block)
+                        flush();
+                }
+                void flush() {
+                    m_file.write_at(m_buf.data.get(), m_len * sizeof(T), m_offset);
+                    m_offset += m_len * sizeof(T);
+                    m_len = 0;
+                }
+            private:
+                const file& m_file;
+                size_t m_offset;
+                size_t m_block;
+                aligned_block<T> m_buf;
+                size_t m_len = 0;
+        };
+
+        // Reads one run through two blocks, one being consumed and one being
+        // filled by a task on the pool.
+        template <typename T>
+        class run_reader {
+            public:
+                run_reader(const run& r, size_t block, ADT::thread_pool& pool)
+                    : m_run{r}, m_block{block}, m_cur{block}, m_next{block}, m_prefetch{pool} {
+                    m_len = read(m_cur.data.get());
+                    prefetch();
+                }
+                run_reader(const run_reader&) = delete;
+                run_reader& operator=(const run_reader&) = delete;
+
+                bool done() const { return m_pos == m_len; }
+                const T& head() const { return m_cur.data.get()[m_pos]; }
+                void pop() {
+                    if (++m_pos == m_len && m_len != 0) {
+                        m_prefetch.wait();
+                        std::swap(m_cur, m_next);
+                        m_len = m_next_len;
+                        m_pos = 0;
+                        if (m_len != 0)
+                            prefetch();
+                    }
+                }
+
+            private:
+                // Read the next block of the run into buf; returns the record count.
+                size_t read(T* buf) {
+                    size_t n = m_run.count - m_read;
+                    if (n > m_block)
+                        n = m_block;
+                    m_run.f->read_all(buf, n * sizeof(T), m_run.offset + m_read * sizeof(T));
+                    m_read += n;
+                    return n;
+                }
+                void prefetch() {
+                    m_next_len = 0;
+                    if (m_read < m_run.count)
+                        m_prefetch.run([this] { m_next_len = read(m_next.data.get()); });
+                }
+
+                run m_run;
+                size_t m_block;
+                size_t m_read = 0;  // records of the run read so far
+                aligned_block<T> m_cur;
+                aligned_block<T> m_next;
+                size_t m_len = 0;
+                size_t m_pos = 0;
+                size_t m_next_len = 0;
+                ADT::task_group m_prefetch;  // last, so it is joined before the blocks go
+        };
+
+        template <typename Source, typename Less>
+        class loser_tree {
+            /*
+            ** Tournament tree over k sources, Knuth 5.4.1. Leaves k..2k-1 stand
+            ** for the sources; each inner node 1..k-1 keeps the index of the
+            ** loser of the match played there and node 0 the overall winner.
+            ** When the winner advances, only the matches on its leaf-to-root
+            ** path are replayed. An exhausted source loses every match.
+            */
+            public:
+                loser_tree(std::vector<Source*> sources, Less& less)
+                    : m_src{std::move(sources)}, m_less{less}, m_tree(m_src.size() ? m_src.size() : 1) {
+                    if (!m_src.empty())
+                        m_tree[0] = build(1);
+                }
+
+                bool empty() const { return m_src.empty() || m_src[m_tree[0]] -> done(); }
+                Source& top() { return *m_src[m_tree[0]]; }
+
+                // Restore the tree after top() advanced.
+                void replay() {
+                    size_t k = m_src.size();
+                    size_t w = m_tree[0];
+                    for (size_t n = (w + k) / 2; n > 0; n /= 2)
+                        if (beats(m_tree[n], w))
+                            std::swap(m_tree[n], w);
+                    m_tree[0] = w;
+                }
+
+            private:
+                bool beats(size_t a, size_t b) {
+                    if (m_src[a] -> done())
+                        return false;
+                    if (m_src[b] -> done())
+                        return true;
+                    return m_less(m_src[a] -> head(), m_src[b] -> head());
+                }
+
+                // Play the matches below node; returns the winner.
+                size_t build(size_t node) {
+                    size_t k = m_src.size();
+                    if (node >= k)
+                        return node - k;
+                    size_t a = build(2 * node);
+                    size_t b = build(2 * node + 1);
+                    if (beats(b, a))
+                        std::swap(a, b);
+                    m_tree[node] = b;
+                    return a;
+                }
+
+                std::vector<Source*> m_src;
+                Less& m_less;
+                std::vector<size_t> m_tree;
+        };
+
+        // Merge runs into out at offset; returns the run written.
+        template <typename T, typename Less>
+        run merge_runs(const run* first, const run* last, std::shared_ptr<file> out, size_t offset,
+                       size_t block, Less& less, ADT::thread_pool& pool) {
+            std::vector<std::unique_ptr<run_reader<T>>> readers;
+            std::vector<run_reader<T>*> sources;
+            size_t count = 0;
+            for (const run* r = first; r != last; ++r) {
+                readers.emplace_back(new run_reader<T>(*r, block, pool));
+                sources.push_back(readers.back().get());
+                count += r -> count;
+            }
+            run_writer<T> writer(*out, offset, block);
+            loser_tree<run_reader<T>, Less> tree(std::move(sources), less);
+            while (!tree.empty()) {
+                writer.push(tree.top().head());
+                tree.top().pop();
+                tree.replay();
+            }
+            writer.flush();
+            return {std::move(out), offset, count};
+        }
+
+        inline std::string temp_dir(const external_sort_options& opt) {
+            if (!opt.temp_dir.empty())
+                return opt.temp_dir;
+            const char* env = std::getenv("TMPDIR");
+            return env && *env ? env : "/tmp";
+        }
+
+    }  // end of namespace detail
+
+
+    template <typename T, typename Comp = std::less<>, typename Proj = identity>
+    size_t external_sort(const std::string& input, const std::string& output,
+                         const external_sort_options& opt = external_sort_options(),
+                         Comp comp = Comp(), Proj proj = Proj()) {
+        /*
+        ** Sort the records of input into output, which is created or
+        ** truncated and must not be input itself. Returns the number of
+        ** records. Peak memory is about opt.memory_bytes plus one block, or
+        ** five blocks for budgets under that, with or without opt.pool; temp
+        ** space is twice the input while a merge pass runs.
+        */
+        static_assert(std::is_trivially_copyable<T>::value, "external_sort needs trivially copyable records");
+        using detail::file;
+        using detail::run;
+
+        size_t block = opt.block_bytes / sizeof(T);
+        if (block == 0)
+            block = 1;
+        // parallel_sort needs a buffer of the chunk's size.
+        size_t chunk = opt.memory_bytes / sizeof(T) / (opt.pool ? 2 : 1);
+        if (chunk < block)
+            chunk = block;
+        // Each merge input holds two blocks, and the output one.
+        size_t budget_blocks = opt.memory_bytes / (block * sizeof(T));
+        size_t fan_in = budget_blocks > 1 ? (budget_blocks - 1) / 2 : 0;
+        if (fan_in < 2)
+            fan_in = 2;
+
+        std::unique_ptr<ADT::thread_pool> own_pool;
+        ADT::thread_pool* pool = opt.pool;
+        if (!pool) {
+            own_pool.reset(new ADT::thread_pool(1));
+            pool = own_pool.get();
+        }
+        auto less = detail::make_less(std::move(comp), std::move(proj));
+        auto sort_chunk = [&](T* first, T* last) {
+            if (opt.pool)
+                detail::parallel_sort(first, last, less, detail::pdqsort_kernel(), *pool, 0);
+            else
+                detail::pdqsort_kernel()(first, last, less);
+        };
+
+        file in(input, O_RDONLY);
+        size_t bytes = in.size();
+        if (bytes % sizeof(T))
+            throw std::invalid_argument(input + ": size is not a multiple of the record size");
+        size_t n = bytes / sizeof(T);
+        // Truncating the output would empty the input before it is read.
+        if (in.is(output))
+            throw std::invalid_argument(output + ": output is the input file");
+        auto out = std::make_shared<file>(output, O_WRONLY | O_CREAT | O_TRUNC);
+
+        if (n == 0)
+            return 0;
+
+        // Run formation. Input that fits the budget is sorted straight to output.
+        std::string dir = detail::temp_dir(opt);
+        std::vector<run> runs;
+        {
+            detail::aligned_block<T> buf(n < chunk ? n : chunk);
+            T* p = buf.data.get();
+            for (size_t done = 0; done < n; ) {
+                size_t m = n - done < chunk ? n - done : chunk;
+                in.read_all(p, m * sizeof(T), done * sizeof(T));
+                sort_chunk(p, p + m);
+                auto f = m == n ? out : std::make_shared<file>(file::temporary(dir));
+                f -> write_at(p, m * sizeof(T), 0);
+                runs.push_back({f, 0, m});
+                done += m;
+            }
+            if (runs.size() == 1)
+                return n;
+        }
+
+        // Merge passes, each writing one temp file, until one pass can finish.
+        while (runs.size() > fan_in) {
+            auto f = std::make_shared<file>(file::temporary(dir));
+            std::vector<run> merged;
+            size_t offset = 0;
+            for (size_t i = 0; i < runs.size(); i += fan_in) {
+                size_t j = i + fan_in < runs.size() ? i + fan_in : runs.size();
+                merged.push_back(detail::merge_runs<T>(runs.data() + i, runs.data() + j, f, offset,
+                                                       block, less, *pool));
+                offset += merged.back().count * sizeof(T);
+            }
+            runs.swap(merged);
+        }
+        detail::merge_runs<T>(runs.data(), runs.data() + runs.size(), out, 0, block, less, *pool);
+        return n;
+    }
+
+}  // end of namespace SORT
+
+
+#endif // __EXTERNAL_SORT_H_
@@ -0,0 +1,480 @@
+#ifndef __FLAT_HASH_MAP_H_
+#define __FLAT_HASH_MAP_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <iterator>
+#include "hash.hh"
+#include "probe_group.hh"
+#include "map_stats.hh"
+
+namespace ADT {
+
+
+/*
+** Open addressing hash map with flat storage.
+** Key/value pairs live in one contiguous slot array next to a control byte array
+** holding one byte of metadata per slot: EMPTY, DELETED, or for a full slot the top
+** 7 bits of the 64-bit key hash (h2). Probing only reads the key of a slot whose control
+** byte matches h2, so a lookup touches about one slot. No allocation per insert.
+** Same element access, lookup and iterator interface as ADT::unordered_map.
+**
+** Probing is Swiss table style: slots are split into groups of Group::width
+** (probe_group.hh), and each probe step compares the h2 tag against a whole
+** group of control bytes with SIMD. Groups are visited in triangular order.
+**
+** Stats = map_stats counts lookups, the groups they probe, and rehashes
+** (map_stats.hh). A transparent Hash enables the same lookups by other key
+** types as in ADT::unordered_map.
+*/
+template <typename K, typename V, typename Hash = hasher<K>, typename Stats = no_stats>
+class flat_hash_map : private Stats {
+    template <bool Const> class basic_iterator;
+
+    public:
+        using T = std::pair<K, V>;
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        explicit flat_hash_map(const Hash& hash = Hash()) : m_hash{hash} {}
+        flat_hash_map(const flat_hash_map& m);
+        flat_hash_map(flat_hash_map&& m) noexcept { swap(*this, m); }
+        flat_hash_map& operator=(flat_hash_map m) { swap(*this, m); return *this; }
+        virtual ~flat_hash_map() { destroy(); }
+
+        friend void swap(flat_hash_map& a, flat_hash_map& b) noexcept {
+            std::swap(a.m_ctrl, b.m_ctrl);
+            std::swap(a.m_slots, b.m_slots);
+            std::swap(a.m_capacity, b.m_capacity);
+            std::swap(a.m_size, b.m_size);
+            std::swap(a.m_growth_left, b.m_growth_left);
+            std::swap(a.m_hash, b.m_hash);
+            std::swap(static_cast<Stats&>(a), static_cast<Stats&>(b));
+        }
+
+        // iterator
+        iterator begin() { return iterator(this, 0); }
+        iterator end() { return iterator(this, m_capacity); }
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, m_capacity); }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
+
+        // Capacity
+        bool empty() const noexcept { return m_size == 0; }
+        size_t size() const noexcept { return m_size; }
+        size_t bucket_count() const noexcept { return m_capacity; }
+
+        // Statistics
+        hash_map_stats stats() const;
+        void reset_stats() { static_cast<Stats&>(*this) = Stats(); }
+
+    private:
+        // Enables the overloads for a key type Q other than K.
+        template <typename Q, typename R = void>
+        using if_transparent = typename std::enable_if<is_transparent_hash<Hash>::value &&
+                                                       !std::is_same<typename std::decay<Q>::type, K>::value, R>::type;
+
+    public:
+        // Element access
+        V& operator[](const K& key) { return emplace_key(key).first -> second; }
+        V& operator[](K&& key) { return emplace_key(std::move(key)).first -> second; }
+
+        // Element lookup. The const overloads are not counted by Stats.
+        iterator find(const K& key) { return find_key(key); }
+        template <typename Q, typename = if_transparent<Q>>
+        iterator find(const Q& key) { return find_key(key); }
+        const_iterator find(const K& key) const { return const_iterator(this, probe(key, m_hash(key))); }
+        template <typename Q, typename = if_transparent<Q>>
+        const_iterator find(const Q& key) const { return const_iterator(this, probe(key, m_hash(key))); }
+        bool contains(const K& key) const { return probe(key, m_hash(key)) != m_capacity; }
+        template <typename Q, typename = if_transparent<Q>>
+        bool contains(const Q& key) const { return probe(key, m_hash(key)) != m_capacity; }
+
+        // Modifiers
+        void insert(const T& p) { (*this)[p.first] = p.second; }
+        // Insert key with V(args...) unless key is in the map, in which case
+        // neither key nor args are touched. The bool tells if it inserted.
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+            return emplace_key(key, std::forward<Args>(args)...);
+        }
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+            return emplace_key(std::move(key), std::forward<Args>(args)...);
+        }
+        template <typename Q, typename... Args>
+        if_transparent<Q, std::pair<iterator, bool>> try_emplace(Q&& key, Args&&... args) {
+            return emplace_key(std::forward<Q>(key), std::forward<Args>(args)...);
+        }
+        // Assign obj to the value of key, inserting key if it is missing.
+        template <typename M>
+        std::pair<iterator, bool> insert_or_assign(const K& key, M&& obj) {
+            return assign_key(key, std::forward<M>(obj));
+        }
+        template <typename M>
+        std::pair<iterator, bool> insert_or_assign(K&& key, M&& obj) {
+            return assign_key(std::move(key), std::forward<M>(obj));
+        }
+        template <typename Q, typename M>
+        if_transparent<Q, std::pair<iterator, bool>> insert_or_assign(Q&& key, M&& obj) {
+            return assign_key(std::forward<Q>(key), std::forward<M>(obj));
+        }
+        size_t erase(const K& key) { return erase_key(key); }
+        template <typename Q, typename = if_transparent<Q>>
+        size_t erase(const Q& key) { return erase_key(key); }
+        void clear();
+
+    private:
+        static constexpr ctrl_t EMPTY = CTRL_EMPTY;
+        static constexpr ctrl_t DELETED = CTRL_DELETED;
+        static bool is_full(ctrl_t c) { return ctrl_is_full(c); }
+
+        // power of 2, and a whole number of groups
+        static constexpr size_t m_init_capacity = Group::width < 16 ? 16 : Group::width;
+        // Slots usable before growing: 7/8 of capacity.
+        static size_t max_size_for(size_t cap) { return cap - cap / 8; }
+
+        ctrl_t* m_ctrl = nullptr;
+        T* m_slots = nullptr;
+        size_t m_capacity = 0;  // number of slots, 0 or a power of 2 >= Group::width
+        size_t m_size = 0;
+        size_t m_growth_left = 0;  // EMPTY slots that can still be filled before rehash
+        Hash m_hash;
+
+        // supporting methods
+        // Low bits pick the first group, top 7 bits are the tag.
+        static size_t h1(hash_t h) { return static_cast<size_t>(h); }
+        static ctrl_t h2(hash_t h) { return static_cast<ctrl_t>(h >> 57); }
+        template <typename Q>
+        size_t probe(const Q& key, hash_t h, size_t& groups) const;
+        template <typename Q>
+        size_t probe(const Q& key, hash_t h) const {
+            size_t groups;
+            return probe(key, h, groups);
+        }
+        // probe, counted by Stats.
+        template <typename Q>
+        size_t find_slot(const Q& key, hash_t h) {
+            size_t groups;
+            size_t i = probe(key, h, groups);
+            Stats::on_lookup(i != m_capacity, groups);
+            return i;
+        }
+        size_t find_insert_slot(hash_t h) const;
+        size_t prepare_insert(hash_t h);
+        template <typename Q>
+        iterator find_key(const Q& key) { return iterator(this, find_slot(key, m_hash(key))); }
+        template <typename Q, typename... Args>
+        std::pair<iterator, bool> emplace_key(Q&& key, Args&&... args);
+        template <typename Q, typename M>
+        std::pair<iterator, bool> assign_key(Q&& key, M&& obj);
+        template <typename Q>
+        size_t erase_key(const Q& key);
+        void set_ctrl(size_t i, ctrl_t c) { m_ctrl[i] = c; }
+        void allocate(size_t cap);
+        void destroy();
+        void rehash(size_t new_cap);
+
+        template <bool Const>
+        class basic_iterator {
+            /*
+            ** Forward iterator over the full slots, in slot order. An
+            ** iterator converts to a const_iterator.
+             */
+            using map_ptr = typename std::conditional<Const, const flat_hash_map*, flat_hash_map*>::type;
+
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = typename std::conditional<Const, const T*, T*>::type;
+                using reference = typename std::conditional<Const, const T&, T&>::type;
+
+                basic_iterator() = default;
+                basic_iterator(map_ptr fm, size_t idx) : m_fm{fm}, m_idx{idx} { skip_empty(); }
+                template <bool C = Const, typename = typename std::enable_if<C>::type>
+                basic_iterator(const basic_iterator<false>& it) : m_fm{it.m_fm}, m_idx{it.m_idx} {}
+
+                basic_iterator& operator++() {
+                    ++m_idx;
+                    skip_empty();
+                    return *this;
+                }
+
+                basic_iterator operator++(int) {
+                    basic_iterator old(*this);
+                    operator++();
+                    return old;
+                }
+
+                bool operator==(const basic_iterator& it) const {
+                    return m_fm == it.m_fm && m_idx == it.m_idx;
+                }
+
+                bool operator!=(const basic_iterator& it) const {
+                    return !(*this == it);
+                }
+
+                reference operator*() const {
+                    return m_fm -> m_slots[m_idx];
+                }
+
+                pointer operator->() const {
+                    return m_fm -> m_slots + m_idx;
+                }
+
+            private:
+                template <bool> friend class basic_iterator;
+
+                void skip_empty() {
+                    while (m_idx < m_fm -> m_capacity && !is_full(m_fm -> m_ctrl[m_idx]))
+                        ++m_idx;
+                }
+
+                map_ptr m_fm = nullptr;
+                size_t m_idx = 0;
+        };
+};
+
+
+template <typename K, typename V, typename Hash, typename Stats>
+flat_hash_map<K, V, Hash, Stats>::flat_hash_map(const flat_hash_map& m) : m_hash{m.m_hash} {
+    if (m.m_size == 0)
+        return;
+    try {
+        allocate(m.m_capacity);
+        for (size_t i = 0; i < m.m_capacity; ++i) {
+            if (is_full(m.m_ctrl[i])) {
+                new (m_slots + i) T(m.m_slots[i]);  // same capacity, same slot
+                set_ctrl(i, m.m_ctrl[i]);
+            }
+            else if (m.m_ctrl[i] == DELETED) {
+                set_ctrl(i, DELETED);
+            }
+        }
+    }
+    catch (...) {
+        // The destructor won't run. A slot is marked full only once its
+        // element is built, so destroy() frees just those.
+        destroy();
+        throw;
+    }
+    m_size = m.m_size;
+    m_growth_left = m.m_growth_left;
+}
+
+template <typename K, typename V, typename Hash, typename Stats>
+void flat_hash_map<K, V, Hash, Stats>::allocate(size_t cap) {
+    m_ctrl = new ctrl_t[cap];
+    std::memset(m_ctrl, EMPTY, cap);
+    m_slots = std::allocator<T>().allocate(cap);
+    m_capacity = cap;
+    m_size = 0;
+    m_growth_left = max_size_for(cap);
+}
+
+template <typename K, typename V, typename Hash, typename Stats>
+void flat_hash_map<K, V, Hash, Stats>::destroy() {
+    if (!m_ctrl)
+        return;
+    clear();
+    std::allocator<T>().deallocate(m_slots, m_capacity);
+    delete[] m_ctrl;
+    m_ctrl = nullptr;
+    m_slots = nullptr;
+    m_capacity = m_growth_left = 0;
+}
+
+template <typename K, typename V, typename Hash, typename Stats>
+template <typename Q>
+size_t flat_hash_map<K, V, Hash, Stats>::probe(const Q& key, hash_t h, size_t& groups) const {
+    // Probe group by group from h1. Return the slot of key, or m_capacity if absent,
+    // and the number of groups looked at. A group with an EMPTY slot ends the probe
+    // sequence.
+    groups = 0;
+    if (m_capacity == 0)
+        return m_capacity;
+    const size_t group_mask = m_capacity / Group::width - 1;
+    const ctrl_t tag = h2(h);
+    size_t g = h1(h) & group_mask;
+    for (size_t step = 0; step <= group_mask; g = (g + ++step) & group_mask) {
+        const size_t base = g * Group::width;
+        Group group(m_ctrl + base);
+        groups = step + 1;
+        for (int i : group.match(tag)) {
+            if (m_slots[base + i].first == key)
+                return base + i;
+        }
+        if (group.match_empty())
+            return m_capacity;
+    }
+    return m_capacity;
+}
+
+template <typename K, typename V, typename Hash, typename Stats>
+size_t flat_hash_map<K, V, Hash, Stats>::find_insert_slot(hash_t h) const {
+    // First EMPTY or DELETED slot on the probe sequence of h.
+    // The table always keeps some EMPTY slots, so the loop terminates.
+    const size_t group_mask = m_capacity / Group::width - 1;
+    size_t g = h1(h) & group_mask;
+    for (size_t step = 0; ; g = (g + ++step) & group_mask) {
+        const size_t base = g * Group::width;
+        auto free = Group(m_ctrl + base).match_empty_or_deleted();
+        if (free)
+            return base + free.lowest();
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Stats>
+void flat_hash_map<K, V, Hash, Stats>::rehash(size_t new_cap) {
+    // Move every element into a fresh table of new_cap slots, dropping tombstones.
+    auto started = Stats::rehash_begin();
+    ctrl_t* old_ctrl = m_ctrl;
+    T* old_slots = m_slots;
+    size_t old_cap = m_capacity;
+    size_t old_size = m_size;
+    allocate(new_cap);
+    for (size_t i = 0; i < old_cap; ++i) {
+        if (!is_full(old_ctrl[i]))
+            continue;
+        hash_t h = m_hash(old_slots[i].first);
+        size_t j = find_insert_slot(h);
+        new (m_slots + j) T(std::move(old_slots[i]));
+        old_slots[i].~T();
+        set_ctrl(j, h2(h));
+    }
+    m_size = old_size;
+    m_growth_left -= old_size;
+    if (old_ctrl) {
+        std::allocator<T>().deallocate(old_slots, old_cap);
+        delete[] old_ctrl;
+    }
+    Stats::rehash_end(started);
+}
+
+template <typename K, typename V, typename Hash, typename Stats>
+size_t flat_hash_map<K, V, Hash, Stats>::prepare_insert(hash_t h) {
+    // Slot for a new element of hash h, growing the table if needed.
+    // The caller constructs the element and sets its control byte.
+    if (m_capacity == 0)
+        rehash(m_init_capacity);
+    size_t i = find_insert_slot(h);
+    if (m_growth_left == 0 && m_ctrl[i] != DELETED) {
+        // Reclaim tombstones if they take up most of the table, else double it.
+        rehash(m_size <= max_size_for(m_capacity) / 2 ? m_capacity : m_capacity * 2);
+        i = find_insert_slot(h);
+    }
+    return i;
+}
+
+template <typename K, typename V, typename Hash, typename Stats>
+template <typename Q, typename... Args>
+std::pair<typename flat_hash_map<K, V, Hash, Stats>::iterator, bool>
+flat_hash_map<K, V, Hash, Stats>::emplace_key(Q&& key, Args&&... args) {
+    hash_t h = m_hash(key);
+    size_t i = find_slot(key, h);
+    if (i != m_capacity)
+        return {iterator(this, i), false};
+
+    i = prepare_insert(h);
+    new (m_slots + i) T(std::piecewise_construct, std::forward_as_tuple(std::forward<Q>(key)),
+                        std::forward_as_tuple(std::forward<Args>(args)...));
+    if (m_ctrl[i] == EMPTY)
+        --m_growth_left;
+    set_ctrl(i, h2(h));
+    ++m_size;
+    return {iterator(this, i), true};
+}
+
+template <typename K, typename V, typename Hash, typename Stats>
+template <typename Q, typename M>
+std::pair<typename flat_hash_map<K, V, Hash, Stats>::iterator, bool>
+flat_hash_map<K, V, Hash, Stats>::assign_key(Q&& key, M&& obj) {
+    hash_t h = m_hash(key);
+    size_t i = find_slot(key, h);
+    if (i != m_capacity) {
+        m_slots[i].second = std::forward<M>(obj);
+        return {iterator(this, i), false};
+    }
+    i = prepare_insert(h);
+    new (m_slots + i) T(std::piecewise_construct, std::forward_as_tuple(std::forward<Q>(key)),
+                        std::forward_as_tuple(std::forward<M>(obj)));
+    if (m_ctrl[i] == EMPTY)
+        --m_growth_left;
+    set_ctrl(i, h2(h));
+    ++m_size;
+    return {iterator(this, i), true};
+}
+
+template <typename K, typename V, typename Hash, typename Stats>
+template <typename Q>
+size_t flat_hash_map<K, V, Hash, Stats>::erase_key(const Q& key) {
+    size_t i = find_slot(key, m_hash(key));
+    if (i == m_capacity)
+        return 0;
+    m_slots[i].~T();
+    --m_size;
+    // If the group already has an EMPTY slot, no probe sequence runs past it,
+    // so the slot can go back to EMPTY. Otherwise leave a tombstone.
+    if (Group(m_ctrl + i / Group::width * Group::width).match_empty()) {
+        set_ctrl(i, EMPTY);
+        ++m_growth_left;
+    }
+    else {
+        set_ctrl(i, DELETED);
+    }
+    return 1;
+}
+
+template <typename K, typename V, typename Hash, typename Stats>
+void flat_hash_map<K, V, Hash, Stats>::clear() {
+    for (size_t i = 0; i < m_capacity; ++i) {
+        if (is_full(m_ctrl[i]))
+            m_slots[i].~T();
+    }
+    if (m_ctrl)
+        std::memset(m_ctrl, EMPTY, m_capacity);
+    m_size = 0;
+    m_growth_left = max_size_for(m_capacity);
+}
+
+template <typename K, typename V, typename Hash, typename Stats>
+hash_map_stats flat_hash_map<K, V, Hash, Stats>::stats() const {
+    // Replays the probe sequence of every element to find its group.
+    hash_map_stats st;
+    st.size = m_size;
+    st.bucket_count = m_capacity;
+    st.load_factor = m_capacity ? double(m_size) / m_capacity : 0;
+    st.bytes = m_capacity * (sizeof(ctrl_t) + sizeof(T));
+    if (m_capacity == 0)
+        return st;
+    const size_t group_mask = m_capacity / Group::width - 1;
+    for (size_t i = 0; i < m_capacity; ++i) {
+        if (!is_full(m_ctrl[i]))
+            continue;
+        size_t target = i / Group::width;
+        size_t g = h1(m_hash(m_slots[i].first)) & group_mask;
+        size_t step = 0;
+        while (g != target)
+            g = (g + ++step) & group_mask;
+        if (step >= st.histogram.size())
+            st.histogram.resize(step + 1, 0);
+        ++st.histogram[step];
+        st.max_chain = std::max(st.max_chain, step + 1);
+    }
+    if constexpr (Stats::enabled)
+        st.counters = static_cast<const Stats&>(*this);
+    return st;
+}
+
+
+}  // end of namespace ADT
+
+
+#endif // __FLAT_HASH_MAP_H_
@@ -1,90 +1,130 @@
 /*
-** Hash function.
+** Hash functions.
 */
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstring>
+#include <random>
 #include "hash.hh"
 
 
 
 namespace ADT {
 
-    const constexpr int HASH_SEED = 5381;
-    const constexpr int HASH_MULT = 33;
-    const constexpr int HASH_MASK = unsigned(-1) >> 1; 
-
-    int hash_seed() {
-        return HASH_SEED;
-    }
-
-    int hash_mult() {
-        return HASH_MULT;
-    }
-
-    int hash(int key) {
-        return key & HASH_MASK;
-    }
-
-    int hash(bool key) {
-        return hash(static_cast<int>(key));
-    }
+    namespace {
+        // Unaligned little-endian reads for wyhash.
+        inline hash_t read8(const unsigned char* p) {
+            std::uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
 
-    int hash(char key) {
-        return hash(static_cast<int>(key));
-    }
+        inline hash_t read4(const unsigned char* p) {
+            std::uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
 
-    int hash(unsigned int key) {
-        return hash(static_cast<int>(key));
+        inline hash_t read3(const unsigned char* p, size_t k) {
+            // 1 to 3 bytes: first, middle and last.
+            return (hash_t(p[0]) << 16) | (hash_t(p[k >> 1]) << 8) | p[k - 1];
+        }
     }
 
-    int hash(long key) {
-        return hash(static_cast<int>(key));
+    hash_t hash_bytes(const void* data, size_t len, hash_t seed) {
+        // wyhash (final version 4), https://github.com/wangyi-fudan/wyhash
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        seed ^= hash_mix(seed ^ HASH_P0, HASH_P1);
+        hash_t a, b;
+        if (len <= 16) {
+            if (len >= 4) {
+                a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+                b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+            }
+            else if (len > 0) {
+                a = read3(p, len);
+                b = 0;
+            }
+            else {
+                a = b = 0;
+            }
+        }
+        else {
+            size_t i = len;
+            if (i > 48) {
+                hash_t see1 = seed, see2 = seed;
+                do {
+                    seed = hash_mix(read8(p) ^ HASH_P1, read8(p + 8) ^ seed);
+                    see1 = hash_mix(read8(p + 16) ^ HASH_P2, read8(p + 24) ^ see1);
+                    see2 = hash_mix(read8(p + 32) ^ HASH_P3, read8(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= see1 ^ see2;
+            }
+            while (i > 16) {
+                seed = hash_mix(read8(p) ^ HASH_P1, read8(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = read8(p + i - 16);
+            b = read8(p + i - 8);
+        }
+        a ^= HASH_P1;
+        b ^= seed;
+        hash_mum(a, b);
+        return hash_mix(a ^ HASH_P0 ^ len, b ^ HASH_P1);
     }
 
-    int hash(unsigned long key) {
-        return hash(static_cast<int>(key));
+    hash_t random_seed() {
+        // One random base per process, and a counter so every call differs.
+        static const hash_t base = [] {
+            std::random_device rd;
+            hash_t r = (hash_t(rd()) << 32) ^ rd();
+            return r ^ hash_int(std::chrono::steady_clock::now().time_since_epoch().count());
+        }();
+        static std::atomic<hash_t> counter {0};
+        return hash_int(counter.fetch_add(1, std::memory_order_relaxed), base);
     }
 
-    int hash(short key) {
-        return hash(static_cast<int>(key));
+    //non-int types
+    hash_t hash(double key, hash_t seed) {
+        if (key == 0)
+            key = 0;  // +0.0 == -0.0, so they must hash alike
+        std::uint64_t bits;
+        std::memcpy(&bits, &key, sizeof(bits));
+        return hash_int(bits, seed);
     }
 
-    int hash(unsigned short key) {
-        return hash(static_cast<int>(key));
+    hash_t hash(float key, hash_t seed) {
+        if (key == 0)
+            key = 0;
+        std::uint32_t bits;
+        std::memcpy(&bits, &key, sizeof(bits));
+        return hash_int(bits, seed);
     }
 
-    //non-int types
-    int hash_other(const char* start, size_t k) {
-        unsigned hash_code = HASH_SEED;
-        for (size_t i = 0; i < k; i++) {
-            hash_code = HASH_MULT * hash_code + start[i];
-        }
-        return hash(hash_code);
-    } 
-
-    int hash(double key) {
-        return hash(reinterpret_cast<const char *>(&key), sizeof(double));
+    hash_t hash(long double key, hash_t seed) {
+        // The object representation of long double has padding bytes on x87,
+        // so hash its value split into two doubles instead.
+        double hi = static_cast<double>(key);
+        double lo = std::isfinite(hi) ? static_cast<double>(key - hi) : 0;
+        return hash_combine(hash(hi, seed), hash(lo, seed));
     }
 
-    int hash(float key) {
-        return hash(reinterpret_cast<const char *>(&key), sizeof(float));
+    hash_t hash(const char* str, hash_t seed) {
+        return hash_bytes(str, std::strlen(str), seed);
     }
 
-    int hash(long double key) {
-        return hash(reinterpret_cast<const char *>(&key), sizeof(long double));
+    hash_t hash(const std::string& str, hash_t seed) {
+        return hash_bytes(str.data(), str.length(), seed);
     }
 
-    int hash(const char* str) {
-        return hash(str, std::strlen(str));
+    hash_t hash(const void* key, hash_t seed) {
+        return hash_int(reinterpret_cast<std::uintptr_t>(key), seed);
     }
 
-    int hash(const std::string& str) {
-        return hash(str.data(), str.length());
-    }
 
-    int hash(void* key) {
-        return hash(reinterpret_cast<uintptr_t>(key));
-    }
-    
-    
 }
@@ -1,42 +1,144 @@
 /*
-** Hash function.
+** Hash functions.
+**
+** 64-bit hashes: wyhash mixing for byte ranges, and a multiply-fold finalizer
+** for integral keys. Every hash takes a seed. ADT::hasher draws a random seed
+** per instance, so bucket layouts can't be predicted from the keys (HashDoS).
 */
 
 
 #ifndef __HASH_H_
 #define __HASH_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
 namespace ADT {
 
-    int hash(int key);
-    int hash(bool key);
-    int hash(char key);
-    int hash(unsigned int key);
-    int hash(long key);
-    int hash(unsigned long key);
-    int hash(short key);
-    int hash(unsigned short key);
+    using hash_t = std::uint64_t;
 
-    int hash(double key);
-    int hash(float key);
-    int hash(long double key);
+    constexpr hash_t HASH_P0 = 0x2d358dccaa6c78a5ULL;
+    constexpr hash_t HASH_P1 = 0x8bb84b93962eacc9ULL;
+    constexpr hash_t HASH_P2 = 0x4b33a62ed433d4a3ULL;
+    constexpr hash_t HASH_P3 = 0x4d5a2da51de1aa47ULL;
 
-    int hash(const char* str);
-    int hash(const std::string& str);
-    int hash(void* key);
+    // 64 x 64 -> 128 bit multiply. a gets the low half, b the high half.
+    inline void hash_mum(hash_t& a, hash_t& b) {
+#if defined(__SIZEOF_INT128__)
+        __uint128_t r = static_cast<__uint128_t>(a) * b;
+        a = static_cast<hash_t>(r);
+        b = static_cast<hash_t>(r >> 64);
+#else
+        hash_t ha = a >> 32, hb = b >> 32, la = a & 0xFFFFFFFF, lb = b & 0xFFFFFFFF;
+        hash_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+        hash_t t = rl + (rm0 << 32), c = t < rl;
+        hash_t lo = t + (rm1 << 32);
+        c += lo < t;
+        a = lo;
+        b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+    }
+
+    // Multiply and fold both halves of the product together.
+    inline hash_t hash_mix(hash_t a, hash_t b) {
+        hash_mum(a, b);
+        return a ^ b;
+    }
+
+    // Finalizer for integral keys: every input bit affects every output bit.
+    inline hash_t hash_int(std::uint64_t key, hash_t seed = 0) {
+        hash_t a = key ^ HASH_P0;
+        hash_t b = seed ^ HASH_P1;
+        hash_mum(a, b);
+        return hash_mix(a ^ HASH_P0, b ^ HASH_P1);
+    }
+
+    // wyhash of a byte range.
+    hash_t hash_bytes(const void* data, size_t len, hash_t seed = 0);
+
+    // Combine two hashes, e.g. of the members of a compound key. Not commutative.
+    inline hash_t hash_combine(hash_t h1, hash_t h2) {
+        return hash_mix(h1 ^ HASH_P2, h2 ^ HASH_P3);
+    }
 
-    int hash_seed();
-    int hash_mult();
+    // Random seed, different on every call and every process run.
+    hash_t random_seed();
+
+    inline hash_t hash(bool key, hash_t seed = 0) { return hash_int(key, seed); }
+    inline hash_t hash(char key, hash_t seed = 0) { return hash_int(key, seed); }
+    inline hash_t hash(signed char key, hash_t seed = 0) { return hash_int(key, seed); }
+    inline hash_t hash(unsigned char key, hash_t seed = 0) { return hash_int(key, seed); }
+    inline hash_t hash(short key, hash_t seed = 0) { return hash_int(key, seed); }
+    inline hash_t hash(unsigned short key, hash_t seed = 0) { return hash_int(key, seed); }
+    inline hash_t hash(int key, hash_t seed = 0) { return hash_int(key, seed); }
+    inline hash_t hash(unsigned int key, hash_t seed = 0) { return hash_int(key, seed); }
+    inline hash_t hash(long key, hash_t seed = 0) { return hash_int(key, seed); }
+    inline hash_t hash(unsigned long key, hash_t seed = 0) { return hash_int(key, seed); }
+    inline hash_t hash(long long key, hash_t seed = 0) { return hash_int(key, seed); }
+    inline hash_t hash(unsigned long long key, hash_t seed = 0) { return hash_int(key, seed); }
+
+    hash_t hash(double key, hash_t seed = 0);
+    hash_t hash(float key, hash_t seed = 0);
+    hash_t hash(long double key, hash_t seed = 0);
+
+    hash_t hash(const char* str, hash_t seed = 0);
+    hash_t hash(const std::string& str, hash_t seed = 0);
+    // Same value as for the equal std::string or C string, without strlen.
+    inline hash_t hash(std::string_view str, hash_t seed = 0) { return hash_bytes(str.data(), str.size(), seed); }
+    hash_t hash(const void* key, hash_t seed = 0);
 
 
 // hash for a pair
     template <typename T, typename U>
-    int hash(T&& t, U&& u) {
-        return hash(hash(t) + hash_mult() * (hash(u) + hash_seed()));
+    hash_t hash(const std::pair<T, U>& p, hash_t seed = 0) {
+        return hash_combine(hash(p.first, seed), hash(p.second, seed));
     }
 
+
+    template <typename K>
+    class hasher {
+        /*
+        ** Seeded hash function object, the default Hash of the hash maps.
+        ** Finds hash(const K&, hash_t) by overload resolution and ADL, so a user
+        ** key type only needs that free function in its own namespace.
+         */
+        public:
+            hasher() : m_seed{random_seed()} {}
+            explicit hasher(hash_t seed) : m_seed{seed} {}
+            hash_t operator()(const K& key) const { return hash(key, m_seed); }
+            hash_t seed() const noexcept { return m_seed; }
+        private:
+            hash_t m_seed;
+    };
+
+    template <>
+    class hasher<std::string> {
+        /*
+        ** Transparent: hashes a std::string, string_view or C string to the
+        ** same value when they hold the same characters, so the maps can look
+        ** up string keys by any of them without building a std::string.
+         */
+        public:
+            using is_transparent = void;
+            hasher() : m_seed{random_seed()} {}
+            explicit hasher(hash_t seed) : m_seed{seed} {}
+            hash_t operator()(std::string_view key) const { return hash_bytes(key.data(), key.size(), m_seed); }
+            hash_t seed() const noexcept { return m_seed; }
+        private:
+            hash_t m_seed;
+    };
+
+    // Whether Hash declares is_transparent, i.e. hashes other types alike to
+    // the equal keys, which enables the maps' lookups by those types.
+    template <typename Hash, typename = void>
+    struct is_transparent_hash : std::false_type {};
+    template <typename Hash>
+    struct is_transparent_hash<Hash, std::void_t<typename Hash::is_transparent>> : std::true_type {};
+
 }
 
 
@@ -2,24 +2,28 @@
 #define __LIST_H_
 
 /*  Singly and circularly linked list */
+/*
+** Each list owns its nodes through raw pointers: one allocation per node from
+** Alloc, no reference counts touched while traversing, and destructors free
+** the nodes in a loop so long lists can't overflow the stack.
+*/
 
 #include <iostream>
-#include <memory>  // smart pointers
+#include <memory>  // allocator_traits
+#include <utility>
 #include "exception.hh"
 
 
 namespace ADT {
 
     using std::ostream;
-    using std::shared_ptr;
-    using std::make_shared;
     using ADT::Empty;
 
 
-    template <typename T> class LinkedList;
-    template <typename T> ostream& operator<<(ostream&, const LinkedList<T>&);
-    template <typename T> class CLinkedList;
-    template <typename T> ostream& operator<<(ostream&, const CLinkedList<T>&);
+    template <typename T, typename Alloc = std::allocator<T>> class LinkedList;
+    template <typename T, typename A> ostream& operator<<(ostream&, const LinkedList<T, A>&);
+    template <typename T, typename Alloc = std::allocator<T>> class CLinkedList;
+    template <typename T, typename A> ostream& operator<<(ostream&, const CLinkedList<T, A>&);
 
     template <typename T>
     class Node {
@@ -27,49 +31,108 @@ namespace ADT {
         public:
             Node() {};
             Node(const T& e): val(e), next(nullptr) {};
-            friend class LinkedList<T>;
-            friend ostream& operator<< <>(ostream&, const LinkedList<T>&);
-            friend class CLinkedList<T>;
-            friend ostream& operator<< <>(ostream&, const CLinkedList<T>&);
+            Node(T&& e): val(std::move(e)), next(nullptr) {};
+            template <typename, typename> friend class LinkedList;
+            template <typename U, typename A> friend ostream& operator<<(ostream&, const LinkedList<U, A>&);
+            template <typename, typename> friend class CLinkedList;
+            template <typename U, typename A> friend ostream& operator<<(ostream&, const CLinkedList<U, A>&);
         private:
             T val;
-            shared_ptr<Node<T>> next;
+            Node<T>* next;
     };
 
 
     /* ------ Singlely Linked List ------ */
-    template <typename T>
+    template <typename T, typename Alloc>
     class LinkedList {
         /*
         ** DSAC 3.13, 3.14, 3.15. Shaffer DSAA 4.8.
+        ** Nodes are allocated from Alloc, e.g. ADT::pool_allocator.
          */
+        using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Node<T>>;
+        using NodeTraits = std::allocator_traits<NodeAlloc>;
+
         public:
+            LinkedList() = default;
+            explicit LinkedList(const Alloc& alloc): m_alloc(alloc) {}
+            LinkedList(const LinkedList& ll): m_alloc(ll.m_alloc) {
+                // The chain copied so far always ends in a null link, so a
+                // throwing copy can free it with clear().
+                Node<T>** link = &head;
+                try {
+                    for (Node<T>* p = ll.head; p; p = p->next) {
+                        *link = new_node(p->val);
+                        link = &((*link)->next);
+                    }
+                }
+                catch (...) {
+                    clear();
+                    throw;
+                }
+            }
+            LinkedList(LinkedList&& ll) noexcept: head(ll.head), m_alloc(ll.m_alloc) {
+                ll.head = nullptr;
+            }
+            LinkedList& operator=(LinkedList ll) {
+                std::swap(head, ll.head);
+                std::swap(m_alloc, ll.m_alloc);
+                return *this;
+            }
+            ~LinkedList() { clear(); }
+
             bool empty() const {
                 return head == nullptr;}
             const T& front() const {
                 return head->val;}
             void insert_front(const T& e) {
-                shared_ptr<Node<T>> x = make_shared<Node<T>>(e);
+                Node<T>* x = new_node(e);
+                x->next = head;
+                head = x;
+            }
+            void insert_front(T&& e) {
+                Node<T>* x = new_node(std::move(e));
                 x->next = head;
                 head = x;
             }
             void remove_front() {
                 if (empty()) return;
-                shared_ptr<Node<T>> old_head = head;
+                Node<T>* old_head = head;
                 head = head -> next;
-                // delete old_head;
+                delete_node(old_head);
+            }
+            void clear() {
+                while (head)
+                    remove_front();
             }
-            friend ostream& operator<< <>(ostream&, const LinkedList<T>&);
+            friend ostream& operator<< <>(ostream&, const LinkedList&);
         private:
-            shared_ptr<Node<T>> head;
+            template <typename U>
+            Node<T>* new_node(U&& e) {
+                Node<T>* x = NodeTraits::allocate(m_alloc, 1);
+                try {
+                    NodeTraits::construct(m_alloc, x, std::forward<U>(e));
+                }
+                catch (...) {
+                    NodeTraits::deallocate(m_alloc, x, 1);
+                    throw;
+                }
+                return x;
+            }
+            void delete_node(Node<T>* x) {
+                NodeTraits::destroy(m_alloc, x);
+                NodeTraits::deallocate(m_alloc, x, 1);
+            }
+
+            Node<T>* head = nullptr;
+            NodeAlloc m_alloc;
     };
 
-    template <typename T>
-    ostream& operator<<(ostream& s, const LinkedList<T>& ll) {
+    template <typename T, typename A>
+    ostream& operator<<(ostream& s, const LinkedList<T, A>& ll) {
         if (ll.empty())
             return s << "[]";
         s << '[' << (ll.head -> val) << ']';
-        shared_ptr<Node<T>> p = ll.head -> next;
+        const Node<T>* p = ll.head -> next;
         while (p) {
             s << " -> " << '[' << (p -> val) << ']';
             p = p -> next;
@@ -79,12 +142,44 @@ namespace ADT {
 
 
     /* ------ Circularly Linked List ------ */
-    template <typename T>
+    template <typename T, typename Alloc>
     class CLinkedList {
         /* Circular linked list
          * DSAC 3.13, 3.14, 3.15. Shaffer DSAA 4.8.
          */
+        using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Node<T>>;
+        using NodeTraits = std::allocator_traits<NodeAlloc>;
+
         public:
+            CLinkedList() = default;
+            explicit CLinkedList(const Alloc& alloc): m_alloc(alloc) {}
+            CLinkedList(const CLinkedList& cl): m_alloc(cl.m_alloc) {
+                // Append each node of cl after our tail, so the order is kept.
+                if (cl.empty())
+                    return;
+                const Node<T>* p = cl.tail;
+                try {
+                    do {
+                        p = p -> next;
+                        insert(p -> val);
+                        advance();
+                    } while (p != cl.tail);
+                }
+                catch (...) {
+                    clear();  // the destructor won't run
+                    throw;
+                }
+            }
+            CLinkedList(CLinkedList&& cl) noexcept: tail(cl.tail), m_alloc(cl.m_alloc) {
+                cl.tail = nullptr;
+            }
+            CLinkedList& operator=(CLinkedList cl) {
+                std::swap(tail, cl.tail);
+                std::swap(m_alloc, cl.m_alloc);
+                return *this;
+            }
+            ~CLinkedList() { clear(); }
+
             bool empty() const {
                 return tail == nullptr;
             }
@@ -104,15 +199,10 @@ namespace ADT {
                 tail = tail -> next;
             }
             void insert(const T& e) {
-                auto u = make_shared<Node<T>>(e);
-                if (empty()) {
-                    u -> next = u;
-                    tail = u;
-                }
-                else {
-                    u -> next = tail -> next;
-                    tail -> next = u;
-                }
+                link(new_node(e));
+            }
+            void insert(T&& e) {
+                link(new_node(std::move(e)));
             }
             void remove() {
                 if (empty())
@@ -122,19 +212,60 @@ namespace ADT {
                     tail = nullptr;
                 else
                     tail -> next = head -> next;
+                delete_node(head);
             }
-            friend ostream& operator<< <>(ostream&, const CLinkedList<T>&);
+            void clear() {
+                if (empty())
+                    return;
+                Node<T>* p = tail -> next;
+                tail -> next = nullptr;  // break the cycle
+                while (p) {
+                    Node<T>* next = p -> next;
+                    delete_node(p);
+                    p = next;
+                }
+                tail = nullptr;
+            }
+            friend ostream& operator<< <>(ostream&, const CLinkedList&);
         private:
-            shared_ptr<Node<T>> tail;
+            void link(Node<T>* u) {
+                if (empty()) {
+                    u -> next = u;
+                    tail = u;
+                }
+                else {
+                    u -> next = tail -> next;
+                    tail -> next = u;
+                }
+            }
+            template <typename U>
+            Node<T>* new_node(U&& e) {
+                Node<T>* x = NodeTraits::allocate(m_alloc, 1);
+                try {
+                    NodeTraits::construct(m_alloc, x, std::forward<U>(e));
+                }
+                catch (...) {
+                    NodeTraits::deallocate(m_alloc, x, 1);
+                    throw;
+                }
+                return x;
+            }
+            void delete_node(Node<T>* x) {
+                NodeTraits::destroy(m_alloc, x);
+                NodeTraits::deallocate(m_alloc, x, 1);
+            }
+
+            Node<T>* tail = nullptr;
+            NodeAlloc m_alloc;
     };
 
-    template <typename T>
-    ostream& operator<<(ostream& os, const CLinkedList<T>& cl) {
+    template <typename T, typename A>
+    ostream& operator<<(ostream& os, const CLinkedList<T, A>& cl) {
         if (cl.empty())
             return os << "[]";
         auto head = cl.tail -> next;
         os << '[' << (head -> val) << ']';
-        shared_ptr<Node<T>> p = head -> next;
+        const Node<T>* p = head -> next;
         while (p != head) {
             os << " -> " << '[' << (p -> val) << ']';
             p = p -> next;
@@ -144,36 +275,46 @@ namespace ADT {
 
 
     /* ------ Doubly Linked List ------ */
-    template <typename T> class DLinkedList;
+    template <typename T, typename Alloc = std::allocator<T>> class DLinkedList;
     template <typename T> class DNodeIterator;
-    template <typename T> ostream& operator<<(ostream&, const DLinkedList<T>&);
+    template <typename T, typename A> ostream& operator<<(ostream&, const DLinkedList<T, A>&);
+
+
+    struct DLink {
+        /*
+        ** Intrusive prev/next hook of a doubly linked list node.
+        ** The head and tail sentinels of a DLinkedList are bare hooks, so they
+        ** need neither an allocation nor a default constructed T.
+         */
+        DLink* prev = nullptr;
+        DLink* next = nullptr;
+    };
 
-    
     template <typename T>
-    class DNode {
+    class DNode : public DLink {
         /*
         ** Doubly linked list node.
          */
         public:
-            friend class DLinkedList<T>;
-            friend ostream& operator<< <>(ostream&, const DLinkedList<T>&);
+            DNode(const T& e): val(e) {}
+            DNode(T&& e): val(std::move(e)) {}
+            template <typename, typename> friend class DLinkedList;
+            template <typename U, typename A> friend ostream& operator<<(ostream&, const DLinkedList<U, A>&);
             friend class DNodeIterator<T>;
 
         private:
             T val;
-            shared_ptr<DNode<T>> prev;
-            shared_ptr<DNode<T>> next;
     };
 
 
     template <typename T>
     class DNodeIterator {
         public:
-            DNodeIterator(shared_ptr<DNode<T>> u) {
+            DNodeIterator(DLink* u) {
                 v = u;
             }
             T& operator*() {
-                return v -> val;
+                return node() -> val;
             }
             bool operator==(const DNodeIterator<T>& p) const {
                 return v == p.v;
@@ -189,78 +330,122 @@ namespace ADT {
                 v = v -> prev;
                 return *this;
             }
-            shared_ptr<DNode<T>> operator->() const {
-                return v;
+            DNode<T>* operator->() const {
+                return node();
             }
 
-            friend class DLinkedList<T>;
+            template <typename, typename> friend class DLinkedList;
 
         private:
-            shared_ptr<DNode<T>> v;
+            DNode<T>* node() const {
+                return static_cast<DNode<T>*>(v);
+            }
+            DLink* v;
     };
 
-    
-    template <typename T>
+
+    template <typename T, typename Alloc>
     class DLinkedList {
         /*
         ** DSAC code fragment 3.22-3.27.
         ** Use dummy sentinel nodes for head and tail.
+        ** Nodes are allocated from Alloc, e.g. ADT::pool_allocator.
          */
+        using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<DNode<T>>;
+        using NodeTraits = std::allocator_traits<NodeAlloc>;
+
         public:
-            DLinkedList()
-                : head{make_shared<DNode<T>>()}, tail{make_shared<DNode<T>>()}, m_size{0} {
-                head -> next = tail;
-                tail -> prev = head;
+            explicit DLinkedList(const Alloc& alloc = Alloc())
+                : m_alloc{alloc}, m_size{0} {
+                head.next = &tail;
+                tail.prev = &head;
+            }
+
+            DLinkedList(const DLinkedList& dl) : DLinkedList(Alloc(dl.m_alloc)) {
+                for (auto p = dl.begin(); p != dl.end(); ++p)
+                    push_back(*p);
+            }
+
+            DLinkedList(DLinkedList&& dl) noexcept : DLinkedList(Alloc(dl.m_alloc)) {
+                swap(*this, dl);
+            }
+
+            DLinkedList& operator=(DLinkedList dl) {
+                swap(*this, dl);
+                return *this;
+            }
+
+            friend void swap(DLinkedList& a, DLinkedList& b) noexcept {
+                // The sentinels stay in place; relink the nodes of each list to the other's.
+                std::swap(a.head.next, b.head.next);
+                std::swap(a.tail.prev, b.tail.prev);
+                a.fix_sentinels(b);
+                b.fix_sentinels(a);
+                std::swap(a.m_alloc, b.m_alloc);
+                std::swap(a.m_size, b.m_size);
             }
 
-            ~DLinkedList() {}
+            ~DLinkedList() {
+                clear();
+            }
 
             size_t size() const {
                 return m_size;
             }
-        
+
             bool empty() const {
-                return head -> next == tail;
+                return head.next == &tail;
             }
 
             DNodeIterator<T> begin() const {
-                return DNodeIterator<T>(head -> next);
+                return DNodeIterator<T>(head.next);
             }
 
             DNodeIterator<T> end() const {
-                return DNodeIterator<T>(tail);
+                return DNodeIterator<T>(const_cast<DLink*>(&tail));
             }
 
             const T& front() const {
                 if (empty())
                     throw Empty("front() of empty DLinkedList");
-                return head -> next -> val;
+                return static_cast<const DNode<T>*>(head.next) -> val;
             };
 
             const T& back() const {
                 if (empty())
                     throw Empty("back() of empty DLinkedList");
-                return tail -> prev -> val;
+                return static_cast<const DNode<T>*>(tail.prev) -> val;
             };
 
             void insert(const DNodeIterator<T>& p, const T& e) {
-                auto u = p -> prev;
-                auto v = make_shared<DNode<T>>();
-                v -> val = e;
-                v -> next = p.v;
-                v -> prev = u;
-                u -> next = p -> prev = v;
-                m_size++;
+                link_before(p.v, new_node(e));
+            }
+
+            void insert(const DNodeIterator<T>& p, T&& e) {
+                link_before(p.v, new_node(std::move(e)));
             }
 
             void erase(const DNodeIterator<T>& p) {
-                auto u = p -> prev;
-                auto w = p -> next;
+                auto u = p.v -> prev;
+                auto w = p.v -> next;
                 u -> next = w;
                 w -> prev = u;
+                delete_node(p.node());
                 m_size--;
             }
 
+            void clear() {
+                DLink* p = head.next;
+                while (p != &tail) {
+                    DLink* next = p -> next;
+                    delete_node(static_cast<DNode<T>*>(p));
+                    p = next;
+                }
+                head.next = &tail;
+                tail.prev = &head;
+                m_size = 0;
+            }
+
             void push_front(const T& e) {
                 insert(begin(), e);
             }
@@ -281,17 +466,56 @@ namespace ADT {
                 erase(--end());
             }
 
-            friend ostream& operator<< <>(ostream&, const DLinkedList<T>&);
+            friend ostream& operator<< <>(ostream&, const DLinkedList&);
 
         private:
-            shared_ptr<DNode<T>> head;
-            shared_ptr<DNode<T>> tail;
+            void link_before(DLink* w, DLink* v) {
+                auto u = w -> prev;
+                v -> next = w;
+                v -> prev = u;
+                u -> next = w -> prev = v;
+                m_size++;
+            }
+
+            void fix_sentinels(DLinkedList& other) {
+                // After swapping links with other, point our first and last nodes back at our sentinels.
+                if (head.next == &other.tail) {  // empty
+                    head.next = &tail;
+                    tail.prev = &head;
+                }
+                else {
+                    head.next -> prev = &head;
+                    tail.prev -> next = &tail;
+                }
+            }
+
+            template <typename U>
+            DNode<T>* new_node(U&& e) {
+                DNode<T>* x = NodeTraits::allocate(m_alloc, 1);
+                try {
+                    NodeTraits::construct(m_alloc, x, std::forward<U>(e));
+                }
+                catch (...) {
+                    NodeTraits::deallocate(m_alloc, x, 1);
+                    throw;
+                }
+                return x;
+            }
+
+            void delete_node(DNode<T>* x) {
+                NodeTraits::destroy(m_alloc, x);
+                NodeTraits::deallocate(m_alloc, x, 1);
+            }
+
+            NodeAlloc m_alloc;
+            DLink head;
+            DLink tail;
             size_t m_size;
     };
 
 
-    template <typename T>
-    ostream& operator<<(ostream& os, const DLinkedList<T>& dl) {
+    template <typename T, typename A>
+    ostream& operator<<(ostream& os, const DLinkedList<T, A>& dl) {
         if (dl.empty())
             return os << "[]";
         auto p = dl.begin();
@@ -301,8 +525,8 @@ namespace ADT {
         }
         return os;
     }
-    
+
 
 }  // end of namespace ADT
-    
+
 #endif // __LIST_H_
@@ -0,0 +1,101 @@
+/*
+** Statistics policies for ADT::unordered_map and ADT::flat_hash_map.
+**
+** A stats policy is told about every lookup and rehash:
+**   static constexpr bool enabled;
+**   void on_lookup(bool hit, size_t probes);  // probes: nodes or groups looked at
+**   timer rehash_begin();
+**   void rehash_end(timer started);
+** no_stats, the default, does nothing. The maps inherit from their policy, so
+** it takes no space either. map_stats counts.
+**
+** m.stats() returns a hash_map_stats snapshot of the counters, together with
+** what can be read off the table itself: load factor, chain lengths (probe
+** distances for flat_hash_map) and bytes held. Reading the table is O(size +
+** bucket_count), so snapshots are for diagnosis, not for hot paths.
+*/
+
+
+#ifndef __MAP_STATS_H_
+#define __MAP_STATS_H_
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include "vector.hh"
+
+
+namespace ADT {
+
+    struct no_stats {
+        static constexpr bool enabled = false;
+        struct timer {};
+        void on_lookup(bool, size_t) {}
+        timer rehash_begin() { return {}; }
+        void rehash_end(timer) {}
+    };
+
+    struct map_stats {
+        /*
+        ** A lookup is every operator[], erase and non-const find; const
+        ** lookups can't update the counters. Rehashes count the growths and
+        ** explicit rehash() calls that relink or move the whole table; an
+        ** incremental rehash is counted when it starts, and its time is only
+        ** that of allocating the new bucket array.
+         */
+        static constexpr bool enabled = true;
+        using timer = std::chrono::steady_clock::time_point;
+
+        void on_lookup(bool hit, size_t probes) {
+            ++(hit ? hits : misses);
+            total_probes += probes;
+            if (probes > max_probes)
+                max_probes = probes;
+        }
+        timer rehash_begin() { return std::chrono::steady_clock::now(); }
+        void rehash_end(timer started) {
+            ++rehashes;
+            rehash_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        }
+        void reset() { *this = map_stats(); }
+
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t total_probes = 0;
+        size_t max_probes = 0;  // of a single lookup
+        size_t rehashes = 0;
+        double rehash_seconds = 0;
+    };
+
+
+    struct hash_map_stats {
+        size_t size = 0;
+        size_t bucket_count = 0;
+        double load_factor = 0;
+        // unordered_map: histogram[k] buckets hold k nodes.
+        // flat_hash_map: histogram[k] elements sit in the k-th group of
+        // their probe sequence.
+        vector<size_t> histogram;
+        size_t max_chain = 0;  // longest chain, or most groups probed to reach an element
+        size_t bytes = 0;      // bucket array and nodes, or control bytes and slots
+        map_stats counters;    // all zero without map_stats
+
+        void dump(std::ostream& os) const {
+            size_t lookups = counters.hits + counters.misses;
+            os << "size " << size << ", buckets " << bucket_count << ", load factor " << load_factor
+               << ", bytes " << bytes << '\n';
+            os << "lookups " << lookups << " (hits " << counters.hits << ", misses " << counters.misses
+               << "), probes per lookup " << (lookups ? double(counters.total_probes) / lookups : 0.0)
+               << ", max " << counters.max_probes << '\n';
+            os << "rehashes " << counters.rehashes << " in " << counters.rehash_seconds << " s\n";
+            os << "max chain " << max_chain << ", histogram:";
+            for (size_t k = 0; k < histogram.size(); ++k)
+                os << ' ' << k << ':' << histogram[k];
+            os << '\n';
+        }
+    };
+
+}  // end of namespace ADT
+
+
+#endif // __MAP_STATS_H_
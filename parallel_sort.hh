@@ -0,0 +1,176 @@
+/*
+** Parallel sorts over an ADT::thread_pool.
+**
+**     ADT::thread_pool pool;
+**     SORT::parallel_sort(v.begin(), v.end(), pool);         // not stable
+**     SORT::parallel_merge_sort(v.begin(), v.end(), pool);   // stable
+**
+** Both are merge sorts that fork the two halves onto the pool until a range
+** is down to the grain size, then sort it with a sequential kernel:
+** SORT::sort for parallel_sort, the buffered merge sort for
+** parallel_merge_sort. Merges of ranges above the grain are split too: the
+** middle element of the longer run is binary-searched in the shorter one,
+** and the two halves of the output are merged in parallel. So every level,
+** including the last merge, runs on all threads.
+**
+** Runs alternate between the input and one buffer of n elements, so each
+** level moves every element once and nothing else is allocated but the
+** kernels' scratch. The element type must be default constructible to fill
+** the buffer. Comparator and projection are as in sorting.hh, and are copied
+** into tasks, so they must be safe to call from several threads.
+*/
+
+
+#ifndef __PARALLEL_SORT_H_
+#define __PARALLEL_SORT_H_
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include "sorting.hh"
+#include "thread_pool.hh"
+
+
+namespace SORT {
+
+    // Smallest range worth a task of its own.
+    constexpr ptrdiff_t PARALLEL_SORT_MIN_GRAIN = 1 << 14;
+
+
+    namespace detail {
+
+        // Grain giving about 8 leaves per thread, so stealing can even out
+        // threads that fall behind.
+        inline ptrdiff_t parallel_grain(ptrdiff_t n, size_t threads) {
+            ptrdiff_t g = n / ptrdiff_t(8 * threads);
+            return g < PARALLEL_SORT_MIN_GRAIN ? PARALLEL_SORT_MIN_GRAIN : g;
+        }
+
+        // Move-merge [a, a_end) and [b, b_end) into out. Equal elements of the
+        // first run come first.
+        template <typename InIt, typename OutIt, typename Less>
+        void move_merge(InIt a, InIt a_end, InIt b, InIt b_end, OutIt out, Less& less) {
+            while (a != a_end && b != b_end) {
+                if (less(*b, *a))
+                    *out++ = std::move(*b++);
+                else
+                    *out++ = std::move(*a++);
+            }
+            out = std::move(a, a_end, out);
+            std::move(b, b_end, out);
+        }
+
+        template <typename InIt, typename OutIt, typename Less>
+        void parallel_merge(InIt a, InIt a_end, InIt b, InIt b_end, OutIt out,
+                            Less less, ADT::thread_pool& pool, ptrdiff_t grain) {
+            ptrdiff_t na = a_end - a;
+            ptrdiff_t nb = b_end - b;
+            // Two single elements don't split any further, whatever the grain.
+            if (na + nb <= grain || (na <= 1 && nb <= 1)) {
+                move_merge(a, a_end, b, b_end, out, less);
+                return;
+            }
+            // Split both runs at one key. Elements of b equal to a key of a
+            // stay behind it, and those of a equal to a key of b stay in front,
+            // so the merge is stable.
+            InIt ma, mb;
+            if (na >= nb) {
+                ma = a + na / 2;
+                mb = std::lower_bound(b, b_end, *ma, less);
+            }
+            else {
+                mb = b + nb / 2;
+                ma = std::upper_bound(a, a_end, *mb, less);
+            }
+            OutIt out_mid = out + ((ma - a) + (mb - b));
+            ADT::task_group g(pool);
+            g.run([=, &pool] { detail::parallel_merge(ma, a_end, mb, b_end, out_mid, less, pool, grain); });
+            detail::parallel_merge(a, ma, b, mb, out, less, pool, grain);
+            g.wait();
+        }
+
+        // Sort [first, last), leaving the result in place, or moved to
+        // [buf, buf + n) if to_buf. The children sort into the other array,
+        // so the merge reads from it and writes to the target.
+        template <typename It, typename BufIt, typename Less, typename Kernel>
+        void parallel_sort(It first, It last, BufIt buf, bool to_buf, Less less, Kernel kernel,
+                           ADT::thread_pool& pool, ptrdiff_t grain) {
+            ptrdiff_t n = last - first;
+            if (n <= grain) {
+                kernel(first, last, less);
+                if (to_buf)
+                    std::move(first, last, buf);
+                return;
+            }
+            ptrdiff_t half = n / 2;
+            {
+                ADT::task_group g(pool);
+                g.run([=, &pool] {
+                    detail::parallel_sort(first, first + half, buf, !to_buf, less, kernel, pool, grain);
+                });
+                detail::parallel_sort(first + half, last, buf + half, !to_buf, less, kernel, pool, grain);
+                g.wait();
+            }
+            if (to_buf)
+                detail::parallel_merge(first, first + half, first + half, last, buf, less, pool, grain);
+            else
+                detail::parallel_merge(buf, buf + half, buf + half, buf + n, first, less, pool, grain);
+        }
+
+        template <typename It, typename Less, typename Kernel>
+        void parallel_sort(It first, It last, Less less, Kernel kernel,
+                           ADT::thread_pool& pool, ptrdiff_t grain) {
+            ptrdiff_t n = last - first;
+            if (grain <= 0)
+                grain = parallel_grain(n, pool.size());
+            if (n <= grain) {
+                kernel(first, last, less);
+                return;
+            }
+            std::vector<typename std::iterator_traits<It>::value_type> buf(n);
+            detail::parallel_sort(first, last, buf.begin(), false, less, kernel, pool, grain);
+        }
+
+        struct pdqsort_kernel {
+            template <typename It, typename Less>
+            void operator()(It first, It last, Less& less) const {
+                if (last - first > 1)
+                    pdqsort_loop(first, last, less, log2_floor(last - first), true);
+            }
+        };
+
+        struct merge_sort_kernel {
+            template <typename It, typename Less>
+            void operator()(It first, It last, Less& less) const {
+                std::vector<typename std::iterator_traits<It>::value_type> scratch;
+                scratch.reserve((last - first + 1) / 2);
+                detail::merge_sort(first, last, scratch, less);
+            }
+        };
+
+    }  // end of namespace detail
+
+
+    // Parallel sort, not stable. A grain of 0 picks one from the size of the
+    // range and the pool.
+    template <typename It, typename Comp = std::less<>, typename Proj = identity>
+    void parallel_sort(It first, It last, ADT::thread_pool& pool,
+                       Comp comp = Comp(), Proj proj = Proj(), ptrdiff_t grain = 0) {
+        detail::require_random_access<It>();
+        detail::parallel_sort(first, last, detail::make_less(std::move(comp), std::move(proj)),
+                              detail::pdqsort_kernel(), pool, grain);
+    }
+
+    // Parallel stable sort.
+    template <typename It, typename Comp = std::less<>, typename Proj = identity>
+    void parallel_merge_sort(It first, It last, ADT::thread_pool& pool,
+                             Comp comp = Comp(), Proj proj = Proj(), ptrdiff_t grain = 0) {
+        detail::require_random_access<It>();
+        detail::parallel_sort(first, last, detail::make_less(std::move(comp), std::move(proj)),
+                              detail::merge_sort_kernel(), pool, grain);
+    }
+
+}  // end of namespace SORT
+
+
+#endif // __PARALLEL_SORT_H_
@@ -0,0 +1,308 @@
+/*
+** Priority queues on d-ary heaps.
+**
+**     ADT::PriorityQueue<int> pq;                         // largest first, as std::priority_queue
+**     ADT::PriorityQueue<Timer, EarlierDeadline> timers;  // earliest first
+**
+** The heap is an implicit D-ary tree in an ADT::vector: the children of slot
+** i are slots D i + 1 to D i + D. D = 4 halves the depth of a binary heap,
+** and the four children of a node share one or two cache lines, so a pop
+** costs fewer cache misses for a few more comparisons per level. Elements
+** are sifted through a hole, one move per level instead of a swap.
+**
+** IndexedPriorityQueue also hands out a handle per element, so the element
+** can be reprioritized or erased in O(log n), as Dijkstra's algorithm and
+** timer queues need.
+*/
+
+#ifndef __PRIORITY_QUEUE_H_
+#define __PRIORITY_QUEUE_H_
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include "exception.hh"
+#include "vector.hh"
+
+
+namespace ADT {
+
+    namespace detail {
+
+        template <size_t D>
+        struct d_ary_heap {
+            static_assert(D >= 2, "a heap needs at least two children per node");
+            static size_t parent(size_t i) { return (i - 1) / D; }
+            static size_t first_child(size_t i) { return D * i + 1; }
+        };
+
+    }  // end of namespace detail
+
+
+    template <typename T, typename Compare = std::less<T>, size_t D = 4>
+    class PriorityQueue {
+        /*
+        ** top() is the greatest element by Compare, as in std::priority_queue;
+        ** use std::greater<T> for a min-queue. Equal elements come out in no
+        ** particular order.
+        */
+        using heap = detail::d_ary_heap<D>;
+
+        public:
+            explicit PriorityQueue(const Compare& comp = Compare()) : m_comp{comp} {}
+            // Bulk build in O(n).
+            template <typename InputIt>
+            PriorityQueue(InputIt first, InputIt last, const Compare& comp = Compare()) : m_comp{comp} {
+                for (; first != last; ++first)
+                    m_heap.push_back(*first);
+                make_heap();
+            }
+
+            size_t size() const { return m_heap.size(); }
+            bool empty() const { return m_heap.empty(); }
+            void reserve(size_t n) { m_heap.reserve(n); }
+            void clear() { m_heap.clear(); }
+
+            const T& top() const {
+                if (empty())
+                    throw Empty("Top of empty priority queue");
+                return m_heap[0];
+            }
+            void push(const T& x) { emplace(x); }
+            void push(T&& x) { emplace(std::move(x)); }
+            template <typename... Args>
+            void emplace(Args&&... args) {
+                m_heap.emplace_back(std::forward<Args>(args)...);
+                sift_up(m_heap.size() - 1);
+            }
+            // Remove the top element and return it.
+            T pop() {
+                if (empty())
+                    throw Empty("Pop from empty priority queue");
+                T x(std::move(m_heap[0]));
+                if (m_heap.size() > 1) {
+                    T last(std::move(m_heap.back()));
+                    m_heap.pop_back();
+                    fill_root(std::move(last));
+                }
+                else
+                    m_heap.pop_back();
+                return x;
+            }
+
+        private:
+            // Floyd's build: sift down every inner node, bottom up.
+            void make_heap() {
+                if (m_heap.size() < 2)
+                    return;
+                for (size_t i = heap::parent(m_heap.size() - 1) + 1; i-- > 0; )
+                    sift_down(i);
+            }
+            void sift_up(size_t i) {
+                T x(std::move(m_heap[i]));
+                while (i > 0 && m_comp(m_heap[heap::parent(i)], x)) {
+                    m_heap[i] = std::move(m_heap[heap::parent(i)]);
+                    i = heap::parent(i);
+                }
+                m_heap[i] = std::move(x);
+            }
+            size_t best_child(size_t c, size_t n) const {
+                size_t last = c + D < n ? c + D : n;
+                size_t best = c;
+                for (size_t k = c + 1; k < last; ++k)
+                    best = m_comp(m_heap[best], m_heap[k]) ? k : best;
+                return best;
+            }
+            void sift_down(size_t i) {
+                size_t n = m_heap.size();
+                T x(std::move(m_heap[i]));
+                for (size_t c; (c = heap::first_child(i)) < n; ) {
+                    size_t best = best_child(c, n);
+                    if (!m_comp(x, m_heap[best]))
+                        break;
+                    m_heap[i] = std::move(m_heap[best]);
+                    i = best;
+                }
+                m_heap[i] = std::move(x);
+            }
+            // Put x, the old last element, at the empty root. It most likely
+            // belongs near the bottom, so the hole goes down to a leaf without
+            // comparing against x, and x climbs back from there (as
+            // std::pop_heap does).
+            void fill_root(T&& x) {
+                size_t n = m_heap.size();
+                size_t i = 0;
+                for (size_t c; (c = heap::first_child(i)) < n; ) {
+                    size_t best = best_child(c, n);
+                    m_heap[i] = std::move(m_heap[best]);
+                    i = best;
+                }
+                m_heap[i] = std::move(x);
+                sift_up(i);
+            }
+
+            vector<T> m_heap;
+            Compare m_comp;
+    };
+
+
+    template <typename T, typename Compare = std::less<T>, size_t D = 4>
+    class IndexedPriorityQueue {
+        /*
+        ** PriorityQueue whose elements are addressed by handles. push()
+        ** returns the handle of the new element, valid until the element is
+        ** popped or erased; after that it may be handed out again. Each heap
+        ** slot holds the element and its handle, and a table maps handles
+        ** back to slots.
+        */
+        using heap = detail::d_ary_heap<D>;
+
+        public:
+            using handle = size_t;
+
+            explicit IndexedPriorityQueue(const Compare& comp = Compare()) : m_comp{comp} {}
+
+            size_t size() const { return m_heap.size(); }
+            bool empty() const { return m_heap.empty(); }
+            void reserve(size_t n) {
+                m_heap.reserve(n);
+                m_slot.reserve(n);
+            }
+            // Whether h refers to an element in the queue.
+            bool contains(handle h) const { return h < m_slot.size() && m_slot[h] != NO_SLOT; }
+
+            const T& top() const {
+                if (empty())
+                    throw Empty("Top of empty priority queue");
+                return m_heap[0].value;
+            }
+            handle top_handle() const {
+                if (empty())
+                    throw Empty("Top of empty priority queue");
+                return m_heap[0].id;
+            }
+            const T& operator[](handle h) const { return m_heap[m_slot[h]].value; }
+
+            handle push(const T& x) { return emplace(x); }
+            handle push(T&& x) { return emplace(std::move(x)); }
+            template <typename... Args>
+            handle emplace(Args&&... args) {
+                handle h;
+                if (!m_free.empty()) {
+                    h = m_free.back();
+                    m_free.pop_back();
+                }
+                else {
+                    h = m_slot.size();
+                    m_slot.push_back(NO_SLOT);
+                }
+                m_heap.push_back(Entry{T(std::forward<Args>(args)...), h});
+                m_slot[h] = m_heap.size() - 1;
+                sift_up(m_heap.size() - 1);
+                return h;
+            }
+            T pop() {
+                if (empty())
+                    throw Empty("Pop from empty priority queue");
+                return remove_at(0);
+            }
+            T erase(handle h) {
+                if (!contains(h))
+                    throw Empty("Erase of an element not in the priority queue");
+                return remove_at(m_slot[h]);
+            }
+            // Give h the value x, which must not move it down: for the default
+            // Compare, x must be at least the old value.
+            void decrease_key(handle h, T x) {
+                size_t i = m_slot[h];
+                m_heap[i].value = std::move(x);
+                sift_up(i);
+            }
+            // Give h the value x, moving it either way.
+            void update(handle h, T x) {
+                size_t i = m_slot[h];
+                bool up = m_comp(m_heap[i].value, x);
+                m_heap[i].value = std::move(x);
+                if (up)
+                    sift_up(i);
+                else
+                    sift_down(i);
+            }
+            void clear() {
+                m_heap.clear();
+                m_slot.clear();
+                m_free.clear();
+            }
+
+        private:
+            static constexpr size_t NO_SLOT = size_t(-1);
+
+            struct Entry {
+                T value;
+                handle id;
+            };
+
+            // Put e in slot i and record where it went.
+            void place(size_t i, Entry&& e) {
+                m_slot[e.id] = i;
+                m_heap[i] = std::move(e);
+            }
+            T remove_at(size_t i) {
+                Entry e(std::move(m_heap[i]));
+                m_slot[e.id] = NO_SLOT;
+                m_free.push_back(e.id);
+                size_t last = m_heap.size() - 1;
+                if (i != last) {
+                    // Refill the hole with the last entry, which may belong
+                    // above or below it.
+                    bool up = m_comp(e.value, m_heap[last].value);
+                    place(i, std::move(m_heap[last]));
+                    m_heap.pop_back();
+                    if (up)
+                        sift_up(i);
+                    else
+                        sift_down(i);
+                }
+                else
+                    m_heap.pop_back();
+                return std::move(e.value);
+            }
+            void sift_up(size_t i) {
+                Entry x(std::move(m_heap[i]));
+                while (i > 0 && m_comp(m_heap[heap::parent(i)].value, x.value)) {
+                    place(i, std::move(m_heap[heap::parent(i)]));
+                    i = heap::parent(i);
+                }
+                place(i, std::move(x));
+            }
+            void sift_down(size_t i) {
+                size_t n = m_heap.size();
+                Entry x(std::move(m_heap[i]));
+                for (;;) {
+                    size_t c = heap::first_child(i);
+                    if (c >= n)
+                        break;
+                    size_t last = c + D < n ? c + D : n;
+                    size_t best = c;
+                    for (size_t k = c + 1; k < last; ++k)
+                        if (m_comp(m_heap[best].value, m_heap[k].value))
+                            best = k;
+                    if (!m_comp(x.value, m_heap[best].value))
+                        break;
+                    place(i, std::move(m_heap[best]));
+                    i = best;
+                }
+                place(i, std::move(x));
+            }
+
+            vector<Entry> m_heap;
+            vector<size_t> m_slot;   // heap slot of each handle, NO_SLOT if free
+            vector<handle> m_free;   // handles to reuse
+            Compare m_comp;
+    };
+
+}  // end of namespace ADT
+
+
+#endif // __PRIORITY_QUEUE_H_
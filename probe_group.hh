@@ -0,0 +1,199 @@
+/*
+** Control byte groups for open addressing hash tables (Swiss table).
+**
+** A table keeps one control byte per slot: CTRL_EMPTY, CTRL_DELETED, or for a
+** full slot a 7-bit tag taken from the key hash. A Group loads Group::width
+** consecutive control bytes and compares all of them with one instruction,
+** returning a BitMask of the matching positions.
+**
+** The widest available ISA is picked at compile time:
+**   AVX2 (32 bytes, -mavx2), SSE2 (16 bytes, default on x86-64),
+**   NEON (16 bytes, AArch64), or portable 64-bit SWAR (8 bytes).
+*/
+
+
+#ifndef __PROBE_GROUP_H_
+#define __PROBE_GROUP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+
+namespace ADT {
+
+    using ctrl_t = signed char;
+    constexpr ctrl_t CTRL_EMPTY = -128;  // 0b10000000
+    constexpr ctrl_t CTRL_DELETED = -2;  // 0b11111110, tombstone of an erased slot
+    // Full slots hold a 7-bit tag, 0b0xxxxxxx.
+
+    inline bool ctrl_is_full(ctrl_t c) { return c >= 0; }
+
+    inline int count_trailing_zeros(std::uint64_t x) {
+#if defined(__GNUC__)
+        return __builtin_ctzll(x);
+#else
+        int n = 0;
+        while (!(x & 1)) {
+            x >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+
+    template <typename U, int Shift>
+    class BitMask {
+        /*
+        ** Set of slot positions in a group, one bit (or 1 << Shift bits) per slot.
+        ** Iterable with range-for, lowest position first.
+         */
+        public:
+            explicit BitMask(U mask) : m_mask{mask} {}
+            explicit operator bool() const { return m_mask != 0; }
+            int lowest() const { return count_trailing_zeros(m_mask) >> Shift; }
+
+            // iterator
+            BitMask begin() const { return *this; }
+            BitMask end() const { return BitMask(0); }
+            int operator*() const { return lowest(); }
+            BitMask& operator++() { m_mask &= m_mask - 1; return *this; }
+            bool operator!=(const BitMask& b) const { return m_mask != b.m_mask; }
+
+        private:
+            U m_mask;
+    };
+
+
+#if defined(__AVX2__)
+
+    struct GroupAvx2 {
+        static constexpr size_t width = 32;
+        using Mask = BitMask<std::uint32_t, 0>;
+
+        explicit GroupAvx2(const ctrl_t* p)
+            : ctrl{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))} {}
+
+        Mask match(ctrl_t tag) const {
+            return Mask(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_set1_epi8(tag), ctrl)));
+        }
+        Mask match_empty() const {
+            return match(CTRL_EMPTY);
+        }
+        Mask match_empty_or_deleted() const {
+            // Both are negative and below -1.
+            return Mask(_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(-1), ctrl)));
+        }
+
+        __m256i ctrl;
+    };
+    using Group = GroupAvx2;
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+    struct GroupSse2 {
+        static constexpr size_t width = 16;
+        using Mask = BitMask<std::uint32_t, 0>;
+
+        explicit GroupSse2(const ctrl_t* p)
+            : ctrl{_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))} {}
+
+        Mask match(ctrl_t tag) const {
+            return Mask(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), ctrl)));
+        }
+        Mask match_empty() const {
+            return match(CTRL_EMPTY);
+        }
+        Mask match_empty_or_deleted() const {
+            return Mask(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl)));
+        }
+
+        __m128i ctrl;
+    };
+    using Group = GroupSse2;
+
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+
+    struct GroupNeon {
+        /*
+        ** NEON has no movemask. Narrow each 0x00/0xFF byte lane to a nibble,
+        ** then keep one bit per nibble so BitMask iteration steps one slot at a time.
+         */
+        static constexpr size_t width = 16;
+        using Mask = BitMask<std::uint64_t, 2>;
+
+        explicit GroupNeon(const ctrl_t* p)
+            : ctrl{vld1q_s8(reinterpret_cast<const int8_t*>(p))} {}
+
+        Mask match(ctrl_t tag) const {
+            return to_mask(vceqq_s8(vdupq_n_s8(tag), ctrl));
+        }
+        Mask match_empty() const {
+            return match(CTRL_EMPTY);
+        }
+        Mask match_empty_or_deleted() const {
+            return to_mask(vcltq_s8(ctrl, vdupq_n_s8(-1)));
+        }
+
+        static Mask to_mask(uint8x16_t eq) {
+            uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+            return Mask(vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888ULL);
+        }
+
+        int8x16_t ctrl;
+    };
+    using Group = GroupNeon;
+
+#else
+
+    struct GroupPortable {
+        /*
+        ** SWAR: 8 control bytes in a 64-bit word.
+        ** match() may report a false positive next to a true one, which only costs
+        ** an extra key compare.
+         */
+        static constexpr size_t width = 8;
+        using Mask = BitMask<std::uint64_t, 3>;
+        static constexpr std::uint64_t LSBS = 0x0101010101010101ULL;
+        static constexpr std::uint64_t MSBS = 0x8080808080808080ULL;
+
+        explicit GroupPortable(const ctrl_t* p) {
+            std::memcpy(&ctrl, p, sizeof(ctrl));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            ctrl = __builtin_bswap64(ctrl);
+#endif
+        }
+
+        Mask match(ctrl_t tag) const {
+            std::uint64_t x = ctrl ^ (LSBS * static_cast<unsigned char>(tag));
+            return Mask((x - LSBS) & ~x & MSBS);
+        }
+        Mask match_empty() const {
+            // High bit set and bit 1 clear: only CTRL_EMPTY.
+            return Mask(ctrl & ~(ctrl << 6) & MSBS);
+        }
+        Mask match_empty_or_deleted() const {
+            // High bit set and bit 0 clear.
+            return Mask(ctrl & ~(ctrl << 7) & MSBS);
+        }
+
+        std::uint64_t ctrl;
+    };
+    using Group = GroupPortable;
+
+#endif
+
+
+}  // end of namespace ADT
+
+
+#endif // __PROBE_GROUP_H_
@@ -4,6 +4,8 @@
 
 #include <iostream>
 #include <memory>
+#include <new>
+#include <utility>
 #include "exception.hh"
 #include "list.hh"
 
@@ -16,7 +18,6 @@ namespace ADT {
     using ADT::Overflow;
     using ADT::Underflow;    
     using ADT::CLinkedList;
-    using ADT::DLinkedList;
 
 
     template <typename T> class ArrayQueue;
@@ -52,10 +53,11 @@ namespace ADT {
                 r = (r + 1) % capacity;
                 arr[r] = x;
             }
-            T& dequeue() {
+            T dequeue() {
+                // By value: the slot is reused by a later enqueue.
                 if (empty())
                     throw Underflow("Dequeue from empty queue");
-                T& x {arr[f]};
+                T x {std::move(arr[f])};
                 f = (f + 1) % capacity;
                 return x;
             }
@@ -134,53 +136,172 @@ namespace ADT {
     template <typename T>
     class Deque {
         /*
-        ** Double-ended queue implemented with doubly linked list.
-        ** DSAC 5.21, 5.22.
+        ** Double-ended queue on a growable circular array. DSAC 5.21, 5.22.
+        ** The capacity is a power of 2, so indices wrap with a mask instead of %
+        ** as in ArrayQueue. A full deque doubles and unrolls its elements to the
+        ** front of the new array, so pushes at both ends are amortized O(1).
          */
+        enum {DEFAULT_CAPACITY = 8};  // initial capacity, a power of 2
+
         public:
-            int size() const {
+            Deque() = default;
+            Deque(const Deque& dq) {
+                reserve(dq.n);
+                for (size_t i = 0; i < dq.n; i++)
+                    insert_back(dq[i]);
+            }
+            Deque(Deque&& dq) noexcept : arr(dq.arr), capacity(dq.capacity), f(dq.f), n(dq.n) {
+                dq.arr = nullptr;
+                dq.capacity = dq.f = dq.n = 0;
+            }
+            Deque& operator=(Deque dq) {
+                std::swap(arr, dq.arr);
+                std::swap(capacity, dq.capacity);
+                std::swap(f, dq.f);
+                std::swap(n, dq.n);
+                return *this;
+            }
+            ~Deque() {
+                clear();
+                std::allocator<T>().deallocate(arr, capacity);
+            }
+
+            size_t size() const {
                 return n;
             }
             bool empty() const {
-                return dl.empty();
+                return n == 0;
             }
             const T& front() const {
-                try {
-                    return dl.front();
-                }
-                catch(const Empty& err) {
+                if (empty())
                     throw Empty("front() of empty Deque");
-                }
+                return arr[f];
             }
             const T& back() const {
-                try {
-                    return dl.back();
-                }
-                catch(const Empty& err) {
+                if (empty())
                     throw Empty("back() of empty Deque");
-                }
+                return arr[slot(n - 1)];
+            }
+            // i-th element from the front, unchecked.
+            T& operator[](size_t i) {
+                return arr[slot(i)];
+            }
+            const T& operator[](size_t i) const {
+                return arr[slot(i)];
             }
             void insert_front(const T& e) {
-                dl.insert_front(e);
+                if (n == capacity) {
+                    T x(e);  // e may be one of our elements
+                    reserve(n + 1);
+                    f = (f - 1) & (capacity - 1);
+                    new (arr + f) T(std::move(x));
+                }
+                else {
+                    f = (f - 1) & (capacity - 1);
+                    new (arr + f) T(e);
+                }
+                n++;
             }
             void insert_back(const T& e) {
-                dl.insert_back(e);
+                if (n == capacity) {
+                    T x(e);
+                    reserve(n + 1);
+                    new (arr + slot(n)) T(std::move(x));
+                }
+                else
+                    new (arr + slot(n)) T(e);
+                n++;
+            }
+            void insert_front(T&& e) {
+                if (n == capacity) {
+                    T x(std::move(e));
+                    reserve(n + 1);
+                    f = (f - 1) & (capacity - 1);
+                    new (arr + f) T(std::move(x));
+                }
+                else {
+                    f = (f - 1) & (capacity - 1);
+                    new (arr + f) T(std::move(e));
+                }
+                n++;
+            }
+            void insert_back(T&& e) {
+                if (n == capacity) {
+                    T x(std::move(e));
+                    reserve(n + 1);
+                    new (arr + slot(n)) T(std::move(x));
+                }
+                else
+                    new (arr + slot(n)) T(std::move(e));
+                n++;
             }
             void remove_front() {
-                dl.remove_front();
+                if (empty())
+                    throw Empty("remove_front() of empty Deque");
+                arr[f].~T();
+                f = (f + 1) & (capacity - 1);
+                n--;
             }
             void remove_back() {
-                dl.remove_back();
+                if (empty())
+                    throw Empty("remove_back() of empty Deque");
+                arr[slot(n - 1)].~T();
+                n--;
+            }
+            void clear() {
+                for (size_t i = 0; i < n; i++)
+                    arr[slot(i)].~T();
+                f = n = 0;
+            }
+            // Make room for at least cap elements.
+            void reserve(size_t cap) {
+                if (cap <= capacity)
+                    return;
+                size_t c = capacity ? capacity : size_t(DEFAULT_CAPACITY);
+                while (c < cap)
+                    c <<= 1;
+                reallocate(c);
             }
             friend ostream& operator<< <>(ostream&, const Deque<T>&);
         private:
-            DLinkedList<T> dl;
-            int n;
+            size_t slot(size_t i) const {
+                return (f + i) & (capacity - 1);
+            }
+            void reallocate(size_t c) {
+                T* a = std::allocator<T>().allocate(c);
+                size_t i = 0;
+                try {
+                    for (; i < n; i++)
+                        new (a + i) T(std::move_if_noexcept(arr[slot(i)]));
+                }
+                catch (...) {
+                    while (i > 0)
+                        a[--i].~T();
+                    std::allocator<T>().deallocate(a, c);
+                    throw;
+                }
+                size_t m = n;
+                clear();
+                std::allocator<T>().deallocate(arr, capacity);
+                arr = a;
+                capacity = c;
+                n = m;
+            }
+
+            T* arr = nullptr;
+            size_t capacity = 0;  // 0 or a power of 2
+            size_t f = 0;  // array index of the front
+            size_t n = 0;  // number of elements
     };
 
     template <typename T>
     ostream& operator<<(ostream& os, const Deque<T>& dq) {
-        return os << dq.dl;
+        if (dq.empty())
+            return os << "[]";
+        os << '[' << dq[0];
+        for (size_t i = 1; i < dq.n; i++)
+            os << ' ' << dq[i];
+        return os << ']';
     }
 
 
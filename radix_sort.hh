@@ -0,0 +1,136 @@
+/*
+** LSD radix sort for integer and floating point keys.
+**
+**     SORT::radix_sort(v.begin(), v.end());                      // ints, floats, ...
+**     SORT::radix_sort(recs.begin(), recs.end(), &Record::key);  // by an arithmetic key
+**
+** Keys are mapped to unsigned integers of the same width that order the same
+** way (radix_key), then sorted one byte at a time, lowest byte first. One
+** pass over the input builds the histograms of every byte, and a byte that
+** is the same in every key is skipped, so small keys in wide types cost only
+** the passes they need. Each pass is a stable scatter between the input and
+** one buffer of n elements. O(n * sizeof(key)), stable, ascending.
+*/
+
+
+#ifndef __RADIX_SORT_H_
+#define __RADIX_SORT_H_
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "sorting.hh"
+
+
+namespace SORT {
+
+    // Ranges below this size are insertion sorted instead.
+    constexpr ptrdiff_t RADIX_SORT_THRESHOLD = 64;
+
+
+    namespace detail {
+
+        template <size_t Bytes> struct unsigned_of;
+        template <> struct unsigned_of<1> { using type = uint8_t; };
+        template <> struct unsigned_of<2> { using type = uint16_t; };
+        template <> struct unsigned_of<4> { using type = uint32_t; };
+        template <> struct unsigned_of<8> { using type = uint64_t; };
+
+    }  // end of namespace detail
+
+
+    // Unsigned integer whose order is the order of k. Signed integers get
+    // their sign bit flipped. For floats, negative values get every bit
+    // flipped and the rest only the sign bit, so -0.0 sorts just before +0.0
+    // and negative NaNs first, positive NaNs last.
+    template <typename K>
+    typename detail::unsigned_of<sizeof(K)>::type radix_key(K k) {
+        static_assert(std::is_arithmetic<K>::value && !std::is_same<K, bool>::value,
+                      "radix keys are integers or floats");
+        using U = typename detail::unsigned_of<sizeof(K)>::type;
+        constexpr U sign = U(1) << (8 * sizeof(U) - 1);
+        if constexpr (std::is_floating_point<K>::value) {
+            U u;
+            std::memcpy(&u, &k, sizeof(u));
+            return (u & sign) ? U(~u) : U(u | sign);
+        }
+        else if constexpr (std::is_signed<K>::value)
+            return U(k) ^ sign;
+        else
+            return U(k);
+    }
+
+
+    namespace detail {
+
+        // Stable counting pass on byte `byte` of the keys, from [src, src_end) to dst.
+        template <typename SrcIt, typename DstIt, typename Proj>
+        void radix_scatter(SrcIt src, SrcIt src_end, DstIt dst, int byte,
+                           std::array<size_t, 256> offset, Proj& proj) {
+            for (; src != src_end; ++src) {
+                auto d = (radix_key(std::invoke(proj, *src)) >> (8 * byte)) & 0xff;
+                dst[offset[d]++] = std::move(*src);
+            }
+        }
+
+    }  // end of namespace detail
+
+
+    template <typename It, typename Proj = identity>
+    void radix_sort(It first, It last, Proj proj = Proj()) {
+        /*
+        ** proj maps an element to its key. The element type must be default
+        ** constructible to fill the buffer.
+        */
+        detail::require_random_access<It>();
+        using V = typename std::iterator_traits<It>::value_type;
+        using K = std::decay_t<std::invoke_result_t<Proj&, V&>>;
+        constexpr int BYTES = sizeof(K);
+
+        ptrdiff_t n = last - first;
+        if (n < RADIX_SORT_THRESHOLD) {
+            // Compare radix keys, so the order of -0.0 and +0.0 does not
+            // depend on the size of the range.
+            SORT::insertion_sort(first, last, std::less<>(),
+                                 [&proj](auto& x) { return radix_key(std::invoke(proj, x)); });
+            return;
+        }
+
+        std::array<std::array<size_t, 256>, BYTES> count{};
+        for (It it = first; it != last; ++it) {
+            auto u = radix_key(std::invoke(proj, *it));
+            for (int b = 0; b < BYTES; ++b)
+                ++count[b][(u >> (8 * b)) & 0xff];
+        }
+
+        std::vector<V> buf(n);
+        bool in_buf = false;  // which side holds the current order
+        auto u0 = radix_key(std::invoke(proj, *first));
+        for (int b = 0; b < BYTES; ++b) {
+            if (count[b][(u0 >> (8 * b)) & 0xff] == size_t(n))
+                continue;  // every key has the same byte here
+            std::array<size_t, 256> offset;
+            size_t sum = 0;
+            for (int d = 0; d < 256; ++d) {
+                offset[d] = sum;
+                sum += count[b][d];
+            }
+            if (in_buf)
+                detail::radix_scatter(buf.begin(), buf.end(), first, b, offset, proj);
+            else
+                detail::radix_scatter(first, last, buf.begin(), b, offset, proj);
+            in_buf = !in_buf;
+        }
+        if (in_buf)
+            std::move(buf.begin(), buf.end(), first);
+    }
+
+}  // end of namespace SORT
+
+
+#endif // __RADIX_SORT_H_
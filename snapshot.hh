@@ -0,0 +1,507 @@
+/*
+** Read-only snapshots of maps and sorted sets, served from mmap(2).
+**
+**     ADT::write_map_snapshot(ids, "ids.snap");           // once
+**     ADT::mapped_unordered_map<std::string, uint64_t> snap("ids.snap");
+**     if (const uint64_t* id = snap.find("needle")) ...
+**
+**     ADT::write_sorted_snapshot(avl, "keys.snap");       // in-order contents
+**     ADT::mapped_sorted_array<int> keys("keys.snap");
+**     auto it = keys.lower_bound(42);
+**
+** A map snapshot is laid out as
+**     header | buckets | entries | values | key arena
+** Entries are sorted by bucket, and buckets[b] to buckets[b + 1] are the
+** entries of bucket b. An entry holds the key's hash and the offset and
+** length of its bytes in the arena; its value sits at the same index in
+** values. A lookup reads two bucket bounds, compares hashes along the run of
+** entries, and compares bytes only on a hash match. Opening a snapshot maps
+** the file and checks the header, so startup costs as many page faults as
+** the lookups touch, and pages are shared between processes reading the
+** same file.
+**
+** A sorted snapshot is a header and the elements in order, searched with
+** std::lower_bound in place.
+**
+** Values and sorted elements are copied as bytes, so they must be trivially
+** copyable. Map keys are std::string or trivially copyable types whose equal
+** values have equal bytes; string keys can be looked up by string_view. Keys
+** are hashed with hash_bytes and a seed stored in the file, so a snapshot
+** does not depend on the Hash of the map it was written from. The format is
+** that of the machine writing it: read it on the same architecture.
+** Snapshots are written to a temporary file that is renamed over path at the
+** end, so readers never see a partial file. Errors from the OS are thrown as
+** std::system_error, files that aren't snapshots of the right type as
+** std::runtime_error. POSIX only.
+*/
+
+
+#ifndef __SNAPSHOT_H_
+#define __SNAPSHOT_H_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "hash.hh"
+#include "vector.hh"
+
+
+namespace ADT {
+
+    namespace detail {
+
+        constexpr char MAP_SNAPSHOT_MAGIC[8] = {'A', 'D', 'T', 'M', 'A', 'P', '1', '\0'};
+        constexpr char SORTED_SNAPSHOT_MAGIC[8] = {'A', 'D', 'T', 'S', 'R', 'T', '1', '\0'};
+        constexpr std::uint32_t SNAPSHOT_VERSION = 1;
+        constexpr size_t SNAPSHOT_ALIGNMENT = 64;  // of every section
+
+        struct map_snapshot_header {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t value_size;
+            std::uint64_t size;
+            std::uint64_t bucket_count;  // a power of two
+            std::uint64_t seed;
+            std::uint64_t buckets;       // offsets of the sections
+            std::uint64_t entries;
+            std::uint64_t values;
+            std::uint64_t arena;
+            std::uint64_t file_size;
+        };
+
+        struct map_snapshot_entry {
+            std::uint64_t hash;
+            std::uint64_t key_offset;  // in the arena
+            std::uint64_t key_size;
+        };
+
+        struct sorted_snapshot_header {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t value_size;
+            std::uint64_t size;
+            std::uint64_t data;
+            std::uint64_t file_size;
+        };
+
+        inline std::uint64_t snapshot_align(std::uint64_t off) {
+            return (off + SNAPSHOT_ALIGNMENT - 1) & ~std::uint64_t(SNAPSHOT_ALIGNMENT - 1);
+        }
+
+        [[noreturn]] inline void throw_snapshot_errno(const std::string& what) {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        // The bytes a key is hashed and compared by.
+        inline std::string_view key_bytes(const std::string& key) { return key; }
+        inline std::string_view key_bytes(std::string_view key) { return key; }
+        template <typename K>
+        std::string_view key_bytes(const K& key) {
+            static_assert(std::is_trivially_copyable<K>::value && std::has_unique_object_representations<K>::value,
+                          "snapshot keys must be strings or have one object representation per value");
+            return std::string_view(reinterpret_cast<const char*>(&key), sizeof(K));
+        }
+
+        // A whole file mapped into memory, read-only or for writing.
+        class mapped_file {
+            public:
+                mapped_file() = default;
+                mapped_file(const std::string& path, bool prefault) {
+                    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                    if (fd < 0)
+                        throw_snapshot_errno("open " + path);
+                    struct stat st;
+                    if (::fstat(fd, &st) < 0) {
+                        int err = errno;
+                        ::close(fd);
+                        errno = err;
+                        throw_snapshot_errno("fstat " + path);
+                    }
+                    map(fd, size_t(st.st_size), PROT_READ, prefault, path);
+                }
+                // A new file of size bytes at path, mapped for writing.
+                static mapped_file create(const std::string& path, size_t size) {
+                    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                    if (fd < 0)
+                        throw_snapshot_errno("open " + path);
+                    if (::ftruncate(fd, off_t(size)) < 0) {
+                        int err = errno;
+                        ::close(fd);
+                        errno = err;
+                        throw_snapshot_errno("ftruncate " + path);
+                    }
+                    mapped_file f;
+                    f.map(fd, size, PROT_READ | PROT_WRITE, false, path);
+                    return f;
+                }
+                mapped_file(mapped_file&& f) noexcept
+                    : m_data{std::exchange(f.m_data, nullptr)}, m_size{std::exchange(f.m_size, 0)} {}
+                mapped_file& operator=(mapped_file&& f) noexcept {
+                    std::swap(m_data, f.m_data);
+                    std::swap(m_size, f.m_size);
+                    return *this;
+                }
+                ~mapped_file() {
+                    if (m_data)
+                        ::munmap(m_data, m_size);
+                }
+
+                char* data() const { return static_cast<char*>(m_data); }
+                size_t size() const { return m_size; }
+
+            private:
+                void map(int fd, size_t size, int prot, bool prefault, const std::string& path) {
+                    if (size > 0) {
+                        int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+                        if (prefault)
+                            flags |= MAP_POPULATE;
+#endif
+                        void* p = ::mmap(nullptr, size, prot, flags, fd, 0);
+                        if (p == MAP_FAILED) {
+                            int err = errno;
+                            ::close(fd);
+                            errno = err;
+                            throw_snapshot_errno("mmap " + path);
+                        }
+                        m_data = p;
+                        m_size = size;
+                    }
+                    ::close(fd);  // the mapping keeps the file open
+                }
+
+                void* m_data = nullptr;
+                size_t m_size = 0;
+        };
+
+        // Closes a file descriptor on the way out.
+        struct fd_guard {
+            int fd;
+            ~fd_guard() {
+                if (fd >= 0)
+                    ::close(fd);
+            }
+        };
+
+        // Write path through path.tmp, renamed over path by commit().
+        class snapshot_target {
+            public:
+                explicit snapshot_target(const std::string& path) : m_path{path}, m_tmp{path + ".tmp"} {}
+                snapshot_target(const snapshot_target&) = delete;
+                snapshot_target& operator=(const snapshot_target&) = delete;
+                ~snapshot_target() {
+                    if (!m_done)
+                        ::unlink(m_tmp.c_str());
+                }
+                const std::string& tmp() const { return m_tmp; }
+                void commit() {
+                    if (::rename(m_tmp.c_str(), m_path.c_str()) < 0)
+                        throw_snapshot_errno("rename " + m_tmp);
+                    m_done = true;
+                }
+            private:
+                std::string m_path;
+                std::string m_tmp;
+                bool m_done = false;
+        };
+
+        template <typename Header>
+        const Header& check_snapshot(const mapped_file& f, const char (&magic)[8], size_t value_size,
+                                     const std::string& path) {
+            if (f.size() < sizeof(Header))
+                throw std::runtime_error(path + ": not a snapshot");
+            const Header& h = *reinterpret_cast<const Header*>(f.data());
+            if (std::memcmp(h.magic, magic, sizeof(magic)) != 0)
+                throw std::runtime_error(path + ": not a snapshot of this type");
+            if (h.version != SNAPSHOT_VERSION)
+                throw std::runtime_error(path + ": unsupported snapshot version " + std::to_string(h.version));
+            if (h.value_size != value_size)
+                throw std::runtime_error(path + ": snapshot of values of " + std::to_string(h.value_size) +
+                                         " bytes, expected " + std::to_string(value_size));
+            if (h.file_size != f.size())
+                throw std::runtime_error(path + ": truncated snapshot");
+            return h;
+        }
+
+    }  // end of namespace detail
+
+
+    template <typename Map>
+    void write_map_snapshot(const Map& m, const std::string& path) {
+        /*
+        ** Write the contents of m, any map with begin(), end() and size()
+        ** over pairs, as a snapshot for mapped_unordered_map. Two passes over
+        ** m: one to count entries per bucket and key bytes, one to fill the
+        ** file in place. Memory use beyond the mapped file is one counter per
+        ** bucket.
+         */
+        using V = typename std::decay<decltype(m.begin() -> second)>::type;
+        static_assert(std::is_trivially_copyable<V>::value, "snapshot values are copied as bytes");
+        using namespace detail;
+
+        std::uint64_t n = m.size();
+        std::uint64_t bcnt = 1;
+        while (bcnt < n)
+            bcnt <<= 1;
+        hash_t seed = random_seed();
+
+        map_snapshot_header h{};
+        std::memcpy(h.magic, MAP_SNAPSHOT_MAGIC, sizeof(h.magic));
+        h.version = SNAPSHOT_VERSION;
+        h.value_size = sizeof(V);
+        h.size = n;
+        h.bucket_count = bcnt;
+        h.seed = seed;
+        h.buckets = snapshot_align(sizeof(h));
+        h.entries = snapshot_align(h.buckets + (bcnt + 1) * sizeof(std::uint64_t));
+        h.values = snapshot_align(h.entries + n * sizeof(map_snapshot_entry));
+        h.arena = snapshot_align(h.values + n * sizeof(V));
+
+        snapshot_target target(path);
+        std::uint64_t key_total = 0;
+        {
+            // Pass 1: counts[b + 1] is the size of bucket b.
+            vector<std::uint64_t> counts(bcnt + 1, 0);
+            for (auto it = m.begin(); it != m.end(); ++it) {
+                std::string_view key = key_bytes(it -> first);
+                ++counts[(hash_bytes(key.data(), key.size(), seed) & (bcnt - 1)) + 1];
+                key_total += key.size();
+            }
+            h.file_size = h.arena + key_total;
+            mapped_file f = mapped_file::create(target.tmp(), h.file_size);
+            char* base = f.data();
+
+            auto* buckets = reinterpret_cast<std::uint64_t*>(base + h.buckets);
+            auto* entries = reinterpret_cast<map_snapshot_entry*>(base + h.entries);
+            auto* values = reinterpret_cast<V*>(base + h.values);
+            char* arena = base + h.arena;
+            for (std::uint64_t b = 0; b < bcnt; ++b)
+                counts[b + 1] += counts[b];
+            std::memcpy(buckets, counts.data(), (bcnt + 1) * sizeof(std::uint64_t));
+
+            // Pass 2: counts[b] is the next free entry of bucket b.
+            std::uint64_t key_off = 0, seen = 0;
+            for (auto it = m.begin(); it != m.end(); ++it, ++seen) {
+                std::string_view key = key_bytes(it -> first);
+                hash_t kh = hash_bytes(key.data(), key.size(), seed);
+                std::uint64_t i = counts[kh & (bcnt - 1)]++;
+                entries[i] = map_snapshot_entry{kh, key_off, key.size()};
+                std::memcpy(static_cast<void*>(values + i), &(it -> second), sizeof(V));
+                std::memcpy(arena + key_off, key.data(), key.size());
+                key_off += key.size();
+            }
+            if (seen != n || key_off != key_total)
+                throw std::runtime_error("map changed while its snapshot was written");
+            std::memcpy(base, &h, sizeof(h));
+        }  // unmapped: the pages go to the file
+        target.commit();
+    }
+
+
+    template <typename K, typename V>
+    class mapped_unordered_map {
+        /*
+        ** Read-only view of a snapshot written by write_map_snapshot. Lookups
+        ** return a pointer into the mapping, valid while the view lives, or
+        ** null for a missing key. prefault maps every page at open, which
+        ** trades the startup time saved for no page faults later.
+         */
+        static_assert(std::is_trivially_copyable<V>::value, "snapshot values are copied as bytes");
+        using entry = detail::map_snapshot_entry;
+
+        public:
+            using key_arg = typename std::conditional<std::is_same<K, std::string>::value,
+                                                      std::string_view, const K&>::type;
+
+            explicit mapped_unordered_map(const std::string& path, bool prefault = false)
+                : m_file{path, prefault} {
+                using namespace detail;
+                const auto& h = check_snapshot<map_snapshot_header>(m_file, MAP_SNAPSHOT_MAGIC, sizeof(V), path);
+                if (h.bucket_count == 0 || (h.bucket_count & (h.bucket_count - 1)) ||
+                    h.arena > h.file_size || h.values + h.size * sizeof(V) > h.arena)
+                    throw std::runtime_error(path + ": corrupt snapshot header");
+                m_size = h.size;
+                m_mask = h.bucket_count - 1;
+                m_seed = h.seed;
+                m_buckets = reinterpret_cast<const std::uint64_t*>(m_file.data() + h.buckets);
+                m_entries = reinterpret_cast<const entry*>(m_file.data() + h.entries);
+                m_values = reinterpret_cast<const V*>(m_file.data() + h.values);
+                m_arena = m_file.data() + h.arena;
+                // Lookups jump around: don't read ahead of them.
+                ::madvise(m_file.data(), m_file.size(), MADV_RANDOM);
+            }
+
+            bool empty() const noexcept { return m_size == 0; }
+            size_t size() const noexcept { return m_size; }
+            size_t bucket_count() const noexcept { return m_mask + 1; }
+
+            const V* find(key_arg key) const {
+                std::string_view kb = detail::key_bytes(key);
+                hash_t h = hash_bytes(kb.data(), kb.size(), m_seed);
+                size_t b = h & m_mask;
+                for (std::uint64_t i = m_buckets[b], end = m_buckets[b + 1]; i < end; ++i) {
+                    const entry& e = m_entries[i];
+                    if (e.hash == h && e.key_size == kb.size() &&
+                        std::memcmp(m_arena + e.key_offset, kb.data(), kb.size()) == 0)
+                        return m_values + i;
+                }
+                return nullptr;
+            }
+            bool contains(key_arg key) const { return find(key) != nullptr; }
+            const V& at(key_arg key) const {
+                const V* v = find(key);
+                if (!v)
+                    throw std::out_of_range("mapped_unordered_map::at: key not found");
+                return *v;
+            }
+
+            // Call f(key, value) on every element, in file order. Keys are
+            // passed as the string_view of their bytes.
+            template <typename F>
+            void for_each(F f) const {
+                for (size_t i = 0; i < m_size; ++i)
+                    f(std::string_view(m_arena + m_entries[i].key_offset, m_entries[i].key_size), m_values[i]);
+            }
+
+        private:
+            detail::mapped_file m_file;
+            size_t m_size = 0;
+            size_t m_mask = 0;
+            hash_t m_seed = 0;
+            const std::uint64_t* m_buckets = nullptr;
+            const entry* m_entries = nullptr;
+            const V* m_values = nullptr;
+            const char* m_arena = nullptr;
+    };
+
+
+    template <typename Range, typename Compare = std::less<>>
+    void write_sorted_snapshot(const Range& r, const std::string& path, Compare comp = Compare()) {
+        /*
+        ** Write the elements of r, which must be sorted by comp, e.g. a
+        ** BinarySearchTree or AVLTree walked in order, as a snapshot for
+        ** mapped_sorted_array. The elements are streamed through a buffer, so
+        ** r is walked once and need not know its size.
+         */
+        using T = typename std::decay<decltype(*std::begin(r))>::type;
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot elements are copied as bytes");
+        using namespace detail;
+
+        sorted_snapshot_header h{};
+        std::memcpy(h.magic, SORTED_SNAPSHOT_MAGIC, sizeof(h.magic));
+        h.version = SNAPSHOT_VERSION;
+        h.value_size = sizeof(T);
+        h.data = snapshot_align(sizeof(h));
+
+        snapshot_target target(path);
+        fd_guard out{::open(target.tmp().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+        if (out.fd < 0)
+            throw_snapshot_errno("open " + target.tmp());
+        auto write_at = [&](const void* buf, size_t len, std::uint64_t off) {
+            for (size_t done = 0; done < len; ) {
+                ssize_t w = ::pwrite(out.fd, static_cast<const char*>(buf) + done, len - done, off_t(off + done));
+                if (w < 0 && errno == EINTR)
+                    continue;
+                if (w < 0)
+                    throw_snapshot_errno("pwrite " + target.tmp());
+                done += size_t(w);
+            }
+        };
+
+        constexpr size_t BUFFER_BYTES = size_t(1) << 20;
+        constexpr size_t BUFFER_LEN = BUFFER_BYTES / sizeof(T) > 0 ? BUFFER_BYTES / sizeof(T) : 1;
+        vector<T> buf;
+        buf.reserve(BUFFER_LEN);
+        std::uint64_t off = h.data;
+        T prev{};
+        for (const auto& x : r) {
+            if ((h.size > 0 || !buf.empty()) && comp(x, prev))
+                throw std::invalid_argument("write_sorted_snapshot: elements are not sorted");
+            prev = x;
+            buf.push_back(x);
+            if (buf.size() == BUFFER_LEN) {
+                write_at(buf.data(), buf.size() * sizeof(T), off);
+                off += buf.size() * sizeof(T);
+                h.size += buf.size();
+                buf.clear();
+            }
+        }
+        write_at(buf.data(), buf.size() * sizeof(T), off);
+        h.size += buf.size();
+        h.file_size = off + buf.size() * sizeof(T);
+        write_at(&h, sizeof(h), 0);
+        if (::ftruncate(out.fd, off_t(h.file_size)) < 0)  // an empty array ends at the padding
+            throw_snapshot_errno("ftruncate " + target.tmp());
+        if (::close(std::exchange(out.fd, -1)) < 0)
+            throw_snapshot_errno("close " + target.tmp());
+        target.commit();
+    }
+
+
+    template <typename T, typename Compare = std::less<T>>
+    class mapped_sorted_array {
+        /*
+        ** Read-only view of a snapshot written by write_sorted_snapshot. The
+        ** elements are a sorted array in the mapping: iterators are pointers,
+        ** and searches are binary searches that fault in only the pages they
+        ** touch, about log2(size / page elements) of them.
+         */
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot elements are copied as bytes");
+
+        public:
+            using value_type = T;
+            using const_iterator = const T*;
+            using iterator = const_iterator;
+
+            explicit mapped_sorted_array(const std::string& path, const Compare& comp = Compare(),
+                                         bool prefault = false)
+                : m_file{path, prefault}, m_comp{comp} {
+                using namespace detail;
+                const auto& h = check_snapshot<sorted_snapshot_header>(m_file, SORTED_SNAPSHOT_MAGIC, sizeof(T), path);
+                if (h.data + h.size * sizeof(T) != h.file_size)
+                    throw std::runtime_error(path + ": corrupt snapshot header");
+                m_size = h.size;
+                m_data = reinterpret_cast<const T*>(m_file.data() + h.data);
+            }
+
+            bool empty() const noexcept { return m_size == 0; }
+            size_t size() const noexcept { return m_size; }
+            const T* data() const noexcept { return m_data; }
+            const T& operator[](size_t i) const { return m_data[i]; }
+            const_iterator begin() const noexcept { return m_data; }
+            const_iterator end() const noexcept { return m_data + m_size; }
+
+            const_iterator lower_bound(const T& x) const { return std::lower_bound(begin(), end(), x, m_comp); }
+            const_iterator upper_bound(const T& x) const { return std::upper_bound(begin(), end(), x, m_comp); }
+            std::pair<const_iterator, const_iterator> equal_range(const T& x) const {
+                return std::equal_range(begin(), end(), x, m_comp);
+            }
+            bool contains(const T& x) const {
+                auto it = lower_bound(x);
+                return it != end() && !m_comp(x, *it);
+            }
+
+        private:
+            detail::mapped_file m_file;
+            Compare m_comp;
+            size_t m_size = 0;
+            const T* m_data = nullptr;
+    };
+
+}  // end of namespace ADT
+
+
+#endif // __SNAPSHOT_H_
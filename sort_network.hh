@@ -0,0 +1,298 @@
+/*
+** SIMD sorting networks for small blocks of primitive keys.
+**
+** network::sort_small(p, n) sorts up to network::max_size<T> keys in place
+** with a bitonic network held in two vector registers: each register is
+** sorted by log2(L) * (log2(L) + 1) / 2 compare-exchange steps, then the two
+** are merged. A step is one lane permute, a min, a max and a blend, so it has
+** no data dependent branches to mispredict. The sorts in sorting.hh use it as
+** their base case for ascending order on contiguous storage.
+**
+** The widest available ISA is picked at compile time:
+**   AVX-512F (-mavx512f): 32-bit keys 32 at a time, 64-bit keys 16 at a time.
+**   AVX2 (-mavx2): 32-bit keys 16 at a time.
+**   Otherwise max_size<T> is 0 and the callers keep their insertion sort.
+** Supported keys are signed and unsigned 32 and 64-bit integers, float and
+** double. Floats are sorted as integers with the same order, so every bit
+** pattern survives and -0.0 sorts before +0.0; NaNs are not supported, as
+** in std::sort.
+*/
+
+
+#ifndef __SORT_NETWORK_H_
+#define __SORT_NETWORK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+
+namespace SORT {
+namespace network {
+
+    // Lane i takes the smaller key of lanes i and i ^ J when it is the lower
+    // lane of an ascending block of size K, or the upper lane of a descending one.
+    constexpr unsigned min_mask(int lanes, int j, int k) {
+        unsigned m = 0;
+        for (int i = 0; i < lanes; ++i)
+            if (((i & j) == 0) == ((i & k) == 0))
+                m |= 1u << i;
+        return m;
+    }
+
+
+#if defined(__AVX512F__)
+
+    // The masked forms of the intrinsics are used with every lane enabled:
+    // the unmasked ones expand to an _mm512_undefined source that GCC 12
+    // reports as used uninitialized under -Wall.
+
+    // Register of 16 32-bit lanes; I is int32_t or uint32_t.
+    template <typename I>
+    struct Zmm32 {
+        static constexpr int lanes = 16;
+        using reg = __m512i;
+        static constexpr __mmask16 ALL = 0xffff;
+
+        static reg load(const I* p) { return _mm512_loadu_si512(p); }
+        static void store(I* p, reg v) { _mm512_storeu_si512(p, v); }
+        // Swap lanes i and i ^ J: within 128-bit blocks for 1 and 2, whole blocks for 4 and 8.
+        template <int J>
+        static reg permute(reg v) {
+            if constexpr (J == 1) return _mm512_mask_shuffle_epi32(v, ALL, v, _MM_PERM_CDAB);
+            else if constexpr (J == 2) return _mm512_mask_shuffle_epi32(v, ALL, v, _MM_PERM_BADC);
+            else if constexpr (J == 4) return _mm512_mask_shuffle_i32x4(v, ALL, v, v, 0xB1);
+            else return _mm512_mask_shuffle_i32x4(v, ALL, v, v, 0x4E);
+        }
+        static reg reverse(reg v) {
+            const __m512i idx = _mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+            return _mm512_mask_permutexvar_epi32(v, ALL, idx, v);
+        }
+        static reg min(reg a, reg b) {
+            if constexpr (std::is_signed<I>::value) return _mm512_mask_min_epi32(a, ALL, a, b);
+            else return _mm512_mask_min_epu32(a, ALL, a, b);
+        }
+        static reg max(reg a, reg b) {
+            if constexpr (std::is_signed<I>::value) return _mm512_mask_max_epi32(a, ALL, a, b);
+            else return _mm512_mask_max_epu32(a, ALL, a, b);
+        }
+        // Lanes of b where bit i of Mask is set, of a elsewhere.
+        template <unsigned Mask>
+        static reg blend(reg a, reg b) { return _mm512_mask_blend_epi32(__mmask16(Mask), a, b); }
+    };
+
+    // Register of 8 64-bit lanes; I is int64_t or uint64_t.
+    template <typename I>
+    struct Zmm64 {
+        static constexpr int lanes = 8;
+        using reg = __m512i;
+        static constexpr __mmask8 ALL = 0xff;
+
+        static reg load(const I* p) { return _mm512_loadu_si512(p); }
+        static void store(I* p, reg v) { _mm512_storeu_si512(p, v); }
+        template <int J>
+        static reg permute(reg v) {
+            if constexpr (J == 1) return _mm512_mask_shuffle_epi32(v, __mmask16(0xffff), v, _MM_PERM_BADC);  // swap 64-bit halves
+            else if constexpr (J == 2) return _mm512_mask_shuffle_i64x2(v, ALL, v, v, 0xB1);
+            else return _mm512_mask_shuffle_i64x2(v, ALL, v, v, 0x4E);
+        }
+        static reg reverse(reg v) {
+            return _mm512_mask_permutexvar_epi64(v, ALL, _mm512_setr_epi64(7, 6, 5, 4, 3, 2, 1, 0), v);
+        }
+        static reg min(reg a, reg b) {
+            if constexpr (std::is_signed<I>::value) return _mm512_mask_min_epi64(a, ALL, a, b);
+            else return _mm512_mask_min_epu64(a, ALL, a, b);
+        }
+        static reg max(reg a, reg b) {
+            if constexpr (std::is_signed<I>::value) return _mm512_mask_max_epi64(a, ALL, a, b);
+            else return _mm512_mask_max_epu64(a, ALL, a, b);
+        }
+        template <unsigned Mask>
+        static reg blend(reg a, reg b) { return _mm512_mask_blend_epi64(__mmask8(Mask), a, b); }
+    };
+
+    template <typename I, size_t Size = sizeof(I)>
+    struct Register { using type = void; };
+    template <typename I> struct Register<I, 4> { using type = Zmm32<I>; };
+    template <typename I> struct Register<I, 8> { using type = Zmm64<I>; };
+
+#elif defined(__AVX2__)
+
+    // Register of 8 32-bit lanes; I is int32_t or uint32_t.
+    template <typename I>
+    struct Ymm32 {
+        static constexpr int lanes = 8;
+        using reg = __m256i;
+
+        static reg load(const I* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+        static void store(I* p, reg v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+        // In-lane shuffles for distances 1 and 2, a 128-bit swap for 4.
+        template <int J>
+        static reg permute(reg v) {
+            if constexpr (J == 1) return _mm256_shuffle_epi32(v, 0xB1);
+            else if constexpr (J == 2) return _mm256_shuffle_epi32(v, 0x4E);
+            else return _mm256_permute2x128_si256(v, v, 1);
+        }
+        static reg reverse(reg v) {
+            return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+        }
+        static reg min(reg a, reg b) {
+            if constexpr (std::is_signed<I>::value) return _mm256_min_epi32(a, b);
+            else return _mm256_min_epu32(a, b);
+        }
+        static reg max(reg a, reg b) {
+            if constexpr (std::is_signed<I>::value) return _mm256_max_epi32(a, b);
+            else return _mm256_max_epu32(a, b);
+        }
+        template <unsigned Mask>
+        static reg blend(reg a, reg b) { return _mm256_blend_epi32(a, b, Mask); }
+    };
+
+    template <typename I, size_t Size = sizeof(I)>
+    struct Register { using type = void; };
+    template <typename I> struct Register<I, 4> { using type = Ymm32<I>; };
+
+#else
+
+    template <typename I, size_t Size = sizeof(I)>
+    struct Register { using type = void; };
+
+#endif
+
+
+    // Integer type the network sorts T as. Floats are sorted as signed
+    // integers of the same width, see to_lane.
+    template <typename T>
+    using lane_type = std::conditional_t<std::is_floating_point<T>::value,
+                                         std::conditional_t<sizeof(T) == 4, int32_t, int64_t>, T>;
+
+    template <typename T>
+    using register_for = std::conditional_t<
+        (std::is_integral<T>::value && !std::is_same<T, bool>::value)
+        || std::is_same<T, float>::value || std::is_same<T, double>::value,
+        typename Register<lane_type<T>>::type, void>;
+
+    // Largest block sort_small takes, 0 if T has no kernel on this target.
+    template <typename T>
+    constexpr size_t max_size = [] {
+        if constexpr (std::is_void<register_for<T>>::value || sizeof(T) < 4)
+            return size_t(0);
+        else
+            return size_t(2 * register_for<T>::lanes);
+    }();
+
+
+    namespace detail {
+
+        // One compare-exchange step between lanes i and i ^ J, see min_mask.
+        template <typename R, int J, int K>
+        typename R::reg step(typename R::reg v) {
+            typename R::reg p = R::template permute<J>(v);
+            return R::template blend<min_mask(R::lanes, J, K)>(R::max(v, p), R::min(v, p));
+        }
+
+        // Steps J, J / 2, ..., 1 of stage K.
+        template <typename R, int K, int J>
+        typename R::reg stage(typename R::reg v) {
+            v = step<R, J, K>(v);
+            if constexpr (J > 1)
+                return stage<R, K, J / 2>(v);
+            else
+                return v;
+        }
+
+        // Bitonic sort of one register, ascending.
+        template <typename R, int K = 2>
+        typename R::reg sort_register(typename R::reg v) {
+            v = stage<R, K, K / 2>(v);
+            if constexpr (K < R::lanes)
+                return sort_register<R, K * 2>(v);
+            else
+                return v;
+        }
+
+        // Merge two sorted registers: a gets the lower half, b the upper.
+        template <typename R>
+        void merge_registers(typename R::reg& a, typename R::reg& b) {
+            typename R::reg r = R::reverse(b);
+            typename R::reg lo = R::min(a, r);  // two bitonic sequences
+            typename R::reg hi = R::max(a, r);
+            a = stage<R, 2 * R::lanes, R::lanes / 2>(lo);
+            b = stage<R, 2 * R::lanes, R::lanes / 2>(hi);
+        }
+
+    }  // end of namespace detail
+
+
+    // A float's bits as a signed integer with the same order: negative values
+    // have their magnitude bits flipped, which puts -0.0 just below +0.0.
+    // Flipping again restores the float.
+    template <typename I>
+    I flip_negative(I i) {
+        using U = std::make_unsigned_t<I>;
+        return i ^ I(U(i >> (8 * sizeof(I) - 1)) >> 1);
+    }
+
+    template <typename T>
+    lane_type<T> to_lane(T x) {
+        if constexpr (std::is_floating_point<T>::value) {
+            lane_type<T> i;
+            std::memcpy(&i, &x, sizeof(i));
+            return flip_negative(i);
+        }
+        else
+            return x;
+    }
+
+    template <typename T>
+    T from_lane(lane_type<T> i) {
+        if constexpr (std::is_floating_point<T>::value) {
+            i = flip_negative(i);
+            T x;
+            std::memcpy(&x, &i, sizeof(x));
+            return x;
+        }
+        else
+            return i;
+    }
+
+    // Sort p[0, n) ascending, for n <= max_size<T>.
+    template <typename T>
+    void sort_small(T* p, size_t n) {
+        static_assert(max_size<T> > 0, "no sorting network for this type on this target");
+        using I = lane_type<T>;
+        using R = register_for<T>;
+        constexpr size_t L = R::lanes;
+        if (n < 2)
+            return;
+        // Pad to whole registers with the largest lane value, which sorts last.
+        alignas(64) I buf[2 * L];
+        for (size_t i = 0; i < n; ++i)
+            buf[i] = to_lane(p[i]);
+        for (size_t i = n; i < 2 * L; ++i)
+            buf[i] = std::numeric_limits<I>::max();
+        typename R::reg a = detail::sort_register<R>(R::load(buf));
+        if (n <= L) {
+            R::store(buf, a);
+        }
+        else {
+            typename R::reg b = detail::sort_register<R>(R::load(buf + L));
+            detail::merge_registers<R>(a, b);
+            R::store(buf, a);
+            R::store(buf + L, b);
+        }
+        for (size_t i = 0; i < n; ++i)
+            p[i] = from_lane<T>(buf[i]);
+    }
+
+}  // end of namespace network
+}  // end of namespace SORT
+
+
+#endif // __SORT_NETWORK_H_
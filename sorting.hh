@@ -1,176 +1,753 @@
 /*
 C++17 template implementations of sorting algorithms.
+
+namespace SORT holds the sort engine. Every function takes a random access
+iterator range, so it works on std::vector, ADT::vector, arrays and pointers,
+with an optional comparator and projection:
+    SORT::sort(v.begin(), v.end());                                 // ascending
+    SORT::sort(v.begin(), v.end(), std::greater<>());               // descending
+    SORT::stable_sort(recs.begin(), recs.end(), {}, &Record::key);  // by member
+The projection is applied to both sides before the comparator, so the call
+above compares r.key values. Nothing prints.
+
+The textbook sorts at the bottom (bubble_sort_*, insertion_sort, merge_sort)
+keep their vector signatures. They are quiet by default; pass
+SORT::print_trace() to see every pass, as they used to print.
 */
 
 
+#ifndef __SORTING_H_
+#define __SORTING_H_
+
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
+#include "sort_network.hh"
 
 using namespace std;
 
 
+namespace SORT {
+
+    // Projection that hands the element through unchanged.
+    struct identity {
+        template <typename T>
+        constexpr T&& operator()(T&& x) const noexcept { return std::forward<T>(x); }
+    };
+
+    // Trace policies, called as trace(label, first, last) after each pass of
+    // the textbook sorts. A policy with enabled == false costs nothing.
+    struct no_trace {
+        static constexpr bool enabled = false;
+        template <typename It>
+        void operator()(std::string_view, It, It) const {}
+    };
+
+    struct print_trace {
+        static constexpr bool enabled = true;
+        std::ostream* os = &std::cout;
+        template <typename It>
+        void operator()(std::string_view label, It first, It last) const {
+            if (!label.empty())
+                *os << label << ": ";
+            for (; first != last; ++first)
+                *os << *first << ' ';
+            *os << '\n';
+        }
+    };
+
+    // Runs below this size are finished by insertion sort.
+    constexpr ptrdiff_t INSERTION_SORT_THRESHOLD = 24;
+    // Above this size the quicksort pivot is the median of three medians.
+    constexpr ptrdiff_t NINTHER_THRESHOLD = 128;
+    // Merge sort hands runs of at most this size to insertion sort.
+    constexpr ptrdiff_t MERGE_SORT_THRESHOLD = 32;
+
+
+    namespace detail {
+
+        // Comparator on elements: comp(proj(a), proj(b)).
+        template <typename Comp, typename Proj>
+        struct projected_less {
+            Comp comp;
+            Proj proj;
+            template <typename A, typename B>
+            bool operator()(A&& a, B&& b) {
+                return std::invoke(comp, std::invoke(proj, std::forward<A>(a)),
+                                   std::invoke(proj, std::forward<B>(b)));
+            }
+        };
+
+        template <typename Comp, typename Proj>
+        projected_less<Comp, Proj> make_less(Comp comp, Proj proj) {
+            return {std::move(comp), std::move(proj)};
+        }
+
+        // Whether Less is plain < on the elements of It.
+        template <typename It, typename Less>
+        constexpr bool is_plain_less() {
+            using T = typename std::iterator_traits<It>::value_type;
+            return std::is_same<Less, projected_less<std::less<>, identity>>::value
+                   || std::is_same<Less, projected_less<std::less<T>, identity>>::value;
+        }
+
+        // Size of the blocks the SIMD sorting network can sort for ranges of It
+        // compared by Less, or 0. It needs contiguous storage, keys the network
+        // supports and plain ascending order.
+        template <typename It, typename Less>
+        constexpr size_t network_size() {
+            using T = typename std::iterator_traits<It>::value_type;
+            constexpr bool contiguous = std::is_pointer<It>::value
+                                        || std::is_same<It, typename std::vector<T>::iterator>::value;
+            return contiguous && is_plain_less<It, Less>() ? network::max_size<T> : 0;
+        }
+
+        // Whether quicksort should use the branchless partition: the comparison
+        // is cheap, so the cost is in mispredicted branches.
+        template <typename It, typename Less>
+        constexpr bool use_branchless_partition() {
+            using T = typename std::iterator_traits<It>::value_type;
+            return std::is_arithmetic<T>::value && is_plain_less<It, Less>();
+        }
+
+        // The same for a stable sort. Equal integers are indistinguishable, so
+        // the network's reordering of them is invisible; equal floats are not
+        // (-0.0 and +0.0).
+        template <typename It, typename Less>
+        constexpr size_t stable_network_size() {
+            using T = typename std::iterator_traits<It>::value_type;
+            return std::is_integral<T>::value ? network_size<It, Less>() : 0;
+        }
+
+        template <typename It>
+        void require_random_access() {
+            using category = typename std::iterator_traits<It>::iterator_category;
+            static_assert(std::is_base_of<std::random_access_iterator_tag, category>::value,
+                          "SORT needs random access iterators");
+        }
+
+        template <typename It, typename Less>
+        void insertion_sort(It first, It last, Less& less) {
+            if (first == last)
+                return;
+            for (It cur = first + 1; cur != last; ++cur) {
+                It sift = cur;
+                It prev = cur - 1;
+                if (less(*sift, *prev)) {
+                    auto key = std::move(*sift);
+                    do {
+                        *sift-- = std::move(*prev);
+                    } while (sift != first && less(key, *--prev));
+                    *sift = std::move(key);
+                }
+            }
+        }
+
+        // Insertion sort that relies on *(first - 1) being no greater than any
+        // element of the range, so the inner loop has no bounds check.
+        template <typename It, typename Less>
+        void unguarded_insertion_sort(It first, It last, Less& less) {
+            if (first == last)
+                return;
+            for (It cur = first + 1; cur != last; ++cur) {
+                It sift = cur;
+                It prev = cur - 1;
+                if (less(*sift, *prev)) {
+                    auto key = std::move(*sift);
+                    do {
+                        *sift-- = std::move(*prev);
+                    } while (less(key, *--prev));
+                    *sift = std::move(key);
+                }
+            }
+        }
+
+        // Insertion sort that gives up after moving a few elements. Returns
+        // true if the range ended up sorted.
+        template <typename It, typename Less>
+        bool partial_insertion_sort(It first, It last, Less& less) {
+            if (first == last)
+                return true;
+            ptrdiff_t moved = 0;
+            for (It cur = first + 1; cur != last; ++cur) {
+                It sift = cur;
+                It prev = cur - 1;
+                if (less(*sift, *prev)) {
+                    auto key = std::move(*sift);
+                    do {
+                        *sift-- = std::move(*prev);
+                    } while (sift != first && less(key, *--prev));
+                    *sift = std::move(key);
+                    moved += cur - sift;
+                }
+                if (moved > 8)
+                    return false;
+            }
+            return true;
+        }
+
+        template <typename It, typename Less>
+        void sort2(It a, It b, Less& less) {
+            if (less(*b, *a))
+                std::iter_swap(a, b);
+        }
+
+        // Order *a <= *b <= *c.
+        template <typename It, typename Less>
+        void sort3(It a, It b, It c, Less& less) {
+            sort2(a, b, less);
+            sort2(b, c, less);
+            sort2(a, b, less);
+        }
+
+        template <typename It, typename Less>
+        void heap_sort(It first, It last, Less& less) {
+            std::make_heap(first, last, std::ref(less));
+            std::sort_heap(first, last, std::ref(less));
+        }
+
+        // Partition around the pivot *first: elements less than it go left,
+        // the rest right. Returns the pivot's final place and whether the
+        // range was already partitioned (no swaps were needed).
+        template <typename It, typename Less>
+        std::pair<It, bool> partition_right(It first, It last, Less& less) {
+            auto pivot = std::move(*first);
+            It l = first;
+            It r = last;
+            // Choosing the pivot left an element >= pivot at the end, so the
+            // first scan stops in range. If it moved past anything, an element
+            // < pivot lies behind it and stops the second scan too.
+            while (less(*++l, pivot));
+            if (l - 1 == first)
+                while (l < r && !less(*--r, pivot));
+            else
+                while (!less(*--r, pivot));
+            bool already_partitioned = l >= r;
+            while (l < r) {
+                std::iter_swap(l, r);
+                while (less(*++l, pivot));
+                while (!less(*--r, pivot));
+            }
+            It pivot_pos = l - 1;
+            *first = std::move(*pivot_pos);
+            *pivot_pos = std::move(pivot);
+            return {pivot_pos, already_partitioned};
+        }
+
+        // Swap the elements at first + offsets_l[i] and last - offsets_r[i].
+        // Unless swaps are asked for (the runs are the same length, so the
+        // input may be descending), the pairs are rotated as one cycle, which
+        // costs one move per element instead of three.
+        template <typename It>
+        void swap_offsets(It first, It last, const unsigned char* offsets_l,
+                          const unsigned char* offsets_r, size_t num, bool use_swaps) {
+            if (use_swaps) {
+                for (size_t i = 0; i < num; ++i)
+                    std::iter_swap(first + offsets_l[i], last - offsets_r[i]);
+            }
+            else if (num > 0) {
+                It l = first + offsets_l[0];
+                It r = last - offsets_r[0];
+                auto tmp = std::move(*l);
+                *l = std::move(*r);
+                for (size_t i = 1; i < num; ++i) {
+                    l = first + offsets_l[i];
+                    *r = std::move(*l);
+                    r = last - offsets_r[i];
+                    *l = std::move(*r);
+                }
+                *r = std::move(tmp);
+            }
+        }
+
+        // partition_right without data dependent branches, after BlockQuicksort
+        // (Edelkamp and Weiss, 2016) as tuned in pdqsort. Blocks of up to
+        // PARTITION_BLOCK elements from each end are scanned first, recording
+        // the offsets of the elements on the wrong side into small arrays;
+        // then those elements are swapped in pairs.
+        constexpr size_t PARTITION_BLOCK = 64;
+
+        template <typename It, typename Less>
+        std::pair<It, bool> partition_right_branchless(It first, It last, Less& less) {
+            auto pivot = std::move(*first);
+            It l = first;
+            It r = last;
+            while (less(*++l, pivot));
+            if (l - 1 == first)
+                while (l < r && !less(*--r, pivot));
+            else
+                while (!less(*--r, pivot));
+            bool already_partitioned = l >= r;
+            if (!already_partitioned) {
+                std::iter_swap(l, r);
+                ++l;
+                alignas(64) unsigned char offsets_l[PARTITION_BLOCK];
+                alignas(64) unsigned char offsets_r[PARTITION_BLOCK];
+                It base_l = l;
+                It base_r = r;
+                size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+                while (l < r) {
+                    // Refill whichever offset blocks are empty, splitting the
+                    // unknown elements between them.
+                    size_t unknown = r - l;
+                    size_t split_l = num_l == 0 ? (num_r == 0 ? unknown / 2 : unknown) : 0;
+                    size_t split_r = num_r == 0 ? unknown - split_l : 0;
+                    if (split_l > PARTITION_BLOCK)
+                        split_l = PARTITION_BLOCK;
+                    if (split_r > PARTITION_BLOCK)
+                        split_r = PARTITION_BLOCK;
+                    for (size_t i = 0; i < split_l; ++i) {
+                        offsets_l[num_l] = (unsigned char)i;
+                        num_l += !less(*l, pivot);
+                        ++l;
+                    }
+                    for (size_t i = 0; i < split_r;) {
+                        offsets_r[num_r] = (unsigned char)++i;
+                        num_r += less(*--r, pivot);
+                    }
+
+                    size_t num = num_l < num_r ? num_l : num_r;
+                    swap_offsets(base_l, base_r, offsets_l + start_l, offsets_r + start_r,
+                                 num, num_l == num_r);
+                    num_l -= num;
+                    num_r -= num;
+                    start_l += num;
+                    start_r += num;
+                    if (num_l == 0) {
+                        start_l = 0;
+                        base_l = l;
+                    }
+                    if (num_r == 0) {
+                        start_r = 0;
+                        base_r = r;
+                    }
+                }
+                // One side still has misplaced elements; move them to the boundary.
+                if (num_l) {
+                    while (num_l--)
+                        std::iter_swap(base_l + offsets_l[start_l + num_l], --r);
+                    l = r;
+                }
+                if (num_r) {
+                    while (num_r--) {
+                        std::iter_swap(base_r - offsets_r[start_r + num_r], l);
+                        ++l;
+                    }
+                }
+            }
+            It pivot_pos = l - 1;
+            *first = std::move(*pivot_pos);
+            *pivot_pos = std::move(pivot);
+            return {pivot_pos, already_partitioned};
+        }
+
+        // Partition around *first with elements equal to the pivot going left.
+        // Only called when the pivot equals the element just before the range,
+        // so everything left of the returned position equals the pivot and is
+        // done.
+        template <typename It, typename Less>
+        It partition_left(It first, It last, Less& less) {
+            auto pivot = std::move(*first);
+            It l = first;
+            It r = last;
+            while (less(pivot, *--r));
+            if (r + 1 == last)
+                while (l < r && !less(pivot, *++l));
+            else
+                while (!less(pivot, *++l));
+            while (l < r) {
+                std::iter_swap(l, r);
+                while (less(pivot, *--r));
+                while (!less(pivot, *++l));
+            }
+            *first = std::move(*r);
+            *r = std::move(pivot);
+            return r;
+        }
+
+        template <typename It, typename Less>
+        void pdqsort_loop(It first, It last, Less& less, int bad_allowed, bool leftmost) {
+            /*
+            ** Pattern-defeating quicksort (Orson Peters, 2016): introsort with
+            ** three additions that make common inputs linear.
+            ** - A partition that needed no swaps is checked with a bounded
+            **   insertion sort, so sorted and nearly sorted runs finish in O(n).
+            ** - A pivot equal to its left neighbour (the previous pivot) means
+            **   many duplicates; its equal elements are split off and skipped.
+            ** - An unbalanced partition shuffles a few elements to break the
+            **   pattern; after log2(n) of them the range falls back to heapsort,
+            **   which bounds the worst case at O(n log n).
+            */
+            for (;;) {
+                ptrdiff_t size = last - first;
+                if constexpr (network_size<It, Less>() > 0) {
+                    if (size <= ptrdiff_t(network_size<It, Less>())) {
+                        network::sort_small(&*first, size_t(size));
+                        return;
+                    }
+                }
+                if (size < INSERTION_SORT_THRESHOLD) {
+                    if (leftmost)
+                        detail::insertion_sort(first, last, less);
+                    else
+                        detail::unguarded_insertion_sort(first, last, less);
+                    return;
+                }
+
+                // Move the pivot to first.
+                ptrdiff_t half = size / 2;
+                if (size > NINTHER_THRESHOLD) {
+                    sort3(first, first + half, last - 1, less);
+                    sort3(first + 1, first + (half - 1), last - 2, less);
+                    sort3(first + 2, first + (half + 1), last - 3, less);
+                    sort3(first + (half - 1), first + half, first + (half + 1), less);
+                    std::iter_swap(first, first + half);
+                }
+                else
+                    sort3(first + half, first, last - 1, less);
+
+                if (!leftmost && !less(*(first - 1), *first)) {
+                    first = detail::partition_left(first, last, less) + 1;
+                    continue;
+                }
+
+                auto [pivot_pos, already_partitioned] = use_branchless_partition<It, Less>()
+                    ? detail::partition_right_branchless(first, last, less)
+                    : detail::partition_right(first, last, less);
+                ptrdiff_t l_size = pivot_pos - first;
+                ptrdiff_t r_size = last - (pivot_pos + 1);
+
+                if (l_size < size / 8 || r_size < size / 8) {
+                    if (--bad_allowed == 0) {
+                        detail::heap_sort(first, last, less);
+                        return;
+                    }
+                    if (l_size >= INSERTION_SORT_THRESHOLD) {
+                        std::iter_swap(first, first + l_size / 4);
+                        std::iter_swap(pivot_pos - 1, pivot_pos - l_size / 4);
+                        if (l_size > NINTHER_THRESHOLD) {
+                            std::iter_swap(first + 1, first + (l_size / 4 + 1));
+                            std::iter_swap(first + 2, first + (l_size / 4 + 2));
+                            std::iter_swap(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+                            std::iter_swap(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+                        }
+                    }
+                    if (r_size >= INSERTION_SORT_THRESHOLD) {
+                        std::iter_swap(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+                        std::iter_swap(last - 1, last - r_size / 4);
+                        if (r_size > NINTHER_THRESHOLD) {
+                            std::iter_swap(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+                            std::iter_swap(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+                            std::iter_swap(last - 2, last - (1 + r_size / 4));
+                            std::iter_swap(last - 3, last - (2 + r_size / 4));
+                        }
+                    }
+                }
+                else if (already_partitioned
+                         && detail::partial_insertion_sort(first, pivot_pos, less)
+                         && detail::partial_insertion_sort(pivot_pos + 1, last, less))
+                    return;
+
+                // Recurse on the left, loop on the right.
+                detail::pdqsort_loop(first, pivot_pos, less, bad_allowed, leftmost);
+                first = pivot_pos + 1;
+                leftmost = false;
+            }
+        }
+
+        inline int log2_floor(ptrdiff_t n) {
+            int k = 0;
+            while (n >>= 1)
+                ++k;
+            return k;
+        }
+
+        // Merge the sorted runs [first, mid) and [mid, last). The left run is
+        // moved into scratch and merged back from the front, so scratch only
+        // ever holds half of the range. Equal elements keep their order.
+        template <typename It, typename Buffer, typename Less>
+        void merge_runs(It first, It mid, It last, Buffer& scratch, Less& less) {
+            if (!less(*mid, *(mid - 1)))
+                return;  // already in order
+            scratch.clear();
+            scratch.insert(scratch.end(), std::make_move_iterator(first), std::make_move_iterator(mid));
+            auto a = scratch.begin();
+            auto a_end = scratch.end();
+            It b = mid;
+            It out = first;
+            while (a != a_end && b != last) {
+                if (less(*b, *a))
+                    *out++ = std::move(*b++);
+                else
+                    *out++ = std::move(*a++);
+            }
+            std::move(a, a_end, out);  // the rest of [b, last) is already in place
+        }
+
+        template <typename It, typename Buffer, typename Less>
+        void merge_sort(It first, It last, Buffer& scratch, Less& less) {
+            constexpr ptrdiff_t block = stable_network_size<It, Less>();
+            if constexpr (block > 0) {
+                if (last - first <= block) {
+                    network::sort_small(&*first, size_t(last - first));
+                    return;
+                }
+            }
+            else if (last - first <= MERGE_SORT_THRESHOLD) {
+                detail::insertion_sort(first, last, less);
+                return;
+            }
+            It mid = first + (last - first) / 2;
+            detail::merge_sort(first, mid, scratch, less);
+            detail::merge_sort(mid, last, scratch, less);
+            detail::merge_runs(first, mid, last, scratch, less);
+        }
+
+    }  // end of namespace detail
+
+
+    template <typename It, typename Comp = std::less<>, typename Proj = identity>
+    void insertion_sort(It first, It last, Comp comp = Comp(), Proj proj = Proj()) {
+        /*
+        ** Stable, in place, O(n^2). Fastest for a few dozen elements or input
+        ** that is nearly sorted.
+        */
+        detail::require_random_access<It>();
+        auto less = detail::make_less(std::move(comp), std::move(proj));
+        detail::insertion_sort(first, last, less);
+    }
+
+    template <typename It, typename Comp = std::less<>, typename Proj = identity>
+    void heap_sort(It first, It last, Comp comp = Comp(), Proj proj = Proj()) {
+        /*
+        ** In place, O(n log n) worst case, not stable.
+        */
+        detail::require_random_access<It>();
+        auto less = detail::make_less(std::move(comp), std::move(proj));
+        detail::heap_sort(first, last, less);
+    }
+
+    template <typename It, typename Comp = std::less<>, typename Proj = identity>
+    void sort(It first, It last, Comp comp = Comp(), Proj proj = Proj()) {
+        /*
+        ** Pattern-defeating quicksort. In place, O(n log n) worst case, not
+        ** stable. Sorted, reversed and few-unique inputs run in about O(n).
+        */
+        detail::require_random_access<It>();
+        if (last - first < 2)
+            return;
+        auto less = detail::make_less(std::move(comp), std::move(proj));
+        detail::pdqsort_loop(first, last, less, detail::log2_floor(last - first), true);
+    }
+
+    template <typename It, typename Buffer, typename Comp = std::less<>, typename Proj = identity>
+    void merge_sort_buffered(It first, It last, Buffer& scratch, Comp comp = Comp(), Proj proj = Proj()) {
+        /*
+        ** Top-down merge sort with a caller-owned scratch buffer: a
+        ** std::vector or ADT::vector of the element type. The buffer keeps its
+        ** capacity, so sorting many ranges with one buffer allocates once.
+        ** Stable, O(n log n), n/2 extra elements.
+        */
+        detail::require_random_access<It>();
+        if (last - first < 2)
+            return;
+        scratch.reserve((last - first + 1) / 2);
+        auto less = detail::make_less(std::move(comp), std::move(proj));
+        detail::merge_sort(first, last, scratch, less);
+        scratch.clear();
+    }
+
+    template <typename It, typename Comp = std::less<>, typename Proj = identity>
+    void merge_sort(It first, It last, Comp comp = Comp(), Proj proj = Proj()) {
+        std::vector<typename std::iterator_traits<It>::value_type> scratch;
+        merge_sort_buffered(first, last, scratch, std::move(comp), std::move(proj));
+    }
+
+    // Equal elements keep their relative order.
+    template <typename It, typename Comp = std::less<>, typename Proj = identity>
+    void stable_sort(It first, It last, Comp comp = Comp(), Proj proj = Proj()) {
+        SORT::merge_sort(first, last, std::move(comp), std::move(proj));
+    }
+
+}  // end of namespace SORT
+
+
 template <typename T>
-void print_vector(vector<T> s) {
+void print_vector(const vector<T>& s) {
     for_each(s.begin(), s.end(), [](const auto& e) {cout << e << ' ';});
     cout << endl;
 }
 
-template <typename T>
-void bubble_sort_asc_sink_right(vector<T>& s) {
+template <typename T, typename Trace = SORT::no_trace>
+void bubble_sort_asc_sink_right(vector<T>& s, Trace trace = Trace()) {
     /*
         Bubble sort. Ascending order.
         Each loop on i brings the largest number to the end.
     */
-    cout << "Input: ";
-    print_vector(s);
-    auto N = s.size();
+    trace("Input", s.begin(), s.end());
+    size_t N = s.size();
+    if (N < 2) return;
     bool complete = false;  // optimization flag
-    for (int i = 0; i < N-1 && complete==false; ++i) {
+    for (size_t i = 0; i < N-1 && complete==false; ++i) {
         complete = true;
-        for (int j = 0; j < N-1-i; ++j)
+        for (size_t j = 0; j < N-1-i; ++j)
             if (s[j] > s[j+1]) {
                 std::swap(s[j], s[j+1]);
                 complete = false;
             }
-        print_vector(s);
+        trace("", s.begin(), s.end());
     }
 }
 
 
-template <typename T>
-void bubble_sort_desc_float_right(vector<T>& s) {
+template <typename T, typename Trace = SORT::no_trace>
+void bubble_sort_desc_float_right(vector<T>& s, Trace trace = Trace()) {
     /*
         Bubble sort. Descending order.
         Each loop on i brings the smallest number to the end.
     */
-    cout << "Input: ";
-    print_vector(s);
-    auto N = s.size();
+    trace("Input", s.begin(), s.end());
+    size_t N = s.size();
+    if (N < 2) return;
     bool complete = false;  // optimization flag
-    for (int i = 0; i < N-1 && complete==false; ++i) {
+    for (size_t i = 0; i < N-1 && complete==false; ++i) {
         complete = true;
-        for (int j = 0; j < N-1-i; ++j)
+        for (size_t j = 0; j < N-1-i; ++j)
             if (s[j] < s[j+1]) {
                 std::swap(s[j], s[j+1]);
                 complete = false;
             }
-        print_vector(s);
+        trace("", s.begin(), s.end());
     }
 }
 
 
-template <typename T>
-void bubble_sort_asc_float_left(vector<T>& s) {
+template <typename T, typename Trace = SORT::no_trace>
+void bubble_sort_asc_float_left(vector<T>& s, Trace trace = Trace()) {
     /*
         Bubble sort. Ascending order.
         Each loop on i brings the smallest number to the beginning.
     */
-    cout << "Input: ";
-    print_vector(s);
-    auto N = s.size();
+    trace("Input", s.begin(), s.end());
+    size_t N = s.size();
+    if (N < 2) return;
     bool complete = false;  // optimization flag
-    for (int i = N-1; i > 0 && complete==false; --i) {
+    for (size_t i = N-1; i > 0 && complete==false; --i) {
         complete = true;
-        for (int j = N-1; j > N-1-i; --j)
+        for (size_t j = N-1; j > N-1-i; --j)
             if (s[j] < s[j-1]) {
                 std::swap(s[j], s[j-1]);
                 complete = false;
             }
-        print_vector(s);
+        trace("", s.begin(), s.end());
     }
 }
 
-template <typename T>
-void bubble_sort_desc_sink_left(vector<T>& s) {
+template <typename T, typename Trace = SORT::no_trace>
+void bubble_sort_desc_sink_left(vector<T>& s, Trace trace = Trace()) {
     /*
         Bubble sort. Decending order.
         Each loop on i brings the largest number to the beginning.
     */
-    cout << "Input: ";
-    print_vector(s);
-    auto N = s.size();
+    trace("Input", s.begin(), s.end());
+    size_t N = s.size();
+    if (N < 2) return;
     bool complete = false;  // optimization flag
-    for (int i = N-1; i > 0 && complete==false; --i) {
+    for (size_t i = N-1; i > 0 && complete==false; --i) {
         complete = true;
-        for (int j = N-1; j > N-1-i; --j)
+        for (size_t j = N-1; j > N-1-i; --j)
             if (s[j] > s[j-1]) {
                 std::swap(s[j], s[j-1]);
                 complete = false;
             }
-        print_vector(s);
+        trace("", s.begin(), s.end());
     }
 }
 
-template <typename T>
-void insertion_sort(vector<T>& s) {
+template <typename T, typename Trace = SORT::no_trace>
+void insertion_sort(vector<T>& s, Trace trace = Trace()) {
 /*
     CRLS 3ed Insertion-Sort.
 */
-    cout << "Input: ";
-    print_vector(s);
+    trace("Input", s.begin(), s.end());
     if (s.size() < 2) return;
-    for (int j = 1; j < s.size(); ++j) {
-        auto key = s[j];
+    for (size_t j = 1; j < s.size(); ++j) {
+        auto key = std::move(s[j]);
         // Insert s[j] into the sorted sequence s[0..j-1]
-        int i = j - 1;
-        while (i >= 0 && s[i] > key) {
-            s[i+1] = s[i];
+        size_t i = j;
+        while (i > 0 && s[i-1] > key) {
+            s[i] = std::move(s[i-1]);
             --i;
         }
-        s[i+1] = key;
-        print_vector(s);
+        s[i] = std::move(key);
+        trace("", s.begin(), s.end());
     }
 }
 
 template <typename T>
-void merge(vector<T>& s, int p, int q, int r) {
+void merge(vector<T>& s, int p, int q, int r, vector<T>& scratch) {
     /*
     ** CRLS 3ed Merge(A, p, q, r). 2.3, p31.
     ** q, r is different and 1-pass the two setment ends.
+    ** Only the left segment is copied out, into scratch, which keeps its
+    ** capacity between calls; the right segment is merged in place.
     */
-    // copy out two segments
-    vector<T> L, R;
-    for (int i = p; i < q; ++i)
-        L.push_back(s[i]);
-    for (int i = q; i < r; ++i)
-        R.push_back(s[i]);
+    scratch.assign(make_move_iterator(s.begin() + p), make_move_iterator(s.begin() + q));
 
     // merge back
-    auto n1 = q - p;
-    auto n2 = r - q;
-    int i = 0;
-    int j = 0;
-    for (int k = p; k < r; ++k) {
-        if (j == n2 || (i < n1 && L[i] <= R[j])) {
-            s[k] = L[i];
-            ++i;
-        }
-        else {
-            s[k] = R[j];
-            ++j;
-        }
+    size_t n1 = q - p;
+    size_t i = 0;
+    int j = q;
+    int k = p;
+    while (i < n1 && j < r) {
+        if (scratch[i] <= s[j])
+            s[k++] = std::move(scratch[i++]);
+        else
+            s[k++] = std::move(s[j++]);
     }
-    
+    while (i < n1)
+        s[k++] = std::move(scratch[i++]);
 }
 
 template <typename T>
-void merge_sort(vector<T>& s, int p, int r) {
-    /*
-    ** CRLS 3ed MERGE-SORT(A, p, r). 2.3, p34.
-    ** r is different and 1-pass to the end.
-     */
+void merge(vector<T>& s, int p, int q, int r) {
+    vector<T> scratch;
+    merge(s, p, q, r, scratch);
+}
+
+template <typename T, typename Trace>
+void merge_sort(vector<T>& s, int p, int r, vector<T>& scratch, Trace& trace) {
     if (p >= r - 1) { // base case
-        cout << p << ", " << r << ": ";
-        print_vector(s);
+        if constexpr (Trace::enabled)
+            trace(to_string(p) + ", " + to_string(r), s.cbegin(), s.cend());
         return;
     }
 
     auto q = (p + r) / 2;  // divide
-    merge_sort(s, p, q);  // conquer 1
-    merge_sort(s, q, r);  // conquer 2
-    merge(s, p, q, r);
-    cout << p << ", " << r << ": ";
-    print_vector(s);
+    merge_sort(s, p, q, scratch, trace);  // conquer 1
+    merge_sort(s, q, r, scratch, trace);  // conquer 2
+    merge(s, p, q, r, scratch);
+    if constexpr (Trace::enabled)
+        trace(to_string(p) + ", " + to_string(r), s.cbegin(), s.cend());
 }
+
+template <typename T, typename Trace = SORT::no_trace>
+void merge_sort(vector<T>& s, int p, int r, Trace trace = Trace()) {
+    /*
+    ** CRLS 3ed MERGE-SORT(A, p, r). 2.3, p34.
+    ** r is different and 1-pass to the end.
+    ** One scratch buffer, sized for the largest left half, serves every merge.
+     */
+    vector<T> scratch;
+    scratch.reserve((r - p + 1) / 2);
+    merge_sort(s, p, r, scratch, trace);
+}
+
+
+#endif // __SORTING_H_
@@ -4,8 +4,10 @@
 
 #include <iostream>
 #include <memory>
+#include <utility>
 #include "exception.hh"
 #include "list.hh"
+#include "vector.hh"
 
 
 using std::ostream;
@@ -17,52 +19,58 @@ using ADT::LinkedList;
 
 namespace ADT {
 
-    template <typename T> class ArrayStack;
-    template <typename T> ostream& operator<<(ostream&, const ArrayStack<T>&);
+    template <typename T, typename Growth> class ArrayStack;
+    template <typename T, typename Growth> ostream& operator<<(ostream&, const ArrayStack<T, Growth>&);
 
 
-    template <typename T>
+    template <typename T, typename Growth = geometric_growth<>>
     class ArrayStack {
         /*
-        ** Array based stack with a specified capacity.
+        ** Array based stack, growing as needed.
         ** Modified from DSAC code fragment 5.4.
-        ** Removed exception specification and use shared_ptr for array.
-        ** Template forward declarations
+        ** Elements live contiguously in an ADT::vector, so a push is a
+        ** construction in place unless the array is full, and pop() destroys
+        ** the top element and returns it by move. The capacity given to the
+        ** constructor is a reserve hint, not a limit.
          */
-        enum {DEFAULT_CAPACITY = 100};  // default stack capacity
         public:
-            ArrayStack(int cap=DEFAULT_CAPACITY)
-                : arr(new T[cap]), capacity(cap), t(-1) {}        
-            int max_len() const {return capacity;}
-            int size() const {return t + 1;}
-            bool empty() const {return t < 0;}
-            const T& top() const {
+            explicit ArrayStack(size_t reserve_hint=0) { arr.reserve(reserve_hint); }
+            size_t size() const {return arr.size();}
+            size_t capacity() const {return arr.capacity();}
+            bool empty() const {return arr.empty();}
+            void reserve(size_t n) {arr.reserve(n);}
+            T& top() {
                 if (empty())
                     throw Empty("Top of empty stack");
-                return arr[t];        
+                return arr.back();
             }
-            void push(const T& x) {
-                if (size() == capacity)
-                    throw Overflow("Push to full stack");
-                arr[++t] = x;
+            const T& top() const {
+                if (empty())
+                    throw Empty("Top of empty stack");
+                return arr.back();
             }
-            void pop() {
+            void push(const T& x) {arr.push_back(x);}
+            void push(T&& x) {arr.push_back(std::move(x));}
+            template <typename... Args>
+            T& emplace(Args&&... args) {return arr.emplace_back(std::forward<Args>(args)...);}
+            T pop() {
                 if (empty())
                     throw Empty("Pop from empty stack");
-                --t;
-            };
-            friend ostream& operator<< <>(ostream&, const ArrayStack<T>&);
+                T x(std::move(arr.back()));
+                arr.pop_back();
+                return x;
+            }
+            void clear() {arr.clear();}
+            friend ostream& operator<< <>(ostream&, const ArrayStack<T, Growth>&);
         private:
-            shared_ptr<T[]> arr;  // array of stack elements
-            int capacity;  // stack max capacity
-            int t;  // array index of stack top
+            vector<T, Growth> arr;  // stack elements, bottom first
     };
 
 
-    template <typename T>
-    ostream& operator<<(ostream& os, const ArrayStack<T>& stk) {
-        for (int i=0; i<stk.size(); i++)
-            os << stk.arr[i] << ' ';
+    template <typename T, typename Growth>
+    ostream& operator<<(ostream& os, const ArrayStack<T, Growth>& stk) {
+        for (auto const& x : stk.arr)
+            os << x << ' ';
         return os;
     }
 
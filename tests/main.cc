@@ -0,0 +1,49 @@
+/*
+** Runner of adt_tests: adt_tests [group...].
+*/
+
+#include "test.hh"
+#include <cstring>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <unistd.h>
+
+
+namespace UNIT {
+
+    std::string temp_path(const std::string& name) {
+        const char* env = std::getenv("TMPDIR");
+        std::string dir = env && *env ? env : "/tmp";
+        return dir + "/adt_tests." + std::to_string(::getpid()) + "." + name;
+    }
+
+}
+
+
+int main(int argc, char* argv[]) {
+    size_t run = 0, failed = 0;
+    for (const auto& t : UNIT::registry()) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc && !selected; ++i)
+            selected = std::strcmp(argv[i], t.group) == 0;
+        if (!selected)
+            continue;
+        ++run;
+        try {
+            t.run();
+            std::cout << "ok     " << t.group << '.' << t.name << std::endl;
+        }
+        catch (const std::exception& e) {
+            ++failed;
+            std::cout << "FAILED " << t.group << '.' << t.name << ": " << e.what()
+                      << " (seed " << UNIT::SEED << ")" << std::endl;
+        }
+    }
+    if (run == 0) {
+        std::cerr << "no test matches" << std::endl;
+        return 2;
+    }
+    std::cout << run - failed << " of " << run << " tests passed" << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,76 @@
+/*
+** Test harness of adt_tests.
+**
+** TEST(group, name) { ... } registers a test; CHECK(cond) fails it, with or
+** without NDEBUG. adt_tests [group...] runs the tests of the given groups,
+** or all of them. Most tests are randomized: they replay the same operations
+** on an ADT container and its std:: counterpart and compare the two. The seed
+** is fixed, and printed with every failure.
+*/
+
+#ifndef __TEST_H_
+#define __TEST_H_
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace UNIT {
+
+    struct test_case {
+        const char* group;
+        const char* name;
+        void (*run)();
+    };
+
+    inline std::vector<test_case>& registry() {
+        static std::vector<test_case> tests;
+        return tests;
+    }
+
+    struct registrar {
+        registrar(const char* group, const char* name, void (*run)()) {
+            registry().push_back({group, name, run});
+        }
+    };
+
+    struct failure : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    [[noreturn]] inline void fail(const char* what, const char* file, int line) {
+        throw failure(std::string(file) + ":" + std::to_string(line) + ": CHECK(" + what + ") failed");
+    }
+
+    // The seed of every randomized test, so a failure replays.
+    constexpr std::uint64_t SEED = 20240607;
+
+    inline std::mt19937_64 rng(std::uint64_t salt = 0) { return std::mt19937_64(SEED + salt); }
+
+    // Uniform integer in [lo, hi].
+    template <typename T, typename Rng>
+    T uniform(Rng& g, T lo, T hi) { return std::uniform_int_distribution<T>(lo, hi)(g); }
+
+    // Path of a scratch file in the temp directory, unique to this process.
+    std::string temp_path(const std::string& name);
+
+}  // end of namespace UNIT
+
+#define TEST(group, name)                                                    \
+    static void group##_##name();                                            \
+    static ::UNIT::registrar group##_##name##_registrar(#group, #name, &group##_##name); \
+    static void group##_##name()
+
+#define CHECK(cond) ((cond) ? void(0) : ::UNIT::fail(#cond, __FILE__, __LINE__))
+
+// CHECK that expr throws an exception of type E.
+#define CHECK_THROWS(E, expr)                                                \
+    do {                                                                     \
+        bool thrown_ = false;                                                \
+        try { expr; } catch (const E&) { thrown_ = true; }                   \
+        if (!thrown_) ::UNIT::fail(#expr " throws " #E, __FILE__, __LINE__); \
+    } while (false)
+
+#endif // __TEST_H_
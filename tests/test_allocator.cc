@@ -0,0 +1,88 @@
+/*
+** counting_allocator of allocator.hh under the node containers: every byte
+** allocated is given back once the container is gone.
+*/
+
+#include "test.hh"
+#include "allocator.hh"
+#include "list.hh"
+#include "trees.hh"
+#include "unordered_map.hh"
+#include <cstdint>
+#include <string>
+#include <utility>
+
+
+namespace {
+
+    // After f() has built and destroyed a container on st, nothing is live.
+    template <typename F>
+    void check_balanced(ADT::allocation_stats& st, F f) {
+        f();
+        CHECK(st.allocations > 0 && st.allocations == st.deallocations);
+        CHECK(st.bytes == 0 && st.peak_bytes > 0 && st.total_bytes >= st.peak_bytes);
+    }
+
+}
+
+
+TEST(allocator, counting_allocator) {
+    {
+        ADT::allocation_stats st;
+        check_balanced(st, [&st] {
+            AVLTree<int, ADT::counting_allocator<int>> t {ADT::counting_allocator<int>(st)};
+            for (int i = 0; i < 1000; ++i)
+                t.insert(i);
+            for (int i = 0; i < 1000; i += 2)
+                t.remove(i);
+            CHECK(st.bytes > 0);
+            t.clear();
+            CHECK(st.bytes == 0);
+            t.insert(1);
+        });
+    }
+    {
+        ADT::allocation_stats st;
+        check_balanced(st, [&st] {
+            ADT::LinkedList<std::string, ADT::counting_allocator<std::string>> l {ADT::counting_allocator<std::string>(st)};
+            for (int i = 0; i < 1000; ++i)
+                l.insert_front(std::to_string(i));
+            for (int i = 0; i < 500; ++i)
+                l.remove_front();
+        });
+    }
+    {
+        // The incremental rehash holds two bucket arrays for a while.
+        using alloc = ADT::counting_allocator<std::pair<std::uint64_t, std::uint64_t>>;
+        ADT::allocation_stats st;
+        check_balanced(st, [&st] {
+            ADT::unordered_map<std::uint64_t, std::uint64_t, ADT::hasher<std::uint64_t>, ADT::power_of_two_policy,
+                               ADT::incremental_rehash<1>, alloc> m {alloc(st)};
+            for (std::uint64_t i = 0; i < 5000; ++i)
+                m[i] = i;
+            for (std::uint64_t i = 0; i < 5000; i += 3)
+                m.erase(i);
+            size_t live = st.bytes;
+            m.clear();
+            CHECK(st.bytes < live);
+        });
+    }
+    {
+        // Over an arena too: clear() returns every node even though the
+        // arena frees nothing until it is released.
+        using pair = std::pair<std::uint64_t, std::uint64_t>;
+        using alloc = ADT::counting_allocator<pair, ADT::arena_allocator<pair>>;
+        ADT::monotonic_arena arena;
+        ADT::allocation_stats st;
+        check_balanced(st, [&st, &arena] {
+            ADT::unordered_map<std::uint64_t, std::uint64_t, ADT::hasher<std::uint64_t>, ADT::power_of_two_policy,
+                               ADT::eager_rehash, alloc> m {alloc(st, ADT::arena_allocator<pair>(arena))};
+            for (std::uint64_t i = 0; i < 5000; ++i)
+                m[i] = i;
+            size_t freed = st.deallocations;
+            m.clear();
+            CHECK(st.deallocations - freed == 5000);
+        });
+        CHECK(arena.block_count() > 0);
+    }
+}
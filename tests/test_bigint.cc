@@ -0,0 +1,74 @@
+/*
+** BigUnsigned of bigint.hh against 128-bit integers and algebraic
+** identities.
+*/
+
+#include "test.hh"
+#include "bigint.hh"
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+
+namespace {
+
+    using ADT::BigUnsigned;
+
+    std::string to_string(unsigned __int128 x) {
+        std::string s;
+        do {
+            s.insert(s.begin(), char('0' + unsigned(x % 10)));
+            x /= 10;
+        } while (x);
+        return s;
+    }
+
+    // A random number of the given length in limbs.
+    template <typename Rng>
+    BigUnsigned random_big(Rng& g, size_t limbs) {
+        BigUnsigned x;
+        for (size_t i = 0; i < limbs; ++i) {
+            x <<= 32;
+            x += BigUnsigned(g() & 0xFFFFFFFF);
+        }
+        return x;
+    }
+
+}
+
+
+TEST(bigint, small_operands) {
+    auto g = UNIT::rng(80);
+    for (int i = 0; i < 20000; ++i) {
+        std::uint64_t a = g() >> (g() % 64), b = g() >> (g() % 64);
+        BigUnsigned x(a), y(b);
+        CHECK((x + y).to_string() == to_string((unsigned __int128)a + b));
+        CHECK((x * y).to_string() == to_string((unsigned __int128)a * b));
+        if (a >= b)
+            CHECK((x - y).to_string() == std::to_string(a - b));
+        unsigned k = unsigned(g() % 64);
+        CHECK((x << k).to_string() == to_string((unsigned __int128)a << k));
+        CHECK((x < y) == (a < b));
+        CHECK((x == y) == (a == b));
+    }
+    CHECK(BigUnsigned().is_zero() && BigUnsigned().to_string() == "0");
+}
+
+TEST(bigint, identities) {
+    auto g = UNIT::rng(81);
+    // Across the schoolbook and Karatsuba sizes, and unbalanced operands.
+    const size_t limbs[] = {1, 2, 5, 31, 32, 33, 64, 100, 257};
+    for (size_t la : limbs)
+        for (size_t lb : limbs) {
+            BigUnsigned a = random_big(g, la), b = random_big(g, lb), c = random_big(g, 7);
+            CHECK((a + b) - b == a);
+            CHECK(a * b == b * a);
+            CHECK((a + b) * c == a * c + b * c);
+            CHECK(a * (b + BigUnsigned(1)) == a * b + a);
+            CHECK((a << 37) == a * (BigUnsigned(1) << 37));
+            CHECK(!(a < a) && (a < a + BigUnsigned(1)));
+            std::ostringstream os;
+            os << a;
+            CHECK(os.str() == a.to_string());
+        }
+}
@@ -0,0 +1,230 @@
+/*
+** SpscQueue and MpmcQueue of concurrent_queue.hh: FIFO order and capacity
+** from one thread, and every element popped exactly once across threads.
+*/
+
+#include "test.hh"
+#include "concurrent_queue.hh"
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+    // Counts the live instances, to find elements a queue leaks or frees twice.
+    struct counted {
+        static inline int live = 0;
+        int v = 0;
+        counted(int x = 0) : v(x) { ++live; }
+        counted(const counted& o) : v(o.v) { ++live; }
+        counted(counted&& o) noexcept : v(o.v) { ++live; }
+        counted& operator=(const counted&) = default;
+        counted& operator=(counted&&) noexcept = default;
+        ~counted() { --live; }
+    };
+
+    // Fill and drain q several laps over, at an offset that shifts every
+    // lap, so the counters wrap around the cells in every position.
+    template <typename Q>
+    void check_laps(Q& q) {
+        const size_t cap = q.capacity();
+        CHECK(cap >= 2 && (cap & (cap - 1)) == 0);
+        int next_in = 0, next_out = 0, x;
+        for (size_t lap = 0; lap < 6; ++lap) {
+            for (size_t k = 0; k < lap % cap; ++k) {
+                CHECK(q.try_push(next_in++));
+                CHECK(q.try_pop(x) && x == next_out++);
+            }
+            CHECK(q.empty() && !q.try_pop(x));
+            for (size_t k = 0; k < cap; ++k)
+                CHECK(q.try_push(next_in++));
+            CHECK(q.size_approx() == cap);
+            CHECK(!q.try_push(-1) && !q.try_emplace(-1));
+            for (size_t k = 0; k < cap; ++k)
+                CHECK(q.try_pop(x) && x == next_out++);
+            CHECK(q.empty() && !q.try_pop(x));
+        }
+    }
+
+    // Batches stop at the capacity, and at what the queue holds.
+    template <typename Q>
+    void check_batches(Q& q) {
+        const size_t cap = q.capacity();
+        std::vector<int> in(cap * 5 / 2), out;
+        for (size_t i = 0; i < in.size(); ++i)
+            in[i] = int(i);
+        size_t pushed = q.try_push_batch(in.begin(), in.end());
+        CHECK(pushed == cap);
+        CHECK(q.try_push_batch(in.begin() + pushed, in.end()) == 0);
+        CHECK(q.try_pop_batch(std::back_inserter(out), cap / 2) == cap / 2);
+        pushed += q.try_push_batch(in.begin() + pushed, in.end());
+        CHECK(pushed == cap + cap / 2);
+        CHECK(q.try_pop_batch(std::back_inserter(out), in.size()) == cap);
+        CHECK(q.try_pop_batch(std::back_inserter(out), in.size()) == 0);
+        CHECK(q.try_push_batch(in.begin() + pushed, in.end()) == cap);
+        CHECK(q.try_pop_batch(std::back_inserter(out), in.size()) == cap);
+        CHECK(out == in);
+    }
+
+    template <typename Q>
+    void check_move_only(Q& q) {
+        for (int lap = 0; lap < 3; ++lap) {
+            for (size_t k = 0; k < q.capacity(); ++k)
+                CHECK(q.try_push(std::make_unique<int>(int(k))));
+            CHECK(!q.try_push(std::make_unique<int>(-1)));
+            std::unique_ptr<int> p;
+            for (size_t k = 0; k < q.capacity(); ++k)
+                CHECK(q.try_pop(p) && p && *p == int(k));
+            CHECK(!q.try_pop(p));
+        }
+        // The element left over by a full batch is not moved from.
+        std::vector<std::unique_ptr<int>> in, out;
+        for (size_t i = 0; i <= q.capacity(); ++i)
+            in.push_back(std::make_unique<int>(int(i)));
+        CHECK(q.try_push_batch(in.begin(), in.end()) == q.capacity());
+        CHECK(in.back() && *in.back() == int(q.capacity()));
+        CHECK(q.try_pop_batch(std::back_inserter(out), in.size()) == q.capacity());
+        for (size_t i = 0; i < out.size(); ++i)
+            CHECK(*out[i] == int(i));
+    }
+
+    // A queue destroyed with elements in it, after its counters have moved
+    // on, destroys exactly those.
+    template <template <typename> class Q>
+    void check_destroy() {
+        {
+            Q<counted> q(8);
+            counted x;
+            for (int i = 0; i < 13; ++i)
+                CHECK(q.try_push(counted(i)) && q.try_pop(x));
+            for (int i = 0; i < 5; ++i)
+                CHECK(q.try_emplace(i));
+            CHECK(counted::live == 6);
+        }
+        CHECK(counted::live == 0);
+        {
+            Q<counted> q(8);
+            for (int i = 0; i < 8; ++i)
+                CHECK(q.try_push(counted(i)));
+        }
+        CHECK(counted::live == 0);
+    }
+
+}
+
+
+TEST(concurrent_queue, spsc) {
+    ADT::SpscQueue<int> q(5);
+    CHECK(q.capacity() == 8);
+    check_laps(q);
+    ADT::SpscQueue<int> b(16);
+    check_batches(b);
+    ADT::SpscQueue<std::unique_ptr<int>> m(4);
+    check_move_only(m);
+    check_destroy<ADT::SpscQueue>();
+}
+
+TEST(concurrent_queue, mpmc) {
+    ADT::MpmcQueue<int> q(5);
+    CHECK(q.capacity() == 8);
+    check_laps(q);
+    ADT::MpmcQueue<int> b(16);
+    check_batches(b);
+    ADT::MpmcQueue<std::unique_ptr<int>> m(4);
+    check_move_only(m);
+    check_destroy<ADT::MpmcQueue>();
+}
+
+TEST(concurrent_queue, spsc_threads) {
+    // The consumer sees 0, 1, 2, ... in order; half the pushes and pops go
+    // through the batch calls. A small queue keeps both sides wrapping.
+    const int N = 200000;
+    ADT::SpscQueue<int> q(64);
+    std::thread producer([&q, N] {
+        int batch[7];
+        for (int i = 0; i < N; ) {
+            if (i % 2) {
+                int k = 0;
+                for (; k < 7 && i + k < N; ++k)
+                    batch[k] = i + k;
+                i += int(q.try_push_batch(batch, batch + k));
+            }
+            else if (q.try_push(i))
+                ++i;
+            else
+                std::this_thread::yield();
+        }
+    });
+    int expected = 0;
+    size_t wrong = 0;
+    std::vector<int> batch;
+    while (expected < N) {
+        int x;
+        batch.clear();
+        if (expected % 3 == 0)
+            q.try_pop_batch(std::back_inserter(batch), 5);
+        else if (q.try_pop(x))
+            batch.push_back(x);
+        if (batch.empty())
+            std::this_thread::yield();
+        for (int y : batch)
+            wrong += y != expected++;
+    }
+    producer.join();
+    CHECK(wrong == 0);
+    CHECK(q.empty());
+}
+
+TEST(concurrent_queue, mpmc_threads) {
+    // Four producers push disjoint ranges and four consumers pop until all
+    // are taken: every value is popped once, and each consumer sees the
+    // values of one producer in the order they were pushed.
+    const int P = 4, C = 4, N = 50000;
+    ADT::MpmcQueue<int> q(128);
+    std::atomic<int> popped{0};
+    std::vector<std::atomic<int>> seen(P * N);
+    std::atomic<size_t> out_of_order{0};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < P; ++p)
+        threads.emplace_back([&q, p, N] {
+            for (int i = 0; i < N; ) {
+                if (q.try_push(p * N + i))
+                    ++i;
+                else
+                    std::this_thread::yield();
+            }
+        });
+    for (int c = 0; c < C; ++c)
+        threads.emplace_back([&, c] {
+            std::vector<int> last(P, -1), batch;
+            while (popped.load(std::memory_order_relaxed) < P * N) {
+                int x;
+                batch.clear();
+                if (c % 2)
+                    q.try_pop_batch(std::back_inserter(batch), 8);
+                else if (q.try_pop(x))
+                    batch.push_back(x);
+                if (batch.empty())
+                    std::this_thread::yield();
+                for (int y : batch) {
+                    seen[y].fetch_add(1, std::memory_order_relaxed);
+                    if (y % N <= last[y / N])
+                        ++out_of_order;
+                    last[y / N] = y % N;
+                }
+                popped.fetch_add(int(batch.size()), std::memory_order_relaxed);
+            }
+        });
+    for (auto& th : threads)
+        th.join();
+    CHECK(popped == P * N && q.empty());
+    CHECK(out_of_order == 0);
+    size_t not_once = 0;
+    for (auto& s : seen)
+        not_once += s != 1;
+    CHECK(not_once == 0);
+}
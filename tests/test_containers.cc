@@ -0,0 +1,293 @@
+/*
+** vector.hh against std::vector; the stacks, queues and lists of stack.hh,
+** queue.hh and list.hh against std::vector and std::deque.
+*/
+
+#include "test.hh"
+#include "vector.hh"
+#include "stack.hh"
+#include "queue.hh"
+#include "list.hh"
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+    template <typename Vec>
+    void check_vector(std::uint64_t salt) {
+        Vec v;
+        std::vector<std::string> expected;
+        auto g = UNIT::rng(salt);
+        for (size_t i = 0; i < 20000; ++i) {
+            std::string s = std::to_string(g() % 1000) + std::string(g() % 40, 'x');
+            size_t pos = expected.empty() ? 0 : g() % (expected.size() + 1);
+            switch (g() % 8) {
+                case 0:
+                case 1:
+                    v.push_back(s);
+                    expected.push_back(s);
+                    break;
+                case 2:
+                    CHECK(v.emplace_back(s) == s);
+                    expected.emplace_back(s);
+                    break;
+                case 3:
+                    CHECK(*v.insert(v.begin() + pos, s) == s);
+                    expected.insert(expected.begin() + pos, s);
+                    break;
+                case 4:
+                    if (pos < expected.size()) {
+                        v.erase(v.begin() + pos);
+                        expected.erase(expected.begin() + pos);
+                    }
+                    break;
+                case 5:
+                    if (!expected.empty()) {
+                        v.pop_back();
+                        expected.pop_back();
+                    }
+                    break;
+                case 6: {
+                    // Insert a range of up to three elements.
+                    size_t n = std::min<size_t>(expected.size() - pos, g() % 4);
+                    std::vector<std::string> src(expected.begin() + pos, expected.begin() + pos + n);
+                    v.insert(v.begin() + pos, src.begin(), src.end());
+                    expected.insert(expected.begin() + pos, src.begin(), src.end());
+                    break;
+                }
+                case 7:
+                    if (g() % 16 == 0) {
+                        size_t n = g() % 64;
+                        v.resize(n, s);
+                        expected.resize(n, s);
+                    }
+                    break;
+            }
+            CHECK(v.size() == expected.size());
+            if (i % 256 == 0)
+                CHECK(std::equal(v.begin(), v.end(), expected.begin(), expected.end()));
+        }
+        CHECK(std::equal(v.begin(), v.end(), expected.begin(), expected.end()));
+        Vec copy(v), moved(std::move(v));
+        CHECK(std::equal(copy.begin(), copy.end(), expected.begin(), expected.end()));
+        CHECK(std::equal(moved.begin(), moved.end(), expected.begin(), expected.end()));
+        swap(copy, moved);
+        copy.clear();
+        CHECK(copy.empty() && moved.size() == expected.size());
+    }
+
+    // DNodeIterator has no iterator_traits, so no std::equal.
+    template <typename List>
+    bool same_elements(const List& l, const std::deque<int>& expected) {
+        auto e = expected.begin();
+        for (auto it = l.begin(); it != l.end(); ++it, ++e)
+            if (e == expected.end() || *it != *e)
+                return false;
+        return e == expected.end();
+    }
+
+    template <typename Stack>
+    void check_stack(Stack& s, std::uint64_t salt) {
+        std::vector<int> expected;
+        auto g = UNIT::rng(salt);
+        for (int i = 0; i < 100000; ++i) {
+            if (expected.empty() || g() % 3) {
+                int x = int(g() % 1000);
+                s.push(x);
+                expected.push_back(x);
+            }
+            else {
+                CHECK(s.top() == expected.back());
+                s.pop();
+                expected.pop_back();
+            }
+            CHECK(size_t(s.size()) == expected.size());
+        }
+    }
+
+    template <typename Queue>
+    void check_queue(Queue& q, size_t max_len, std::uint64_t salt) {
+        std::deque<int> expected;
+        auto g = UNIT::rng(salt);
+        for (int i = 0; i < 100000; ++i) {
+            if (expected.empty() || (g() % 2 && expected.size() < max_len)) {
+                int x = int(g() % 1000);
+                q.enqueue(x);
+                expected.push_back(x);
+            }
+            else {
+                CHECK(q.front() == expected.front());
+                q.dequeue();
+                expected.pop_front();
+            }
+            CHECK(size_t(q.size()) == expected.size());
+        }
+    }
+
+}
+
+
+TEST(containers, vector) {
+    check_vector<ADT::vector<std::string>>(70);
+    check_vector<ADT::small_vector<std::string, 8>>(71);
+}
+
+TEST(containers, vector_trivial) {
+    ADT::vector<int> v;
+    std::vector<int> expected;
+    for (int i = 0; i < 100000; ++i) {
+        v.push_back(i);
+        expected.push_back(i);
+    }
+    v.erase(v.begin() + 10, v.begin() + 50000);
+    expected.erase(expected.begin() + 10, expected.begin() + 50000);
+    v.shrink_to_fit();
+    CHECK(v.capacity() == v.size());
+    CHECK(std::equal(v.begin(), v.end(), expected.begin(), expected.end()));
+}
+
+TEST(containers, stacks) {
+    ADT::ArrayStack<int> a;  // grows past any reserve hint
+    check_stack(a, 72);
+    CHECK_THROWS(std::exception, ADT::ArrayStack<int>().pop());
+    ADT::LinkedStack<int> l;
+    check_stack(l, 73);
+}
+
+TEST(containers, stack_move_only) {
+    ADT::ArrayStack<std::unique_ptr<int>> s(4);
+    for (int i = 0; i < 1000; ++i)
+        s.emplace(std::make_unique<int>(i));
+    CHECK(s.size() == 1000 && s.capacity() >= 1000);
+    *s.top() += 1;
+    CHECK(*s.pop() == 1000);
+    for (int i = 998; i >= 500; --i)
+        CHECK(*s.pop() == i);
+    s.clear();
+    CHECK(s.empty());
+    CHECK_THROWS(std::exception, s.pop());
+}
+
+TEST(containers, queues) {
+    ADT::ArrayQueue<int> a(100);
+    check_queue(a, 100, 74);
+    CHECK_THROWS(std::exception, ADT::ArrayQueue<int>().dequeue());
+    ADT::LinkedQueue<int> l;
+    check_queue(l, SIZE_MAX, 75);
+}
+
+TEST(containers, deque) {
+    ADT::Deque<std::string> d;
+    std::deque<std::string> expected;
+    auto g = UNIT::rng(76);
+    for (int i = 0; i < 100000; ++i) {
+        std::string s = std::to_string(g() % 1000);
+        switch (expected.empty() ? g() % 2 : g() % 5) {
+            case 0:
+                d.insert_front(s);
+                expected.push_front(s);
+                break;
+            case 1:
+                d.insert_back(s);
+                expected.push_back(s);
+                break;
+            case 2:
+                CHECK(d.front() == expected.front());
+                d.remove_front();
+                expected.pop_front();
+                break;
+            case 3:
+                CHECK(d.back() == expected.back());
+                d.remove_back();
+                expected.pop_back();
+                break;
+            case 4:
+                // An element of the deque itself, which may move on a regrow.
+                d.insert_back(d[g() % d.size()]);
+                expected.push_back(d.back());
+                break;
+        }
+        CHECK(d.size() == expected.size());
+        if (i % 1000 == 0)
+            for (size_t j = 0; j < expected.size(); ++j)
+                CHECK(d[j] == expected[j]);
+    }
+    ADT::Deque<std::string> copy(d);
+    for (size_t j = 0; j < expected.size(); ++j)
+        CHECK(copy[j] == expected[j]);
+}
+
+TEST(containers, lists) {
+    ADT::LinkedList<int> ll;
+    ADT::CLinkedList<int> cl;
+    ADT::DLinkedList<int> dl;
+    std::deque<int> stack, queue, deque;
+    auto g = UNIT::rng(77);
+    for (int i = 0; i < 50000; ++i) {
+        int x = int(g() % 1000);
+        bool add = g() % 3 != 0;
+        if (add || stack.empty()) {
+            ll.insert_front(x);
+            stack.push_front(x);
+        }
+        else {
+            CHECK(ll.front() == stack.front());
+            ll.remove_front();
+            stack.pop_front();
+        }
+        // CLinkedList inserts after the cursor and removes the element
+        // after it; advance() moves the cursor to the front.
+        if (add || queue.empty()) {
+            cl.insert(x);
+            cl.advance();
+            queue.push_back(x);
+        }
+        else {
+            CHECK(cl.front() == queue.front());
+            cl.remove();
+            queue.pop_front();
+        }
+        if (add || deque.empty()) {
+            if (x % 2) {
+                dl.push_front(x);
+                deque.push_front(x);
+            }
+            else {
+                dl.push_back(x);
+                deque.push_back(x);
+            }
+        }
+        else if (x % 2) {
+            CHECK(dl.front() == deque.front());
+            dl.pop_front();
+            deque.pop_front();
+        }
+        else {
+            CHECK(dl.back() == deque.back());
+            dl.pop_back();
+            deque.pop_back();
+        }
+        CHECK(ll.empty() == stack.empty() && cl.empty() == queue.empty());
+        CHECK(dl.size() == deque.size());
+    }
+    CHECK(same_elements(dl, deque));
+    ADT::LinkedList<int> ll2(ll);
+    for (int x : stack) {
+        CHECK(ll2.front() == x);
+        ll2.remove_front();
+    }
+    CHECK(ll2.empty());
+    ADT::CLinkedList<int> cl2(cl);
+    for (int x : queue) {
+        CHECK(cl2.front() == x);
+        cl2.remove();
+    }
+    CHECK(cl2.empty());
+    ADT::DLinkedList<int> dl2(dl);
+    CHECK(same_elements(dl2, deque));
+}
@@ -0,0 +1,205 @@
+/*
+** The DP exercises of dp.hh against plain reference solutions.
+*/
+
+#include "test.hh"
+#include "dp.hh"
+#include "bigint.hh"
+#include "exception.hh"
+#include "thread_pool.hh"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+    const char* TEXT =
+        "The quick brown fox jumps over the lazy dog. Pack my box with five dozen liquor jugs.\n\n"
+        "How vexingly quick daft zebras jump! Sphinx of black quartz, judge my vow. "
+        "averyveryveryverylongwordthatdoesnotfitonanyline ok";
+
+    // The least total badness of words [0, n), trying every line end.
+    double reference_cost(const std::vector<size_t>& prefix, unsigned page_width) {
+        size_t n = prefix.size() - 1;
+        std::vector<double> dp(n + 1, 0);
+        for (size_t i = n; i-- > 0; ) {
+            dp[i] = std::numeric_limits<double>::infinity();
+            for (size_t j = i + 1; j <= n; ++j) {
+                size_t width = prefix[j] - prefix[i] - 1;
+                if (width <= page_width) {
+                    double slack = page_width - width;
+                    dp[i] = std::min(dp[i], slack * slack * slack + dp[j]);
+                }
+                else if (j == i + 1)
+                    dp[i] = dp[j];
+            }
+        }
+        return dp[0];
+    }
+
+    // Blackjack hand score of the cards deck[k] for k in ks: face cards
+    // count 10, and one ace 11 when that does not bust.
+    int hand_score(const std::vector<int>& deck, const std::vector<size_t>& ks) {
+        int hard = 0;
+        bool ace = false;
+        for (size_t k : ks) {
+            hard += std::min(deck[k], 10);
+            ace |= deck[k] == 1;
+        }
+        return ace && hard <= 11 ? hard + 10 : hard;
+    }
+
+    // Max winnings of the blackjack player from card i on, top-down with
+    // every hand scored from its cards.
+    int reference_blackjack(const std::vector<int>& deck) {
+        size_t n = deck.size();
+        std::vector<int> memo(n + 1, std::numeric_limits<int>::min());
+        std::function<int(size_t)> best = [&](size_t i) {
+            if (i + 4 > n)
+                return 0;
+            if (memo[i] != std::numeric_limits<int>::min())
+                return memo[i];
+            int result = std::numeric_limits<int>::min();
+            std::vector<size_t> player = {i, i + 2};
+            for (size_t p = 2; i + p + 2 <= n; ++p) {
+                if (p > 2)
+                    player.push_back(i + p + 1);
+                int ps = hand_score(deck, player);
+                if (ps > 21) {
+                    result = std::max(result, -1 + best(i + p + 2));
+                    break;
+                }
+                std::vector<size_t> dealer = {i + 1, i + 3};
+                size_t next = i + p + 2;
+                while (hand_score(deck, dealer) < 17 && next < n)
+                    dealer.push_back(next++);
+                int ds = hand_score(deck, dealer);
+                if (ds > 21)
+                    ds = 0;
+                result = std::max(result, (ps > ds) - (ds > ps) + best(next));
+            }
+            return memo[i] = result;
+        };
+        return best(0);
+    }
+
+}
+
+
+TEST(dp, fibonacci) {
+    for (unsigned n = 0; n <= DP::FIB_MAX_N; ++n) {
+        std::uint64_t f = DP::fib(n);
+        CHECK(DP::fib_bottomup(n) == f);
+        CHECK(DP::fib_doubling(n) == f);
+        CHECK(DP::fib_big(n).to_string() == std::to_string(f));
+        if (n >= 2)
+            CHECK(f == DP::fib(n - 1) + DP::fib(n - 2));
+    }
+    CHECK_THROWS(ADT::Overflow, DP::fib(DP::FIB_MAX_N + 1));
+    CHECK_THROWS(ADT::Overflow, DP::fib_doubling(DP::FIB_MAX_N + 1));
+    // F(2k) = F(k) (2 F(k+1) - F(k)) and F(2k+1) = F(k)^2 + F(k+1)^2 far
+    // beyond 64 bits.
+    for (unsigned k : {100u, 1000u, 5000u}) {
+        ADT::BigUnsigned fk = DP::fib_big(k), fk1 = DP::fib_big(k + 1);
+        CHECK(DP::fib_big(2 * k) == fk * (fk1 + fk1 - fk));
+        CHECK(DP::fib_big(2 * k + 1) == fk * fk + fk1 * fk1);
+    }
+}
+
+TEST(dp, justify) {
+    std::istringstream in(TEXT);
+    DP::WordReader reader(in);
+    std::string text;
+    std::vector<size_t> prefix {0};
+    CHECK(reader.read(text, prefix, false));
+    CHECK(prefix.size() == 33);
+    for (unsigned width : {10u, 16u, 25u, 40u, 80u}) {
+        std::vector<double> dp;
+        std::vector<unsigned> parents;
+        double cost = DP::justify_words(prefix, width, dp, parents);
+        CHECK(cost == reference_cost(prefix, width) && cost == dp[0]);
+        for (size_t i = 0; i < parents.size(); i = parents[i]) {
+            // Every line fits, unless it is one overlong word.
+            CHECK(parents[i] > i);
+            CHECK(prefix[parents[i]] - prefix[i] - 1 <= width || parents[i] == i + 1);
+        }
+    }
+}
+
+TEST(dp, justify_stream) {
+    // Two paragraphs, each justified on its own, separated by a blank line.
+    std::istringstream in(TEXT);
+    std::ostringstream out;
+    CHECK(DP::justify_stream(in, out, 25) == 32);
+    std::istringstream lines(out.str());
+    std::string line;
+    size_t words = 0, blank = 0;
+    while (std::getline(lines, line)) {
+        if (line.empty()) {
+            ++blank;
+            continue;
+        }
+        std::istringstream ws(line);
+        std::string w;
+        size_t k = 0;
+        for (; ws >> w; ++k)
+            ++words;
+        CHECK(line.size() <= 25 || k == 1);
+    }
+    CHECK(words == 32 && blank == 1);
+}
+
+TEST(dp, justify_batch) {
+    std::istringstream text(TEXT);
+    DP::Document doc = DP::read_document(text);
+    CHECK(doc.size() == 32);
+    ADT::thread_pool pool(2);
+    std::vector<unsigned> widths = {10, 16, 25, 40, 80};
+    auto batch = DP::justify_batch({doc, doc}, widths, pool);
+    CHECK(batch.size() == 2);
+    for (size_t w = 0; w < widths.size(); ++w) {
+        std::vector<double> dp;
+        std::vector<unsigned> parents;
+        double cost = DP::justify_words(doc.prefix, widths[w], dp, parents);
+        for (const auto& result : batch) {
+            const DP::Justified& j = result[w];
+            CHECK(j.page_width == widths[w] && j.cost == cost);
+            CHECK(j.breaks.front() == 0 && j.breaks.back() == doc.size());
+            for (size_t k = 0; k + 1 < j.breaks.size(); ++k) {
+                CHECK(j.breaks[k + 1] == parents[j.breaks[k]]);
+                size_t width = doc.words(j.breaks[k], j.breaks[k + 1]).size();
+                CHECK(width <= widths[w] || j.breaks[k + 1] == j.breaks[k] + 1);
+            }
+        }
+    }
+}
+
+TEST(dp, blackjack) {
+    auto g = UNIT::rng(90);
+    std::vector<int> best;
+    for (int round = 0; round < 300; ++round) {
+        std::vector<int> deck = DP::blackjack_shoe(1 + round % 3, g);
+        CHECK(deck.size() == 52 * size_t(1 + round % 3));
+        int profit = DP::blackjack_solve(deck, best);
+        CHECK(profit == reference_blackjack(deck));
+        CHECK(profit == DP::blackjack_solve(deck));
+    }
+    // Fewer than four cards make no round.
+    CHECK(DP::blackjack_solve({1, 10, 1}) == 0);
+}
+
+TEST(dp, blackjack_batch) {
+    ADT::thread_pool pool(2);
+    auto runs = DP::blackjack_batch(8, 2, 99, pool);
+    CHECK(runs.size() == 8);
+    for (size_t k = 0; k < runs.size(); ++k) {
+        std::mt19937_64 rng(99 + k);
+        CHECK(DP::blackjack_solve(DP::blackjack_shoe(2, rng)) == runs[k].profit);
+    }
+}
@@ -0,0 +1,128 @@
+/*
+** external_sort.hh against std::sort, with budgets that force several runs
+** and merge passes.
+*/
+
+#include "test.hh"
+#include "external_sort.hh"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+#include <vector>
+
+
+namespace {
+
+    template <typename T>
+    void write_file(const std::string& path, const std::vector<T>& v) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(v.data()), std::streamsize(v.size() * sizeof(T)));
+        CHECK(out.good());
+    }
+
+    template <typename T>
+    std::vector<T> read_file(const std::string& path) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        std::vector<T> v(size_t(in.tellg()) / sizeof(T));
+        in.seekg(0);
+        in.read(reinterpret_cast<char*>(v.data()), std::streamsize(v.size() * sizeof(T)));
+        return v;
+    }
+
+    struct scratch_files {
+        std::string input = UNIT::temp_path("in"), output = UNIT::temp_path("out");
+        ~scratch_files() {
+            std::remove(input.c_str());
+            std::remove(output.c_str());
+        }
+    };
+
+    struct record {
+        std::uint32_t key;
+        std::uint32_t seq;
+        bool operator==(const record& r) const { return key == r.key && seq == r.seq; }
+    };
+
+    // Sort n random keys with the given budget and compare to std::sort.
+    void check_external_sort(size_t n, size_t memory_bytes, size_t block_bytes, ADT::thread_pool* pool = nullptr) {
+        auto g = UNIT::rng(n);
+        std::vector<std::uint64_t> v(n);
+        for (auto& x : v)
+            x = g() % (n + 1);
+        scratch_files files;
+        write_file(files.input, v);
+        SORT::external_sort_options opt;
+        opt.memory_bytes = memory_bytes;
+        opt.block_bytes = block_bytes;
+        opt.pool = pool;
+        CHECK(SORT::external_sort<std::uint64_t>(files.input, files.output, opt) == n);
+        std::sort(v.begin(), v.end());
+        CHECK(read_file<std::uint64_t>(files.output) == v);
+    }
+
+}
+
+
+TEST(external_sort, in_memory) {
+    check_external_sort(0, 1 << 20, 4096);
+    check_external_sort(1, 1 << 20, 4096);
+    check_external_sort(10000, 1 << 20, 4096);
+    // With a pool, runs are half the budget: 800 KB of records in 1 MiB make
+    // two runs, each sorted in parallel.
+    ADT::thread_pool pool(2);
+    check_external_sort(100000, 1 << 20, 4096, &pool);
+}
+
+TEST(external_sort, merge_passes) {
+    // 8 KiB of records in memory: 200000 records make about 200 runs,
+    // merged 31 at a time.
+    check_external_sort(200000, 8 << 10, 128);
+    ADT::thread_pool pool(2);
+    check_external_sort(200000, 8 << 10, 128, &pool);
+}
+
+TEST(external_sort, tiny_budgets) {
+    // Budgets below a few blocks still sort, with a fan-in of 2.
+    check_external_sort(5000, 100, 4096);
+    check_external_sort(5000, 800, 64);
+    check_external_sort(5000, 0, 8);
+}
+
+TEST(external_sort, comp_proj) {
+    auto g = UNIT::rng(5);
+    std::vector<record> v(50000);
+    for (size_t i = 0; i < v.size(); ++i)
+        v[i] = {std::uint32_t(g() % 1000), std::uint32_t(i)};
+    scratch_files files;
+    write_file(files.input, v);
+    SORT::external_sort_options opt;
+    opt.memory_bytes = 16 << 10;
+    opt.block_bytes = 512;
+    SORT::external_sort<record>(files.input, files.output, opt, std::greater<>(), &record::key);
+    std::vector<record> out = read_file<record>(files.output);
+    CHECK(out.size() == v.size());
+    CHECK(std::is_sorted(out.begin(), out.end(), [](const record& a, const record& b) { return a.key > b.key; }));
+    std::sort(v.begin(), v.end(), [](const record& a, const record& b) { return a.seq < b.seq; });
+    std::sort(out.begin(), out.end(), [](const record& a, const record& b) { return a.seq < b.seq; });
+    CHECK(out == v);
+}
+
+TEST(external_sort, output_is_input) {
+    scratch_files files;
+    std::vector<std::uint64_t> v = {3, 1, 2};
+    write_file(files.input, v);
+    CHECK_THROWS(std::invalid_argument, SORT::external_sort<std::uint64_t>(files.input, files.input));
+    // A hard link is the same file under another name.
+    CHECK(::link(files.input.c_str(), files.output.c_str()) == 0);
+    CHECK_THROWS(std::invalid_argument, SORT::external_sort<std::uint64_t>(files.input, files.output));
+    CHECK(read_file<std::uint64_t>(files.input) == v);
+}
+
+TEST(external_sort, partial_record) {
+    // A size that is not a multiple of the record size is an error.
+    scratch_files files;
+    write_file(files.input, std::vector<char>(sizeof(std::uint64_t) * 3 + 1));
+    CHECK_THROWS(std::invalid_argument, SORT::external_sort<std::uint64_t>(files.input, files.output));
+}
@@ -0,0 +1,347 @@
+/*
+** unordered_map.hh, flat_hash_map.hh and concurrent_unordered_map.hh
+** against std::unordered_map.
+*/
+
+#include "test.hh"
+#include "unordered_map.hh"
+#include "flat_hash_map.hh"
+#include "concurrent_unordered_map.hh"
+#include "allocator.hh"
+#include "map_stats.hh"
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+
+    template <typename K> K make_key(std::uint64_t i);
+    template <> std::uint64_t make_key<std::uint64_t>(std::uint64_t i) { return i * 0x9E3779B97F4A7C15ULL; }
+    template <> std::string make_key<std::string>(std::uint64_t i) { return "key-" + std::to_string(i); }
+
+    // A value whose copy throws once copies_left runs out, counting the
+    // live instances.
+    struct throwing_copy {
+        static inline int live = 0, copies_left = -1;
+        std::uint64_t v = 0;
+        throwing_copy() { ++live; }
+        throwing_copy(std::uint64_t x) : v(x) { ++live; }
+        throwing_copy(const throwing_copy& o) : v(o.v) {
+            if (copies_left == 0)
+                throw std::runtime_error("copy");
+            --copies_left;
+            ++live;
+        }
+        throwing_copy& operator=(const throwing_copy&) = default;
+        ~throwing_copy() { --live; }
+    };
+
+    // Every element of m is in expected with the same value, and both have
+    // the same size. Walks m through its const iterators.
+    template <typename Map, typename Std>
+    void check_same(const Map& m, const Std& expected) {
+        CHECK(m.size() == expected.size());
+        CHECK(m.empty() == expected.empty());
+        size_t n = 0;
+        for (auto it = m.cbegin(); it != m.cend(); ++it, ++n) {
+            auto e = expected.find(it -> first);
+            CHECK(e != expected.end() && e -> second == it -> second);
+        }
+        CHECK(n == expected.size());
+    }
+
+    // Replay random operations on m and on a std::unordered_map, over
+    // key_range keys so that about half the lookups hit.
+    template <typename Map>
+    void check_random_ops(Map& m, size_t ops, std::uint64_t key_range, std::uint64_t salt) {
+        using K = typename std::decay<decltype(m.begin() -> first)>::type;
+        std::unordered_map<K, std::uint64_t> expected;
+        auto g = UNIT::rng(salt);
+        const Map& cm = m;
+        for (size_t i = 0; i < ops; ++i) {
+            K key = make_key<K>(g() % key_range);
+            std::uint64_t val = g();
+            switch (g() % 8) {
+                case 0:
+                    m[key] += val;
+                    expected[key] += val;
+                    break;
+                case 1:
+                    CHECK(m.try_emplace(key, val).second == expected.try_emplace(key, val).second);
+                    break;
+                case 2:
+                    CHECK(m.insert_or_assign(key, val).second == expected.insert_or_assign(key, val).second);
+                    break;
+                case 3:
+                case 4:
+                    CHECK(m.erase(key) == expected.erase(key));
+                    break;
+                case 5: {
+                    auto it = m.find(key);
+                    auto e = expected.find(key);
+                    CHECK((it == m.end()) == (e == expected.end()));
+                    if (e != expected.end()) {
+                        CHECK(it -> first == key && it -> second == e -> second);
+                        it -> second = val;  // through the mutable iterator
+                        e -> second = val;
+                    }
+                    break;
+                }
+                case 6: {
+                    auto it = cm.find(key);
+                    auto e = expected.find(key);
+                    CHECK((it == cm.end()) == (e == expected.end()));
+                    CHECK(cm.contains(key) == (e != expected.end()));
+                    if (e != expected.end())
+                        CHECK(it -> second == e -> second);
+                    break;
+                }
+                case 7:
+                    if (g() % 64 == 0)
+                        check_same(cm, expected);
+                    break;
+            }
+        }
+        check_same(cm, expected);
+        m.clear();
+        CHECK(m.empty() && m.begin() == m.end());
+    }
+
+    // Lookups by string_view and C string in a map of strings.
+    template <typename Map>
+    void check_heterogeneous(Map& m) {
+        for (int i = 0; i < 1000; ++i)
+            m.try_emplace(std::string_view(make_key<std::string>(i)), i);
+        const Map& cm = m;
+        for (int i = 0; i < 2000; ++i) {
+            std::string k = make_key<std::string>(i);
+            std::string_view kv = k;
+            CHECK(cm.contains(kv) == (i < 1000));
+            CHECK(cm.contains(k.c_str()) == (i < 1000));
+            auto it = m.find(kv);
+            CHECK((it != m.end()) == (i < 1000));
+            if (i < 1000)
+                CHECK(it -> first == k && it -> second == std::uint64_t(i));
+        }
+        CHECK(!m.insert_or_assign(std::string_view(make_key<std::string>(7)), 70).second);
+        CHECK(m[make_key<std::string>(7)] == 70);
+        for (int i = 0; i < 1000; i += 2)
+            CHECK(m.erase(std::string_view(make_key<std::string>(i))) == 1);
+        CHECK(m.size() == 500);
+    }
+
+    // Every lookup is counted once, and the histogram accounts for every
+    // element. Chains sum to the buckets for unordered_map.
+    template <typename Map>
+    void check_stats(Map& m, bool chains) {
+        auto g = UNIT::rng(25);
+        size_t lookups = 0, hits = 0;
+        for (std::uint64_t i = 0; i < 20000; ++i) {
+            std::uint64_t key = g() % 10000;
+            switch (g() % 3) {
+                case 0:
+                    hits += 2 * (m.find(key) != m.end());  // then operator[] hits too
+                    m[key] = i;
+                    lookups += 2;
+                    break;
+                case 1:
+                    hits += m.find(key) != m.end();
+                    ++lookups;
+                    break;
+                case 2:
+                    hits += m.erase(key);
+                    ++lookups;
+                    break;
+            }
+        }
+        ADT::hash_map_stats st = m.stats();
+        CHECK(st.counters.hits + st.counters.misses == lookups);
+        CHECK(st.counters.hits == hits && st.counters.max_probes >= 1);
+        CHECK(st.size == m.size() && st.bytes > 0);
+        size_t elements = 0, buckets = 0;
+        for (size_t k = 0; k < st.histogram.size(); ++k) {
+            elements += (chains ? k : 1) * st.histogram[k];
+            buckets += st.histogram[k];
+            if (st.histogram[k])
+                CHECK(k <= st.max_chain);
+        }
+        CHECK(elements == m.size());
+        if (chains)
+            CHECK(buckets == st.bucket_count);
+        m.reset_stats();
+        CHECK(m.stats().counters.hits + m.stats().counters.misses == 0);
+    }
+
+}
+
+
+TEST(hash_maps, unordered_map) {
+    ADT::unordered_map<std::uint64_t, std::uint64_t> m;
+    check_random_ops(m, 200000, 5000, 10);
+    ADT::unordered_map<std::string, std::uint64_t> s;
+    check_random_ops(s, 100000, 5000, 11);
+}
+
+TEST(hash_maps, unordered_map_policies) {
+    ADT::unordered_map<std::uint64_t, std::uint64_t, ADT::hasher<std::uint64_t>, ADT::modulo_policy> mod;
+    check_random_ops(mod, 100000, 5000, 12);
+    ADT::unordered_map<std::uint64_t, std::uint64_t, ADT::hasher<std::uint64_t>, ADT::fastrange_policy> fr;
+    check_random_ops(fr, 100000, 5000, 13);
+    ADT::pool_resource pool;
+    using alloc = ADT::pool_allocator<std::pair<std::uint64_t, std::uint64_t>>;
+    ADT::unordered_map<std::uint64_t, std::uint64_t, ADT::hasher<std::uint64_t>, ADT::power_of_two_policy,
+                       ADT::eager_rehash, alloc> pooled {alloc(pool)};
+    check_random_ops(pooled, 100000, 5000, 14);
+}
+
+TEST(hash_maps, unordered_map_incremental) {
+    // Step 1 keeps a rehash in progress across many operations.
+    ADT::unordered_map<std::uint64_t, std::uint64_t, ADT::hasher<std::uint64_t>, ADT::power_of_two_policy,
+                       ADT::incremental_rehash<1>> m;
+    check_random_ops(m, 200000, 20000, 15);
+    ADT::unordered_map<std::string, std::uint64_t, ADT::hasher<std::string>, ADT::power_of_two_policy,
+                       ADT::incremental_rehash<>, std::allocator<std::pair<std::string, std::uint64_t>>,
+                       ADT::map_stats> s;
+    check_random_ops(s, 100000, 20000, 16);
+    CHECK(s.stats().counters.rehashes > 0);
+}
+
+TEST(hash_maps, unordered_map_heterogeneous) {
+    ADT::unordered_map<std::string, std::uint64_t> m;
+    check_heterogeneous(m);
+    ADT::unordered_map<std::string, std::uint64_t, ADT::hasher<std::string>, ADT::power_of_two_policy,
+                       ADT::incremental_rehash<1>> inc;
+    check_heterogeneous(inc);
+}
+
+TEST(hash_maps, flat_hash_map) {
+    ADT::flat_hash_map<std::uint64_t, std::uint64_t> m;
+    check_random_ops(m, 200000, 5000, 20);
+    ADT::flat_hash_map<std::string, std::uint64_t> s;
+    check_random_ops(s, 100000, 5000, 21);
+    ADT::flat_hash_map<std::string, std::uint64_t> h;
+    check_heterogeneous(h);
+}
+
+TEST(hash_maps, flat_hash_map_copy) {
+    ADT::flat_hash_map<std::string, std::uint64_t> m;
+    std::unordered_map<std::string, std::uint64_t> expected;
+    for (std::uint64_t i = 0; i < 3000; ++i) {
+        m[make_key<std::string>(i)] = i;
+        expected[make_key<std::string>(i)] = i;
+    }
+    for (std::uint64_t i = 0; i < 3000; i += 3) {
+        m.erase(make_key<std::string>(i));
+        expected.erase(make_key<std::string>(i));
+    }
+    ADT::flat_hash_map<std::string, std::uint64_t> copy(m);
+    check_same(copy, expected);
+    m.clear();
+    check_same(copy, expected);
+    // Lookups and iteration through a const map.
+    const auto& c = copy;
+    size_t n = 0;
+    for (auto it = c.cbegin(); it != c.cend(); ++it, ++n)
+        CHECK(expected.at(it -> first) == it -> second);
+    CHECK(n == expected.size());
+    CHECK(c.contains(make_key<std::string>(1)) && c.find(make_key<std::string>(1)) -> second == 1);
+    CHECK(!c.contains(make_key<std::string>(0)) && c.find(make_key<std::string>(0)) == c.end());
+    ADT::flat_hash_map<std::string, std::uint64_t>::const_iterator first = copy.begin();
+    CHECK(first == c.begin());
+}
+
+TEST(hash_maps, flat_hash_map_copy_throws) {
+    // A copy that throws halfway destroys the elements it built.
+    using map = ADT::flat_hash_map<std::uint64_t, throwing_copy>;
+    {
+        map m;
+        for (std::uint64_t i = 0; i < 1000; ++i)
+            m[i] = throwing_copy(i);
+        CHECK(throwing_copy::live == 1000);
+        throwing_copy::copies_left = 500;
+        CHECK_THROWS(std::runtime_error, map copy(m));
+        throwing_copy::copies_left = -1;
+        CHECK(throwing_copy::live == 1000);
+        map copy(m);
+        CHECK(copy.size() == 1000 && copy.find(7) -> second.v == 7);
+    }
+    CHECK(throwing_copy::live == 0);
+}
+
+TEST(hash_maps, stats) {
+    ADT::unordered_map<std::uint64_t, std::uint64_t, ADT::hasher<std::uint64_t>, ADT::power_of_two_policy,
+                       ADT::eager_rehash, std::allocator<std::pair<std::uint64_t, std::uint64_t>>,
+                       ADT::map_stats> m;
+    check_stats(m, true);
+    ADT::flat_hash_map<std::uint64_t, std::uint64_t, ADT::hasher<std::uint64_t>, ADT::map_stats> f;
+    check_stats(f, false);
+}
+
+TEST(hash_maps, concurrent_unordered_map) {
+    ADT::concurrent_unordered_map<std::uint64_t, std::uint64_t, ADT::hasher<std::uint64_t>, 8> m;
+    std::unordered_map<std::uint64_t, std::uint64_t> expected;
+    auto g = UNIT::rng(30);
+    for (size_t i = 0; i < 100000; ++i) {
+        std::uint64_t key = g() % 5000, val = g();
+        switch (g() % 4) {
+            case 0:
+                CHECK(m.insert_or_assign(key, val) == expected.insert_or_assign(key, val).second);
+                break;
+            case 1:
+                CHECK(m.erase(key) == expected.erase(key));
+                break;
+            case 2:
+                CHECK(m.compute_if_absent(key, [val] { return val; }) == expected.try_emplace(key, val).first -> second);
+                break;
+            case 3: {
+                auto v = m.find(key);
+                auto e = expected.find(key);
+                CHECK(v.has_value() == (e != expected.end()));
+                CHECK(m.contains(key) == v.has_value());
+                if (v)
+                    CHECK(*v == e -> second);
+                break;
+            }
+        }
+    }
+    CHECK(m.size() == expected.size());
+    size_t n = 0;
+    m.for_each([&](std::uint64_t k, std::uint64_t v) {
+        ++n;
+        CHECK(expected.at(k) == v);
+    });
+    CHECK(n == expected.size());
+}
+
+TEST(hash_maps, concurrent_unordered_map_threads) {
+    // Four threads over the same keys: every key ends up with the value of
+    // the one compute_if_absent that ran, and each assigns a quarter of
+    // another range.
+    ADT::concurrent_unordered_map<std::uint64_t, std::uint64_t> m;
+    std::atomic<size_t> calls{0}, wrong{0};
+    std::vector<std::thread> threads;
+    for (std::uint64_t t = 0; t < 4; ++t)
+        threads.emplace_back([&m, &calls, &wrong, t] {
+            for (std::uint64_t k = 0; k < 20000; ++k) {
+                if (m.compute_if_absent(k, [&calls, k] { ++calls; return k * 3; }) != k * 3)
+                    ++wrong;
+                if (k % 4 == t)
+                    m.insert_or_assign(k + 100000, t);
+            }
+        });
+    for (auto& th : threads)
+        th.join();
+    CHECK(wrong == 0);
+    CHECK(calls == 20000);
+    CHECK(m.size() == 40000);
+    for (std::uint64_t k = 0; k < 20000; ++k) {
+        CHECK(m.find(k) == k * 3);
+        CHECK(m.find(k + 100000) == k % 4);
+    }
+}
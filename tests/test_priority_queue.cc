@@ -0,0 +1,161 @@
+/*
+** PriorityQueue against std::priority_queue, and IndexedPriorityQueue
+** against a std::multiset of its values.
+*/
+
+#include "test.hh"
+#include "priority_queue.hh"
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <queue>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+
+    template <typename PQ, typename Std, typename Make>
+    void check_random_ops(PQ& q, Std& expected, size_t ops, Make make, std::uint64_t salt) {
+        auto g = UNIT::rng(salt);
+        for (size_t i = 0; i < ops; ++i) {
+            // Slightly more pushes than pops, so the heap grows and drains.
+            if (expected.empty() || g() % 16 < (i < ops / 2 ? 9u : 6u)) {
+                auto x = make(g);
+                q.push(x);
+                expected.push(x);
+            }
+            else {
+                CHECK(q.top() == expected.top());
+                CHECK(q.pop() == expected.top());
+                expected.pop();
+            }
+            CHECK(q.size() == expected.size());
+        }
+        while (!expected.empty()) {
+            CHECK(q.pop() == expected.top());
+            expected.pop();
+        }
+        CHECK(q.empty());
+        CHECK_THROWS(std::exception, q.pop());
+    }
+
+}
+
+
+TEST(priority_queue, max_queue) {
+    ADT::PriorityQueue<int> q;
+    std::priority_queue<int> expected;
+    check_random_ops(q, expected, 200000, [](auto& g) { return UNIT::uniform(g, -1000, 1000); }, 50);
+}
+
+TEST(priority_queue, min_queue) {
+    ADT::PriorityQueue<std::uint64_t, std::greater<std::uint64_t>> q;
+    std::priority_queue<std::uint64_t, std::vector<std::uint64_t>, std::greater<std::uint64_t>> expected;
+    check_random_ops(q, expected, 200000, [](auto& g) { return g(); }, 51);
+}
+
+TEST(priority_queue, arity) {
+    ADT::PriorityQueue<std::string, std::less<std::string>, 2> binary;
+    std::priority_queue<std::string> e2;
+    check_random_ops(binary, e2, 50000, [](auto& g) { return std::to_string(g() % 5000); }, 52);
+    ADT::PriorityQueue<int, std::less<int>, 8> octal;
+    std::priority_queue<int> e8;
+    check_random_ops(octal, e8, 50000, [](auto& g) { return UNIT::uniform(g, 0, 100); }, 53);
+}
+
+TEST(priority_queue, bulk_build) {
+    auto g = UNIT::rng(54);
+    std::vector<int> v(10000);
+    for (auto& x : v)
+        x = UNIT::uniform(g, 0, 1000000);
+    ADT::PriorityQueue<int> q(v.begin(), v.end());
+    std::priority_queue<int> expected(v.begin(), v.end());
+    while (!expected.empty()) {
+        CHECK(q.pop() == expected.top());
+        expected.pop();
+    }
+    CHECK(q.empty());
+}
+
+TEST(priority_queue, move_only) {
+    // A 3-ary min-queue of unique_ptr, built in bulk.
+    auto greater_ptr = [](const std::unique_ptr<int>& a, const std::unique_ptr<int>& b) { return *a > *b; };
+    std::vector<std::unique_ptr<int>> v;
+    for (int i = 0; i < 1000; ++i)
+        v.push_back(std::make_unique<int>((i * 7919) % 1000));
+    ADT::PriorityQueue<std::unique_ptr<int>, decltype(greater_ptr), 3> q(std::make_move_iterator(v.begin()),
+                                                                      std::make_move_iterator(v.end()), greater_ptr);
+    q.push(std::make_unique<int>(-1));
+    CHECK(*q.pop() == -1);
+    for (int i = 0; i < 1000; ++i)
+        CHECK(*q.pop() == i);
+    CHECK(q.empty());
+}
+
+TEST(priority_queue, indexed) {
+    ADT::IndexedPriorityQueue<int> q;
+    std::multiset<int> expected;
+    std::unordered_map<size_t, int> live;  // handle -> value
+    std::vector<size_t> handles;
+    auto g = UNIT::rng(55);
+    for (size_t i = 0; i < 200000; ++i) {
+        int x = UNIT::uniform(g, 0, 100000);
+        switch (expected.empty() ? 0 : g() % 6) {
+            case 0:
+            case 1: {
+                size_t h = q.push(x);
+                CHECK(!live.count(h));
+                live[h] = x;
+                handles.push_back(h);
+                expected.insert(x);
+                break;
+            }
+            case 2: {
+                int top = q.top();
+                CHECK(top == *expected.rbegin());
+                CHECK(live.at(q.top_handle()) == top);
+                live.erase(q.top_handle());
+                CHECK(q.pop() == top);
+                expected.erase(std::prev(expected.end()));
+                break;
+            }
+            case 3:
+            case 4:
+            case 5: {
+                size_t h = handles[g() % handles.size()];
+                auto it = live.find(h);
+                CHECK(q.contains(h) == (it != live.end()));
+                if (it == live.end())
+                    break;
+                CHECK(q[h] == it -> second);
+                expected.erase(expected.find(it -> second));
+                if (i % 3 == 0) {
+                    CHECK(q.erase(h) == it -> second);
+                    live.erase(it);
+                    break;
+                }
+                if (i % 3 == 1) {
+                    x = it -> second + UNIT::uniform(g, 0, 1000);  // only moves up
+                    q.decrease_key(h, x);
+                }
+                else
+                    q.update(h, x);
+                it -> second = x;
+                expected.insert(x);
+                break;
+            }
+        }
+        CHECK(q.size() == expected.size());
+        if (!expected.empty())
+            CHECK(q.top() == *expected.rbegin());
+    }
+    while (!expected.empty()) {
+        CHECK(q.pop() == *expected.rbegin());
+        expected.erase(std::prev(expected.end()));
+    }
+    CHECK(q.empty());
+}
@@ -0,0 +1,151 @@
+/*
+** Round trips through snapshot.hh: maps against std::unordered_map, sorted
+** arrays against std::set.
+*/
+
+#include "test.hh"
+#include "snapshot.hh"
+#include "unordered_map.hh"
+#include "flat_hash_map.hh"
+#include "trees.hh"
+#include <cstdint>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+
+    struct scratch_file {
+        std::string path;
+        explicit scratch_file(const std::string& name) : path{UNIT::temp_path(name)} {}
+        ~scratch_file() { std::remove(path.c_str()); }
+    };
+
+    struct point {
+        double x, y;
+        bool operator==(const point& p) const { return x == p.x && y == p.y; }
+    };
+
+    // The view of the snapshot of m holds exactly the elements of expected.
+    template <typename K, typename V, typename Std, typename Missing>
+    void check_map_view(const std::string& path, const Std& expected, Missing missing) {
+        for (bool prefault : {false, true}) {
+            ADT::mapped_unordered_map<K, V> view(path, prefault);
+            CHECK(view.size() == expected.size());
+            for (const auto& kv : expected) {
+                const V* v = view.find(kv.first);
+                CHECK(v && *v == kv.second);
+                CHECK(view.at(kv.first) == kv.second);
+            }
+            for (const auto& k : missing)
+                CHECK(!view.contains(k));
+            size_t n = 0;
+            view.for_each([&n](std::string_view, const V&) { ++n; });
+            CHECK(n == expected.size());
+        }
+    }
+
+}
+
+
+TEST(snapshot, string_map) {
+    ADT::unordered_map<std::string, point> m;
+    std::unordered_map<std::string, point> expected;
+    auto g = UNIT::rng(60);
+    for (int i = 0; i < 20000; ++i) {
+        std::string k = "k" + std::to_string(g() % 50000);
+        point p{double(i), double(g() % 1000)};
+        m[k] = p;
+        expected[k] = p;
+    }
+    std::vector<std::string> missing = {"", "missing", "k-1", std::string(1000, 'k')};
+    scratch_file f("string_map");
+    const auto& cm = m;
+    ADT::write_map_snapshot(cm, f.path);
+    check_map_view<std::string, point>(f.path, expected, missing);
+}
+
+TEST(snapshot, integer_map) {
+    ADT::flat_hash_map<std::uint64_t, std::uint32_t> m;
+    std::unordered_map<std::uint64_t, std::uint32_t> expected;
+    auto g = UNIT::rng(61);
+    for (int i = 0; i < 20000; ++i) {
+        std::uint64_t k = g() % 1000000;
+        m[k] = std::uint32_t(i);
+        expected[k] = std::uint32_t(i);
+    }
+    std::vector<std::uint64_t> missing = {1000000, 1000001, ~std::uint64_t(0)};
+    scratch_file f("integer_map");
+    ADT::write_map_snapshot(m, f.path);
+    check_map_view<std::uint64_t, std::uint32_t>(f.path, expected, missing);
+}
+
+TEST(snapshot, empty_map) {
+    ADT::unordered_map<std::string, int> m;
+    scratch_file f("empty_map");
+    ADT::write_map_snapshot(m, f.path);
+    ADT::mapped_unordered_map<std::string, int> view(f.path);
+    CHECK(view.empty() && !view.contains("x"));
+}
+
+TEST(snapshot, sorted_array) {
+    AVLTree<std::int64_t> t;
+    std::set<std::int64_t> expected;
+    auto g = UNIT::rng(62);
+    for (int i = 0; i < 20000; ++i) {
+        std::int64_t x = UNIT::uniform<std::int64_t>(g, -1000000, 1000000);
+        if (expected.insert(x).second)
+            t.insert(x);
+    }
+    scratch_file f("sorted_array");
+    ADT::write_sorted_snapshot(t, f.path);
+    ADT::mapped_sorted_array<std::int64_t> view(f.path);
+    CHECK(view.size() == expected.size());
+    CHECK(std::equal(view.begin(), view.end(), expected.begin(), expected.end()));
+    for (int i = 0; i < 20000; ++i) {
+        std::int64_t x = UNIT::uniform<std::int64_t>(g, -1000001, 1000001);
+        CHECK(view.contains(x) == bool(expected.count(x)));
+        auto lb = view.lower_bound(x);
+        auto elb = expected.lower_bound(x);
+        CHECK((lb == view.end()) == (elb == expected.end()));
+        if (elb != expected.end())
+            CHECK(*lb == *elb);
+    }
+}
+
+TEST(snapshot, sorted_array_unsorted_input) {
+    std::vector<int> v = {1, 3, 2};
+    scratch_file f("unsorted");
+    CHECK_THROWS(std::exception, ADT::write_sorted_snapshot(v, f.path));
+    // Neither the file nor its temporary is left behind.
+    CHECK(std::fopen(f.path.c_str(), "r") == nullptr);
+    CHECK(std::fopen((f.path + ".tmp").c_str(), "r") == nullptr);
+    std::vector<int> empty;
+    ADT::write_sorted_snapshot(empty, f.path);
+    ADT::mapped_sorted_array<int> view(f.path);
+    CHECK(view.empty() && view.begin() == view.end());
+}
+
+TEST(snapshot, bad_files) {
+    using int_view = ADT::mapped_unordered_map<std::string, int>;
+    using wide_view = ADT::mapped_unordered_map<std::string, std::uint64_t>;
+    scratch_file f("bad_files");
+    CHECK_THROWS(std::exception, int_view(f.path));
+    {
+        std::FILE* out = std::fopen(f.path.c_str(), "w");
+        std::fputs("not a snapshot at all, but long enough to hold a header", out);
+        std::fclose(out);
+    }
+    CHECK_THROWS(std::runtime_error, ADT::mapped_sorted_array<int>(f.path));
+    // A map snapshot is of the wrong type for a sorted array, and of the
+    // wrong value size for another map.
+    ADT::unordered_map<std::string, int> m;
+    m["x"] = 1;
+    ADT::write_map_snapshot(m, f.path);
+    CHECK(int_view(f.path).at("x") == 1);
+    CHECK_THROWS(std::runtime_error, ADT::mapped_sorted_array<int>(f.path));
+    CHECK_THROWS(std::runtime_error, wide_view(f.path));
+}
@@ -0,0 +1,180 @@
+/*
+** The sorts of sorting.hh, radix_sort.hh, parallel_sort.hh and
+** sort_network.hh against std::sort and std::stable_sort.
+*/
+
+#include "test.hh"
+#include "sorting.hh"
+#include "radix_sort.hh"
+#include "parallel_sort.hh"
+#include "sort_network.hh"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+    const size_t SIZES[] = {0, 1, 2, 3, 7, 16, 17, 31, 32, 33, 64, 100, 1000, 4096, 30000};
+
+    enum class shape { uniform, sorted, reversed, few_unique, organ_pipe };
+    const shape SHAPES[] = {shape::uniform, shape::sorted, shape::reversed, shape::few_unique, shape::organ_pipe};
+
+    template <typename T>
+    T from_int(std::int64_t x) {
+        if constexpr (std::is_same<T, std::string>::value)
+            return std::to_string(x);
+        else
+            return T(x);
+    }
+
+    template <typename T, typename Rng>
+    std::vector<T> make_input(size_t n, shape s, Rng& g) {
+        std::vector<T> v(n);
+        for (auto& x : v)
+            x = from_int<T>(s == shape::few_unique ? UNIT::uniform<std::int64_t>(g, -2, 2)
+                                                   : UNIT::uniform<std::int64_t>(g, -1000000000, 1000000000));
+        if (s == shape::sorted || s == shape::organ_pipe)
+            std::sort(v.begin(), v.end());
+        else if (s == shape::reversed)
+            std::sort(v.begin(), v.end(), std::greater<>());
+        if (s == shape::organ_pipe)
+            std::reverse(v.begin() + n / 2, v.end());
+        return v;
+    }
+
+    // Run sort on a copy of every input of every shape and size, and compare
+    // it to std::sort.
+    template <typename T, typename Sort>
+    void check_sort(Sort sort, size_t max_n = SIZE_MAX) {
+        auto g = UNIT::rng();
+        for (size_t n : SIZES) {
+            if (n > max_n)
+                continue;
+            for (shape s : SHAPES) {
+                std::vector<T> v = make_input<T>(n, s, g), expected = v;
+                std::sort(expected.begin(), expected.end());
+                sort(v);
+                CHECK(v == expected);
+            }
+        }
+    }
+
+    // Same, for a stable sort of (key, position) pairs by key.
+    template <typename Sort>
+    void check_stable_sort(Sort sort, size_t max_n = SIZE_MAX) {
+        auto g = UNIT::rng(1);
+        for (size_t n : SIZES) {
+            if (n > max_n)
+                continue;
+            for (shape s : SHAPES) {
+                std::vector<int> keys = make_input<int>(n, s, g);
+                std::vector<std::pair<int, size_t>> v;
+                for (size_t i = 0; i < n; ++i)
+                    v.emplace_back(keys[i] % 16, i);
+                auto expected = v;
+                std::stable_sort(expected.begin(), expected.end(),
+                                 [](const auto& a, const auto& b) { return a.first < b.first; });
+                sort(v);
+                CHECK(v == expected);
+            }
+        }
+    }
+
+}
+
+
+TEST(sorting, sort) {
+    check_sort<int>([](auto& v) { SORT::sort(v.begin(), v.end()); });
+    check_sort<std::int64_t>([](auto& v) { SORT::sort(v.begin(), v.end()); });
+    check_sort<double>([](auto& v) { SORT::sort(v.begin(), v.end()); });
+    check_sort<std::string>([](auto& v) { SORT::sort(v.begin(), v.end()); }, 4096);
+}
+
+TEST(sorting, sort_comp_proj) {
+    auto g = UNIT::rng(2);
+    for (size_t n : SIZES) {
+        std::vector<std::pair<int, int>> v;
+        for (size_t i = 0; i < n; ++i)
+            v.emplace_back(UNIT::uniform(g, -100, 100), int(i));
+        auto expected = v;
+        std::sort(expected.begin(), expected.end(),
+                  [](const auto& a, const auto& b) { return a.first > b.first; });
+        SORT::sort(v.begin(), v.end(), std::greater<>(), [](const auto& p) { return p.first; });
+        CHECK(std::equal(v.begin(), v.end(), expected.begin(),
+                         [](const auto& a, const auto& b) { return a.first == b.first; }));
+    }
+}
+
+TEST(sorting, heap_sort) {
+    check_sort<int>([](auto& v) { SORT::heap_sort(v.begin(), v.end()); });
+    check_sort<std::string>([](auto& v) { SORT::heap_sort(v.begin(), v.end()); }, 4096);
+}
+
+TEST(sorting, insertion_sort) {
+    check_sort<int>([](auto& v) { SORT::insertion_sort(v.begin(), v.end()); }, 4096);
+}
+
+TEST(sorting, merge_sort) {
+    check_sort<int>([](auto& v) { SORT::merge_sort(v.begin(), v.end()); });
+    check_stable_sort([](auto& v) { SORT::merge_sort(v.begin(), v.end(), std::less<>(), &std::pair<int, size_t>::first); });
+    check_stable_sort([](auto& v) { SORT::stable_sort(v.begin(), v.end(), std::less<>(), &std::pair<int, size_t>::first); });
+    std::vector<std::pair<int, size_t>> scratch;
+    check_stable_sort([&scratch](auto& v) {
+        SORT::merge_sort_buffered(v.begin(), v.end(), scratch, std::less<>(), &std::pair<int, size_t>::first);
+    });
+}
+
+TEST(sorting, radix_sort) {
+    check_sort<std::int32_t>([](auto& v) { SORT::radix_sort(v.begin(), v.end()); });
+    check_sort<std::uint32_t>([](auto& v) { SORT::radix_sort(v.begin(), v.end()); });
+    check_sort<std::int64_t>([](auto& v) { SORT::radix_sort(v.begin(), v.end()); });
+    check_sort<double>([](auto& v) { SORT::radix_sort(v.begin(), v.end()); });
+    check_sort<float>([](auto& v) { SORT::radix_sort(v.begin(), v.end()); });
+    check_stable_sort([](auto& v) { SORT::radix_sort(v.begin(), v.end(), &std::pair<int, size_t>::first); });
+}
+
+TEST(sorting, parallel_sort) {
+    ADT::thread_pool pool(4);
+    check_sort<int>([&pool](auto& v) { SORT::parallel_sort(v.begin(), v.end(), pool); });
+    // A small grain, so that even the small inputs are split.
+    check_sort<int>([&pool](auto& v) { SORT::parallel_sort(v.begin(), v.end(), pool, std::less<>(), SORT::identity(), 16); });
+    check_stable_sort([&pool](auto& v) {
+        SORT::parallel_merge_sort(v.begin(), v.end(), pool, std::less<>(), &std::pair<int, size_t>::first, 16);
+    });
+    // Grains of 1 and 2 split the merges down to single elements.
+    for (ptrdiff_t grain : {1, 2}) {
+        check_sort<int>([&pool, grain](auto& v) {
+            SORT::parallel_sort(v.begin(), v.end(), pool, std::less<>(), SORT::identity(), grain);
+        }, 4096);
+        check_stable_sort([&pool, grain](auto& v) {
+            SORT::parallel_merge_sort(v.begin(), v.end(), pool, std::less<>(), &std::pair<int, size_t>::first, grain);
+        }, 4096);
+    }
+}
+
+TEST(sorting, sort_network) {
+    if constexpr (SORT::network::max_size<int> > 0) {
+        auto g = UNIT::rng(3);
+        for (int round = 0; round < 2000; ++round) {
+            size_t n = UNIT::uniform<size_t>(g, 0, SORT::network::max_size<int>);
+            std::vector<int> v = make_input<int>(n, SHAPES[round % 5], g), expected = v;
+            std::sort(expected.begin(), expected.end());
+            SORT::network::sort_small(v.data(), n);
+            CHECK(v == expected);
+        }
+    }
+    if constexpr (SORT::network::max_size<double> > 0) {
+        auto g = UNIT::rng(4);
+        for (int round = 0; round < 2000; ++round) {
+            size_t n = UNIT::uniform<size_t>(g, 0, SORT::network::max_size<double>);
+            std::vector<double> v = make_input<double>(n, SHAPES[round % 5], g), expected = v;
+            std::sort(expected.begin(), expected.end());
+            SORT::network::sort_small(v.data(), n);
+            CHECK(v == expected);
+        }
+    }
+}
@@ -0,0 +1,215 @@
+/*
+** BinarySearchTree and AVLTree of trees.hh against std::set, and the btree
+** of btree.hh against std::map and std::set.
+*/
+
+#include "test.hh"
+#include "trees.hh"
+#include "btree.hh"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+    template <typename Tree>
+    void check_same(const Tree& t, const std::set<int>& expected) {
+        CHECK(t.size() == expected.size());
+        CHECK(std::equal(t.begin(), t.end(), expected.begin(), expected.end()));
+        // Backwards from end().
+        CHECK(std::equal(std::make_reverse_iterator(t.end()), std::make_reverse_iterator(t.begin()),
+                         expected.rbegin(), expected.rend()));
+    }
+
+    // Random inserts, removes and searches on t and on a std::set.
+    template <typename Tree>
+    void check_random_ops(Tree& t, size_t ops, int key_range, std::uint64_t salt) {
+        std::set<int> expected;
+        auto g = UNIT::rng(salt);
+        for (size_t i = 0; i < ops; ++i) {
+            int key = UNIT::uniform(g, 0, key_range - 1);
+            bool present = expected.count(key);
+            CHECK(t.search(key) == present);
+            switch (g() % 3) {
+                case 0:
+                    if (!present) {
+                        t.insert(key);
+                        expected.insert(key);
+                    }
+                    break;
+                case 1:
+                    if (present) {
+                        t.remove(key);
+                        expected.erase(key);
+                    }
+                    else
+                        CHECK_THROWS(std::exception, t.remove(key));
+                    break;
+                case 2:
+                    if (!expected.empty()) {
+                        auto it = expected.lower_bound(key);
+                        CHECK(t.rank(key) == size_t(std::distance(expected.begin(), it)));
+                        if (it != expected.end())
+                            CHECK(t.select(t.rank(key)) == *it);
+                    }
+                    break;
+            }
+            if (i % 1000 == 0)
+                check_same(t, expected);
+        }
+        check_same(t, expected);
+    }
+
+}
+
+
+TEST(trees, binary_search_tree) {
+    BinarySearchTree<int> t;
+    check_random_ops(t, 20000, 2000, 40);
+}
+
+TEST(trees, avl_tree) {
+    AVLTree<int> t;
+    check_random_ops(t, 50000, 5000, 41);
+    // Sorted inserts keep an AVL tree logarithmic.
+    AVLTree<int> sorted;
+    for (int i = 0; i < 1 << 14; ++i)
+        sorted.insert(i);
+    CHECK(sorted.height() <= 20);
+}
+
+TEST(trees, traversals) {
+    // The iterative orders visit the keys as the recursive ones do.
+    BinarySearchTree<int> t;
+    auto g = UNIT::rng(45);
+    for (int i = 0; i < 2000; ++i) {
+        int x = UNIT::uniform(g, 0, 100000);
+        if (!t.search(x))
+            t.insert(x);
+    }
+    auto keys = [](auto traverse) {
+        std::vector<int> v;
+        traverse([&v](const int& x) { v.push_back(x); });
+        return v;
+    };
+    auto pre = keys([&t](auto f) { t.pre_order_traversal(f); });
+    auto in = keys([&t](auto f) { t.in_order_traversal(f); });
+    auto post = keys([&t](auto f) { t.post_order_traversal(f); });
+    CHECK(pre.size() == t.size() && std::is_sorted(in.begin(), in.end()));
+    CHECK(keys([&t](auto f) { t.pre_order_iter_traversal(f); }) == pre);
+    CHECK(keys([&t](auto f) { t.in_order_iter_traversal(f); }) == in);
+    CHECK(keys([&t](auto f) { t.post_order_iter_traversal_twostacks(f); }) == post);
+    CHECK(keys([&t](auto f) { t.post_order_iter_traversal_onestack(f); }) == post);
+}
+
+TEST(trees, bulk_operations) {
+    auto g = UNIT::rng(42);
+    std::set<int> expected;
+    std::vector<int> a, b;
+    for (int i = 0; i < 3000; ++i) {
+        int x = UNIT::uniform(g, 0, 100000);
+        if (expected.insert(x).second)
+            (i % 2 ? a : b).push_back(x);
+    }
+    AVLTree<int> t(a), u;
+    u.bulk_load(b);
+    t.merge(u);
+    CHECK(u.size() == 0);
+    check_same(t, expected);
+    BinarySearchTree<int> s;
+    s.insert_range(a);
+    s.insert_range(b);
+    check_same(s, expected);
+}
+
+TEST(trees, clear) {
+    // A degenerate tree, cleared without recursing down its spine.
+    BinarySearchTree<int> chain;
+    for (int i = 0; i < 5000; ++i)
+        chain.insert(i);
+    CHECK(chain.height() == 4999);
+    chain.clear();
+    CHECK(chain.empty() && chain.size() == 0 && chain.begin() == chain.end());
+    chain.insert(7);
+    CHECK(chain.size() == 1 && chain.root() == 7);
+    // Over an arena the nodes are dropped in one step, and the tree is
+    // reusable before the arena is released.
+    ADT::monotonic_arena arena;
+    AVLTree<int, ADT::arena_allocator<int>> t {ADT::arena_allocator<int>(arena)};
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 5000; ++i)
+            t.insert(i);
+        CHECK(t.size() == 5000 && t.height() <= 16);
+        t.clear();
+        CHECK(t.empty() && t.begin() == t.end());
+    }
+    arena.release();
+}
+
+TEST(trees, btree_map) {
+    ADT::btree_map<int, std::uint64_t> t;
+    std::map<int, std::uint64_t> expected;
+    auto g = UNIT::rng(43);
+    for (size_t i = 0; i < 200000; ++i) {
+        int key = UNIT::uniform(g, 0, 20000);
+        std::uint64_t val = g();
+        switch (g() % 5) {
+            case 0:
+                CHECK(t.insert(key, val).second == expected.emplace(key, val).second);
+                break;
+            case 1:
+                CHECK(t.insert_or_assign(key, val) == expected.insert_or_assign(key, val).second);
+                break;
+            case 2:
+                CHECK(t.erase(key) == expected.erase(key));
+                break;
+            case 3: {
+                auto it = t.find(key);
+                auto e = expected.find(key);
+                CHECK((it == t.end()) == (e == expected.end()));
+                if (e != expected.end())
+                    CHECK(it.key() == key && it.value() == e -> second);
+                break;
+            }
+            case 4: {
+                auto lo = t.lower_bound(key), hi = t.upper_bound(key);
+                auto elo = expected.lower_bound(key), ehi = expected.upper_bound(key);
+                CHECK((lo == t.end()) == (elo == expected.end()));
+                CHECK((hi == t.end()) == (ehi == expected.end()));
+                if (elo != expected.end())
+                    CHECK(lo.key() == elo -> first);
+                if (ehi != expected.end())
+                    CHECK(hi.key() == ehi -> first);
+                break;
+            }
+        }
+    }
+    CHECK(t.size() == expected.size());
+    auto e = expected.begin();
+    for (auto it = t.begin(); it != t.end(); ++it, ++e)
+        CHECK(it.key() == e -> first && it.value() == e -> second);
+    CHECK(e == expected.end());
+}
+
+TEST(trees, btree_set) {
+    ADT::btree_set<std::string> t;
+    std::set<std::string> expected;
+    auto g = UNIT::rng(44);
+    for (size_t i = 0; i < 50000; ++i) {
+        std::string key = std::to_string(UNIT::uniform(g, 0, 5000));
+        if (g() % 3)
+            CHECK(t.insert(key).second == expected.insert(key).second);
+        else
+            CHECK(t.erase(key) == expected.erase(key));
+    }
+    CHECK(t.size() == expected.size());
+    auto e = expected.begin();
+    for (auto it = t.begin(); it != t.end(); ++it, ++e)
+        CHECK(it.key() == *e);
+    CHECK(e == expected.end());
+}
@@ -0,0 +1,228 @@
+/*
+** Work-stealing thread pool for fork-join parallelism.
+**
+** Every worker owns a Deque of tasks. A worker pushes the tasks it forks to
+** the back of its own deque and pops from the back, so it keeps working on
+** the data it just touched. An idle worker steals from the front of another
+** worker's deque, which takes the oldest and usually largest piece of work.
+** Tasks submitted from outside the pool are dealt round-robin.
+**
+** Fork-join goes through a task_group:
+**     ADT::thread_pool pool;                   // one worker per hardware thread
+**     ADT::task_group g(pool);
+**     g.run([&] { left(); });
+**     right();
+**     g.wait();                                // runs other tasks while waiting
+** wait() keeps executing pending tasks instead of blocking, so tasks can fork
+** and wait on nested groups without running out of threads.
+*/
+
+
+#ifndef __THREAD_POOL_H_
+#define __THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "queue.hh"
+#include "concurrent_queue.hh"  // CACHE_LINE_SIZE
+
+
+namespace ADT {
+
+class thread_pool {
+    /*
+    ** Each deque has its own mutex, held only to push or pop one task, so
+    ** workers contend only when one steals from another. Idle workers sleep on
+    ** a condition variable and are woken when a task is queued.
+    ** The destructor runs every task still queued, then joins the workers.
+    */
+    public:
+        using task = std::function<void()>;
+
+        explicit thread_pool(size_t threads = default_threads())
+            : m_workers(threads ? threads : 1) {
+            m_threads.reserve(m_workers.size());
+            for (size_t i = 0; i < m_workers.size(); ++i)
+                m_threads.emplace_back([this, i] { work(i); });
+        }
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+        ~thread_pool() {
+            {
+                std::lock_guard<std::mutex> lock(m_sleep_mtx);
+                m_stop = true;
+            }
+            m_wake.notify_all();
+            for (auto& t : m_threads)
+                t.join();
+        }
+
+        static size_t default_threads() {
+            size_t n = std::thread::hardware_concurrency();
+            return n ? n : 1;
+        }
+
+        size_t size() const { return m_workers.size(); }
+
+        // Queue f to run on some worker. f must not throw; use a task_group to
+        // get exceptions back.
+        template <typename F>
+        void submit(F&& f) {
+            size_t i = current_worker();
+            if (i == NOT_A_WORKER)
+                i = m_next.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+            {
+                std::lock_guard<std::mutex> lock(m_workers[i].mtx);
+                m_workers[i].tasks.insert_back(task(std::forward<F>(f)));
+            }
+            m_queued.fetch_add(1);
+            if (m_sleeping.load() > 0) {
+                // Taking the lock orders this notify after a sleeper's check.
+                { std::lock_guard<std::mutex> lock(m_sleep_mtx); }
+                m_wake.notify_one();
+            }
+        }
+
+        // Run one queued task on the calling thread. Returns false if there
+        // was none.
+        bool run_one() {
+            task t;
+            size_t self = current_worker();
+            if (!take(self == NOT_A_WORKER ? 0 : self, t))
+                return false;
+            t();
+            return true;
+        }
+
+    private:
+        static constexpr size_t NOT_A_WORKER = size_t(-1);
+
+        struct alignas(CACHE_LINE_SIZE) Worker {
+            std::mutex mtx;
+            Deque<task> tasks;
+        };
+
+        // Index of the calling thread in this pool, or NOT_A_WORKER.
+        size_t current_worker() const {
+            return tl_pool == this ? tl_index : NOT_A_WORKER;
+        }
+
+        // Pop from the back of deque self, else steal from the front of the
+        // others, starting after self.
+        bool take(size_t self, task& out) {
+            size_t n = m_workers.size();
+            for (size_t k = 0; k < n; ++k) {
+                size_t i = (self + k) % n;
+                Worker& w = m_workers[i];
+                std::lock_guard<std::mutex> lock(w.mtx);
+                if (w.tasks.empty())
+                    continue;
+                if (k == 0 && current_worker() == self) {
+                    out = std::move(w.tasks[w.tasks.size() - 1]);
+                    w.tasks.remove_back();
+                }
+                else {
+                    out = std::move(w.tasks[0]);
+                    w.tasks.remove_front();
+                }
+                m_queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+            return false;
+        }
+
+        void work(size_t self) {
+            tl_pool = this;
+            tl_index = self;
+            task t;
+            for (;;) {
+                if (take(self, t)) {
+                    t();
+                    t = nullptr;
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(m_sleep_mtx);
+                m_sleeping.fetch_add(1);
+                m_wake.wait(lock, [this] { return m_queued.load() > 0 || m_stop; });
+                m_sleeping.fetch_sub(1);
+                if (m_stop && m_queued.load() == 0)
+                    return;
+            }
+        }
+
+        std::vector<Worker> m_workers;
+        std::vector<std::thread> m_threads;
+        std::atomic<size_t> m_next{0};      // round-robin slot for outside submits
+        std::atomic<size_t> m_queued{0};    // tasks in all deques
+        std::atomic<size_t> m_sleeping{0};  // workers waiting on m_wake
+        std::mutex m_sleep_mtx;
+        std::condition_variable m_wake;
+        bool m_stop = false;                // guarded by m_sleep_mtx
+
+        static inline thread_local const thread_pool* tl_pool = nullptr;
+        static inline thread_local size_t tl_index = 0;
+};
+
+
+class task_group {
+    /*
+    ** Tasks forked with run() and joined with wait(). The first exception a
+    ** task throws is rethrown by wait(); the other tasks still run to the end.
+    ** The destructor waits too, so tasks never outlive the data they capture.
+    */
+    public:
+        explicit task_group(thread_pool& pool) : m_pool{pool} {}
+        task_group(const task_group&) = delete;
+        task_group& operator=(const task_group&) = delete;
+        ~task_group() {
+            while (m_pending.load(std::memory_order_acquire) > 0)
+                help();
+        }
+
+        template <typename F>
+        void run(F&& f) {
+            m_pending.fetch_add(1, std::memory_order_relaxed);
+            m_pool.submit([this, f = std::forward<F>(f)]() mutable {
+                try {
+                    f();
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(m_error_mtx);
+                    if (!m_error)
+                        m_error = std::current_exception();
+                }
+                m_pending.fetch_sub(1, std::memory_order_release);
+            });
+        }
+
+        // Run queued tasks until every task of this group is done.
+        void wait() {
+            while (m_pending.load(std::memory_order_acquire) > 0)
+                help();
+            if (m_error)
+                std::rethrow_exception(std::exchange(m_error, nullptr));
+        }
+
+    private:
+        void help() {
+            if (!m_pool.run_one())
+                std::this_thread::yield();
+        }
+
+        thread_pool& m_pool;
+        std::atomic<size_t> m_pending{0};
+        std::mutex m_error_mtx;
+        std::exception_ptr m_error;
+};
+
+}  // end of namespace ADT
+
+
+#endif // __THREAD_POOL_H_
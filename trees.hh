@@ -18,13 +18,17 @@ https://isocpp.org/wiki/faq/templates#nondependent-name-lookup-members
 
 
 #include <exception>
+#include <stdexcept>
+#include <string>
 #include <memory>
 #include <vector>
 #include <functional>
-#include <stack>
+#include <iterator>
 #include <queue>
 #include <algorithm>
 #include <optional>
+#include "stack.hh"
+#include "allocator.hh"
 
 using namespace std;
 
@@ -40,11 +44,13 @@ public:
 };
 
 
-template <typename T> class BinarySearchTree;
-template <typename T> class AVLTree;
+template <typename T, typename Alloc = allocator<T>> class BinarySearchTree;
+template <typename T, typename Alloc = allocator<T>> class AVLTree;
 
-template <typename T>
+template <typename T, typename Alloc = allocator<T>>
 class BinaryTree {
+// Nodes are allocated from Alloc, e.g. ADT::pool_allocator (allocator.hh),
+// together with their shared_ptr control blocks.
 
 // Nested Node class. Composition design to avoid template Node class
 protected:
@@ -70,22 +76,25 @@ protected:
         shared_ptr<Node> m_left {nullptr};  // in-class member initialization
         shared_ptr<Node> m_right {nullptr};
         weak_ptr<Node> m_parent {shared_ptr<Node>(nullptr)};
+        int m_height {0};  // of the subtree rooted here, a leaf is 0
+        size_t m_size {1};  // number of nodes in the subtree rooted here
         friend class BinaryTree;
-        friend class BinarySearchTree<T>;
-        friend class AVLTree<T>;
+        friend class BinarySearchTree<T, Alloc>;
+        friend class AVLTree<T, Alloc>;
     };
 
 // Constructors
 public:
     BinaryTree(): m_root{nullptr} {}
-    BinaryTree(const vector<optional<T>>& tree_vec) {
+    explicit BinaryTree(const Alloc& alloc): m_root{nullptr}, m_alloc{alloc} {}
+    BinaryTree(const vector<optional<T>>& tree_vec, const Alloc& alloc = Alloc()) : m_alloc{alloc} {
         // Build the binary tree from a BFS vector representation, where NIL node is nullopt.
         if (tree_vec.empty() || tree_vec[0] == nullopt) {
             m_root = nullptr;
             return;
         }
         else {
-            m_root = make_shared<Node>(tree_vec[0].value());
+            m_root = new_node(tree_vec[0].value());
         }
 
         queue<shared_ptr<Node>> child_queue;
@@ -100,7 +109,7 @@ public:
                     if (tree_vec[i] == nullopt) {
                         node -> m_left = nullptr;
                     } else {
-                        node -> m_left = make_shared<Node>(tree_vec[i].value());
+                        node -> m_left = new_node(tree_vec[i].value());
                         node -> m_left -> m_parent = node;
                     }
                 }
@@ -110,18 +119,22 @@ public:
                     if (tree_vec[i] == nullopt) {
                         node -> m_right = nullptr;
                     } else {
-                        node -> m_right = make_shared<Node>(tree_vec[i].value());
+                        node -> m_right = new_node(tree_vec[i].value());
                         node -> m_right -> m_parent = node;
                     }
                 }
                 child_queue.push(node -> m_right);
             }
         }
+        update_subtree(m_root);
     }
 
 // Member data
 protected:
     shared_ptr<Node> m_root;
+    Alloc m_alloc;
+
+    shared_ptr<Node> new_node(const T& x) const { return allocate_shared<Node>(m_alloc, x); }
 
 // properties: empty, root, size and height
 public:
@@ -129,68 +142,215 @@ public:
     const T& root() const { return m_root -> m_key; }
     auto size() const { return size(m_root); }
     auto height() const { return height(m_root); }
+
+    // Remove every node, without recursing, so a degenerate tree can't run out
+    // of stack. Like ADT::unordered_map::clear(), nodes of an arena with
+    // trivially destructible keys are dropped without a visit.
+    void clear();
 protected:
-    size_t size(const shared_ptr<Node> node) const {
+    // Every node caches the size and height of its subtree, so both are O(1).
+    // Code that relinks nodes calls update() bottom-up on the nodes it changed.
+    static size_t size(const shared_ptr<Node>& node) {
         // return size of a branch under node
-        if (!node)
-            return 0;
-        return size(node -> m_left) + size(node -> m_right) + 1;
+        return node ? node -> m_size : 0;
     }
 
-    int height(const shared_ptr<Node> node) const {
+    static int height(const shared_ptr<Node>& node) {
         // Return the height of the subtree rooted at node.
         // Define the height of a NIL node is -1 for easy rebalance.
         // Ref: https://ocw.mit.edu/courses/electrical-engineering-and-computer-science/6-006-introduction-to-algorithms-fall-2011/readings/binary-search-trees/avl.py  # noqa
-        if (!node)
-            return -1;
-        return max(height(node -> m_left), height(node -> m_right)) + 1;
+        return node ? node -> m_height : -1;
+    }
+
+    static void update(const shared_ptr<Node>& node) {
+        // Recompute the cached size and height of node from its children.
+        node -> m_size = size(node -> m_left) + size(node -> m_right) + 1;
+        node -> m_height = max(height(node -> m_left), height(node -> m_right)) + 1;
+    }
+
+    static void update_path(shared_ptr<Node> node) {
+        // Update node and all its ancestors.
+        for (; node; node = node -> m_parent.lock())
+            update(node);
+    }
+
+    static void update_subtree(const shared_ptr<Node>& node) {
+        if (!node) return;
+        update_subtree(node -> m_left);
+        update_subtree(node -> m_right);
+        update(node);
     }
 
 // tree traversal algos
 public:
     using Callback = function<void(const T&)>;  // function type passed in to process node data while traversing tree
+    // Traversals take any callable cb(const T&), inlined at the call site. If cb
+    // returns bool, returning false stops the traversal early; the traversal then
+    // returns false, and true if it visited every node.
     // Recursive tree traversals
-    void pre_order_traversal(Callback cb) const { pre_order(m_root, cb); }
-    void in_order_traversal(Callback cb) const { in_order(m_root, cb); }
-    void post_order_traversal(Callback cb) const { post_order(m_root, cb); }
+    template <typename F> bool pre_order_traversal(F cb) const { return pre_order(m_root.get(), cb); }
+    template <typename F> bool in_order_traversal(F cb) const { return in_order(m_root.get(), cb); }
+    template <typename F> bool post_order_traversal(F cb) const { return post_order(m_root.get(), cb); }
     // Iterative tree traversals
-    void pre_order_iter_traversal(Callback cb) const { pre_order_iter(m_root, cb); }
-    void in_order_iter_traversal(Callback cb) const { in_order_iter(m_root, cb); }
-    void post_order_iter_traversal_twostacks(Callback cb) const { post_order_iter_twostacks(m_root, cb); }
-    void post_order_iter_traversal_onestack(Callback cb) const { post_order_iter_onestack(m_root, cb); }
-    void breadth_first_traversal(Callback cb) const { bfs(m_root, cb); }
+    template <typename F> bool pre_order_iter_traversal(F cb) const { return pre_order_iter(m_root.get(), cb); }
+    template <typename F> bool in_order_iter_traversal(F cb) const { return in_order_iter(m_root.get(), cb); }
+    template <typename F> bool post_order_iter_traversal_twostacks(F cb) const { return post_order_iter_twostacks(m_root.get(), cb); }
+    template <typename F> bool post_order_iter_traversal_onestack(F cb) const { return post_order_iter_onestack(m_root.get(), cb); }
+    template <typename F> bool breadth_first_traversal(F cb) const { return bfs(m_root.get(), cb); }
 private:
-    void pre_order(const shared_ptr<Node>, Callback) const;
-    void in_order(const shared_ptr<Node>, Callback) const;
-    void post_order(const shared_ptr<Node>, Callback) const;
-    void pre_order_iter(const shared_ptr<Node>, Callback) const;
-    void in_order_iter(const shared_ptr<Node>, Callback) const;
-    void post_order_iter_twostacks(const shared_ptr<Node>, Callback) const;
-    void post_order_iter_onestack(const shared_ptr<Node>, Callback) const;
-    void bfs(const shared_ptr<Node>, Callback) const;
+    // Traversals walk raw pointers: the tree owns the nodes, and copying
+    // shared_ptrs would cost two atomic operations per step.
+    template <typename F>
+    static bool visit(F& cb, const T& key) {
+        if constexpr (is_same<decltype(cb(key)), bool>::value)
+            return cb(key);
+        else {
+            cb(key);
+            return true;
+        }
+    }
+    template <typename F> static bool pre_order(const Node*, F&);
+    template <typename F> static bool in_order(const Node*, F&);
+    template <typename F> static bool post_order(const Node*, F&);
+    template <typename F> bool pre_order_iter(const Node*, F&) const;
+    template <typename F> bool in_order_iter(const Node*, F&) const;
+    template <typename F> bool post_order_iter_twostacks(const Node*, F&) const;
+    template <typename F> bool post_order_iter_onestack(const Node*, F&) const;
+    template <typename F> bool bfs(const Node*, F&) const;
+
+// in-order iterator
+public:
+    class const_iterator {
+        /*
+        ** Bidirectional in-order iterator. Follows the parent links, like successor()
+        ** and predecessor() of BinarySearchTree: O(1) amortized per step.
+        ** Invalidated when its node is removed.
+         */
+    public:
+        using iterator_category = bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+        const_iterator(const BinaryTree* tree, const Node* node) : m_tree{tree}, m_node{node} {}
+
+        reference operator*() const { return m_node -> m_key; }
+        pointer operator->() const { return &(m_node -> m_key); }
+
+        const_iterator& operator++() {
+            if (m_node -> m_right) {
+                m_node = leftmost(m_node -> m_right.get());
+                return *this;
+            }
+            // Go up until we come from a left child.
+            const Node* par = m_node -> m_parent.lock().get();
+            while (par && m_node == par -> m_right.get()) {
+                m_node = par;
+                par = par -> m_parent.lock().get();
+            }
+            m_node = par;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator old(*this);
+            ++*this;
+            return old;
+        }
+        const_iterator& operator--() {
+            if (!m_node) {  // end
+                m_node = rightmost(m_tree -> m_root.get());
+                return *this;
+            }
+            if (m_node -> m_left) {
+                m_node = rightmost(m_node -> m_left.get());
+                return *this;
+            }
+            const Node* par = m_node -> m_parent.lock().get();
+            while (par && m_node == par -> m_left.get()) {
+                m_node = par;
+                par = par -> m_parent.lock().get();
+            }
+            m_node = par;
+            return *this;
+        }
+        const_iterator operator--(int) {
+            const_iterator old(*this);
+            --*this;
+            return old;
+        }
+
+        bool operator==(const const_iterator& it) const { return m_node == it.m_node; }
+        bool operator!=(const const_iterator& it) const { return m_node != it.m_node; }
+
+    private:
+        const BinaryTree* m_tree = nullptr;
+        const Node* m_node = nullptr;  // null at end
+    };
+    using iterator = const_iterator;  // keys can't be changed in place
+
+    const_iterator begin() const { return const_iterator(this, leftmost(m_root.get())); }
+    const_iterator end() const { return const_iterator(this, nullptr); }
+
+protected:
+    static const Node* leftmost(const Node* nd) {
+        while (nd && nd -> m_left)
+            nd = nd -> m_left.get();
+        return nd;
+    }
+    static const Node* rightmost(const Node* nd) {
+        while (nd && nd -> m_right)
+            nd = nd -> m_right.get();
+        return nd;
+    }
 };
 
 
-template <typename T>
-class BinarySearchTree : public BinaryTree<T> {
-    using Node = typename BinaryTree<T>::Node;
+template <typename T, typename Alloc>
+class BinarySearchTree : public BinaryTree<T, Alloc> {
+    using Node = typename BinaryTree<T, Alloc>::Node;
 public:
-    BinarySearchTree() : BinaryTree<T>() {}
-    BinarySearchTree(const vector<T>& tree_vec) : BinaryTree<T>() {
-        for (auto x : tree_vec) {
-            iter_insert(x);
-        }
+    BinarySearchTree() : BinaryTree<T, Alloc>() {}
+    explicit BinarySearchTree(const Alloc& alloc) : BinaryTree<T, Alloc>(alloc) {}
+    BinarySearchTree(const vector<T>& tree_vec, const Alloc& alloc = Alloc()) : BinaryTree<T, Alloc>(alloc) {
+        bulk_load(tree_vec);
     }
 
 public:
-    int find(const T& x) {
+    int find(const T& x) const {
         // Return index of x in BST if it exists, else -1.
-        find_target_key = x;
-        find_count = -1;
-        is_found = false;
-        this -> in_order_traversal(bind(in_order_find, placeholders::_1, this));
-        if (!is_found) find_count = -1;
-        return find_count;
+        return search(x) ? int(rank(x)) : -1;
+    }
+    size_t rank(const T& x) const {
+        // Number of keys less than x, i.e. in-order index of the first x. O(height).
+        size_t r = 0;
+        auto nd = this -> m_root;
+        while (nd) {
+            if (nd -> m_key < x) {
+                r += this -> size(nd -> m_left) + 1;
+                nd = nd -> m_right;
+            }
+            else
+                nd = nd -> m_left;
+        }
+        return r;
+    }
+    const T& select(size_t k) const {
+        // The key at in-order index k. O(height).
+        if (k >= this -> size()) throw ValueError("select() index out of range.");
+        auto nd = this -> m_root;
+        for (;;) {
+            size_t left = this -> size(nd -> m_left);
+            if (k < left)
+                nd = nd -> m_left;
+            else if (k == left)
+                return nd -> m_key;
+            else {
+                k -= left + 1;
+                nd = nd -> m_right;
+            }
+        }
     }
     bool search(const T& x) const {return search(this -> m_root, x) != nullptr;}
     const T& minimum() const {
@@ -227,17 +387,33 @@ public:
         remove(x_node);
     }
 
-protected:
-    T find_target_key; // target key for in_order_find()
-    int find_count;  // temp counter for in_order_find()
-    bool is_found;  // temp flag for in_order_find()
-    static void in_order_find(const T& e, void * this_pointer) {
-        auto self = static_cast<BinarySearchTree<T>*>(this_pointer);
-        if (self -> is_found) return;
-        ++ self -> find_count;
-        if (e == self -> find_target_key)
-            self -> is_found = true;
+    // Bulk operations. Each rebuilds a perfectly balanced tree, which is also a valid AVL tree.
+    void bulk_load(vector<T> keys) {
+        // Replace the tree with keys, in O(n) if they are sorted, else O(n log n).
+        if (!is_sorted(keys.begin(), keys.end()))
+            sort(keys.begin(), keys.end());
+        build(keys);
     }
+    void insert_range(vector<T> keys) {
+        // Insert all keys: sort them, merge with the in-order keys of the tree, rebuild.
+        if (!is_sorted(keys.begin(), keys.end()))
+            sort(keys.begin(), keys.end());
+        merge_sorted(keys);
+    }
+    void merge(BinarySearchTree& other) {
+        // Move all keys of other into this tree, in O(n + m). other is left empty.
+        if (&other == this) return;
+        merge_sorted(other.sorted_keys());
+        other.m_root = nullptr;
+    }
+    vector<T> sorted_keys() const {
+        vector<T> keys;
+        keys.reserve(this -> size());
+        this -> in_order_traversal([&keys](const T& x) { keys.push_back(x); });
+        return keys;
+    }
+
+protected:
     shared_ptr<Node> search(const shared_ptr<Node>, const T&) const;
     shared_ptr<Node> iter_search(const shared_ptr<Node>, const T&) const;
     shared_ptr<Node> minimum(const shared_ptr<Node>) const;
@@ -247,12 +423,23 @@ protected:
     shared_ptr<Node> _iter_insert(const T&);  // recursive insert
     shared_ptr<Node> _rec_insert(const shared_ptr<Node>, const T&);  // recursive insert
     void transplant(const shared_ptr<Node>, shared_ptr<Node>);
-    void remove(const shared_ptr<Node>);
+    shared_ptr<Node> remove(const shared_ptr<Node>);
+    void build(const vector<T>& sorted) {
+        this -> m_root = build(sorted, 0, sorted.size(), nullptr);
+    }
+    shared_ptr<Node> build(const vector<T>&, size_t, size_t, const shared_ptr<Node>&);
+    void merge_sorted(const vector<T>& sorted) {
+        vector<T> keys = sorted_keys();
+        vector<T> all;
+        all.reserve(keys.size() + sorted.size());
+        std::merge(keys.begin(), keys.end(), sorted.begin(), sorted.end(), back_inserter(all));
+        build(all);
+    }
 };
 
 
-template <typename T>
-class AVLTree : public BinarySearchTree<T> {
+template <typename T, typename Alloc>
+class AVLTree : public BinarySearchTree<T, Alloc> {
     /*
     AVL balanced binary search tree.
     Reference: MIT OCW 6.006 2011 Lecture 6.
@@ -261,17 +448,21 @@ class AVLTree : public BinarySearchTree<T> {
     AVL Sort vs Heap Sort: 48:33 - End
     Code: https://ocw.mit.edu/courses/electrical-engineering-and-computer-science/6-006-introduction-to-algorithms-fall-2011/readings/binary-search-trees/  # noqa
     */
-using Node = typename BinaryTree<T>::Node;
+using Node = typename BinaryTree<T, Alloc>::Node;
 public:
-    AVLTree() : BinarySearchTree<T>() {}
-    AVLTree(const vector<T>& tree_vec) : BinarySearchTree<T>() {
-        for (auto e : tree_vec)
-            insert(e);
-    }
+    AVLTree() : BinarySearchTree<T, Alloc>() {}
+    explicit AVLTree(const Alloc& alloc) : BinarySearchTree<T, Alloc>(alloc) {}
+    AVLTree(const vector<T>& tree_vec, const Alloc& alloc = Alloc()) : BinarySearchTree<T, Alloc>(tree_vec, alloc) {}
     void insert(const T& e) {
-        auto x = BinarySearchTree<T>::_iter_insert(e);
+        auto x = BinarySearchTree<T, Alloc>::_iter_insert(e);
         rebalance(x);
     }
+    void remove(const T& e) {
+        if (!this -> m_root) throw(EmptyTreeError("Empty AVLTree."));
+        auto x_node = BinarySearchTree<T, Alloc>::search(this -> m_root, e);
+        if (!x_node) throw ValueError("Input value not in AVLTree.");
+        rebalance(BinarySearchTree<T, Alloc>::remove(x_node));
+    }
 private:
     void left_rotate(shared_ptr<Node>);
     void right_rotate(shared_ptr<Node>);
@@ -281,32 +472,59 @@ private:
 
 /* ------ Template Class Member Function Definitions: Core Algorithms ------ */
 
-template <typename T>
-void BinaryTree<T>::pre_order(const shared_ptr<Node> node, Callback cb) const {
-    if (!node) return;
-    cb(node -> m_key);
-    pre_order(node -> m_left, cb);
-    pre_order(node -> m_right, cb);
+template <typename T, typename Alloc>
+void BinaryTree<T, Alloc>::clear() {
+    constexpr bool skip_nodes = ADT::is_monotonic_allocator<Alloc>::value && is_trivially_destructible<T>::value;
+    if constexpr (skip_nodes) {
+        // Forget the root without releasing it. The nodes hold nothing but
+        // their links, and those live in the arena too.
+        new (&m_root) shared_ptr<Node>();
+    }
+    else {
+        // Detach the children of a node before releasing it, so no release
+        // cascades. A node still shared, as with a copy of the tree, is only
+        // unlinked.
+        ADT::ArrayStack<shared_ptr<Node>> stk(height() + 2);
+        if (m_root) stk.push(std::move(m_root));
+        while (!stk.empty()) {
+            shared_ptr<Node> nd = stk.pop();
+            if (nd.use_count() > 1) continue;
+            if (nd -> m_left) stk.push(std::move(nd -> m_left));
+            if (nd -> m_right) stk.push(std::move(nd -> m_right));
+        }
+    }
+}
+
+template <typename T, typename Alloc>
+template <typename F>
+bool BinaryTree<T, Alloc>::pre_order(const Node* node, F& cb) {
+    if (!node) return true;
+    return visit(cb, node -> m_key)
+        && pre_order(node -> m_left.get(), cb)
+        && pre_order(node -> m_right.get(), cb);
 }
 
-template <typename T>
-void BinaryTree<T>::in_order(const shared_ptr<Node> node, Callback cb) const {
-    if (!node) return;
-    in_order(node -> m_left, cb);
-    cb(node -> m_key);
-    in_order(node -> m_right, cb);
+template <typename T, typename Alloc>
+template <typename F>
+bool BinaryTree<T, Alloc>::in_order(const Node* node, F& cb) {
+    if (!node) return true;
+    return in_order(node -> m_left.get(), cb)
+        && visit(cb, node -> m_key)
+        && in_order(node -> m_right.get(), cb);
 }
 
-template <typename T>
-void BinaryTree<T>::post_order(const shared_ptr<Node> node, Callback cb) const {
-    if (!node) return;
-    post_order(node -> m_left, cb);
-    post_order(node -> m_right, cb);
-    cb(node -> m_key);
+template <typename T, typename Alloc>
+template <typename F>
+bool BinaryTree<T, Alloc>::post_order(const Node* node, F& cb) {
+    if (!node) return true;
+    return post_order(node -> m_left.get(), cb)
+        && post_order(node -> m_right.get(), cb)
+        && visit(cb, node -> m_key);
 }
 
-template <typename T>
-void BinaryTree<T>::pre_order_iter(const shared_ptr<Node> node, Callback cb) const {
+template <typename T, typename Alloc>
+template <typename F>
+bool BinaryTree<T, Alloc>::pre_order_iter(const Node* node, F& cb) const {
     // Iterative preorder traversal using a stack.
     // http://www.geeksforgeeks.org/iterative-preorder-traversal/
     // 1) Create an empty stack and push root node to stack.
@@ -314,40 +532,41 @@ void BinaryTree<T>::pre_order_iter(const shared_ptr<Node> node, Callback cb) con
     // ….a) Pop an item from stack and print it.
     // ….b) Push right child of popped item to stack
     // ….c) Push left child of popped item to stack
-    if (!node) return;
-    stack<shared_ptr<Node>> stk;
+    if (!node) return true;
+    ADT::ArrayStack<const Node*> stk(height() + 2);  // at most one pending right child per level, plus one
     stk.push(node);
-    shared_ptr<Node> nd;
     while (!stk.empty()) {
-        nd = stk.top();
-        stk.pop();
-        cb(nd -> m_key);
-        if (nd -> m_right) stk.push(nd -> m_right);
-        if (nd -> m_left) stk.push(nd -> m_left);
+        const Node* nd = stk.pop();
+        if (!visit(cb, nd -> m_key)) return false;
+        if (nd -> m_right) stk.push(nd -> m_right.get());
+        if (nd -> m_left) stk.push(nd -> m_left.get());
     }
+    return true;
 }
 
-template <typename T>
-void BinaryTree<T>::in_order_iter(const shared_ptr<Node> node, Callback cb) const {
-    if (!node) return;
-    stack<shared_ptr<Node>> stk;
-    shared_ptr<Node> nd {node};
+template <typename T, typename Alloc>
+template <typename F>
+bool BinaryTree<T, Alloc>::in_order_iter(const Node* node, F& cb) const {
+    if (!node) return true;
+    ADT::ArrayStack<const Node*> stk(height() + 1);
+    const Node* nd {node};
     while (!stk.empty() || nd) {
         if (nd) {
             stk.push(nd);
-            nd = nd -> m_left;
+            nd = nd -> m_left.get();
         }
         else {  // non-empty stack
-            nd = stk.top();
-            stk.pop();
-            cb(nd -> m_key);
-            nd = nd -> m_right;
+            nd = stk.pop();
+            if (!visit(cb, nd -> m_key)) return false;
+            nd = nd -> m_right.get();
         }
     }
+    return true;
 }
 
-template <typename T>
-void BinaryTree<T>::post_order_iter_twostacks(const shared_ptr<Node> node, Callback cb) const {
+template <typename T, typename Alloc>
+template <typename F>
+bool BinaryTree<T, Alloc>::post_order_iter_twostacks(const Node* node, F& cb) const {
     // Iterative postorder traversal using two stacks.
     // http://www.geeksforgeeks.org/iterative-postorder-traversal/
     // 1. Push root to first stack.
@@ -355,67 +574,69 @@ void BinaryTree<T>::post_order_iter_twostacks(const shared_ptr<Node> node, Callb
     //    2.1 Pop a node from first stack and push it to second stack
     //    2.2 Push left and right children of the popped node to first stack
     // 3. Print contents of second stack
-    if (!node) return;
-    stack<shared_ptr<Node>> stk1;
-    stack<shared_ptr<Node>> stk2;
+    if (!node) return true;
+    ADT::ArrayStack<const Node*> stk1(height() + 2);
+    ADT::ArrayStack<const Node*> stk2(node -> m_size);
     stk1.push(node);
-    shared_ptr<Node> nd;
     while (!stk1.empty()) {
-        nd = stk1.top();
-        stk1.pop();
+        const Node* nd = stk1.pop();
         stk2.push(nd);
-        if (nd -> m_left) stk1.push(nd -> m_left);
-        if (nd -> m_right) stk1.push(nd -> m_right);
+        if (nd -> m_left) stk1.push(nd -> m_left.get());
+        if (nd -> m_right) stk1.push(nd -> m_right.get());
     }
     while (!stk2.empty()) {
-        cb(stk2.top() -> m_key);
-        stk2.pop();
+        if (!visit(cb, stk2.pop() -> m_key)) return false;
     }
+    return true;
 }
 
-template <typename T>
-void BinaryTree<T>::post_order_iter_onestack(const shared_ptr<Node> node, Callback cb) const {
-    if (!node) return;
-    stack<shared_ptr<Node>> stk;
-    shared_ptr<Node> nd {node};
-    shared_ptr<Node> last {nullptr};  // last visited node
+template <typename T, typename Alloc>
+template <typename F>
+bool BinaryTree<T, Alloc>::post_order_iter_onestack(const Node* node, F& cb) const {
+    if (!node) return true;
+    ADT::ArrayStack<const Node*> stk(height() + 1);
+    const Node* nd {node};
+    const Node* last {nullptr};  // last visited node
     while (!stk.empty() || nd) {
         if (nd) {
             stk.push(nd);
-            nd = nd -> m_left;
+            nd = nd -> m_left.get();
         }
         else {  // reached current level's leftmost node's left NIL child
             nd = stk.top();  // go back to parent
-            if (!nd -> m_right || last == nd -> m_right) {  // no right child, or has visited right child last time
-                cb(nd -> m_key);
+            if (!nd -> m_right || last == nd -> m_right.get()) {  // no right child, or has visited right child last time
+                if (!visit(cb, nd -> m_key)) return false;
                 stk.pop();
                 last = nd;
                 nd = nullptr;
             }
             else {  // visit right child
-                nd = nd -> m_right;
+                nd = nd -> m_right.get();
             }
         }
     }
+    return true;
 }
 
-template <typename T>
-void BinaryTree<T>::bfs(const shared_ptr<Node> node, Callback cb) const {
-    if (!node) return;
-    queue<shared_ptr<Node>> child_queue;
-    child_queue.push(node);
-    shared_ptr<Node> nd;
-    while (!child_queue.empty()) {
-        nd = child_queue.front();
-        cb(nd -> m_key);
-        child_queue.pop();
-        if (nd -> m_left) child_queue.push(nd -> m_left);
-        if (nd -> m_right) child_queue.push(nd -> m_right);
+template <typename T, typename Alloc>
+template <typename F>
+bool BinaryTree<T, Alloc>::bfs(const Node* node, F& cb) const {
+    // The queue is a vector read from a moving front index.
+    if (!node) return true;
+    vector<const Node*> child_queue;
+    child_queue.reserve(node -> m_size);
+    child_queue.push_back(node);
+    for (size_t front = 0; front < child_queue.size(); ++front) {
+        const Node* nd = child_queue[front];
+        if (!visit(cb, nd -> m_key)) return false;
+        if (nd -> m_left) child_queue.push_back(nd -> m_left.get());
+        if (nd -> m_right) child_queue.push_back(nd -> m_right.get());
     }
+    return true;
 }
 
-template <typename T>
-shared_ptr<typename BinaryTree<T>::Node> BinarySearchTree<T>::search(const shared_ptr<Node> node, const T& x) const {
+template <typename T, typename Alloc>
+shared_ptr<typename BinaryTree<T, Alloc>::Node> BinarySearchTree<T, Alloc>::search(const shared_ptr<Node> node, const T& x) const {
     if (!node || x == node -> m_key)
         return node;
     if (x < node -> m_key)
@@ -424,8 +645,8 @@ shared_ptr<typename BinaryTree<T>::Node> BinarySearchTree<T>::search(const share
         return search(node -> m_right, x);
 }
 
-template <typename T>
-shared_ptr<typename BinaryTree<T>::Node> BinarySearchTree<T>::iter_search(const shared_ptr<Node> node, const T& x) const {
+template <typename T, typename Alloc>
+shared_ptr<typename BinaryTree<T, Alloc>::Node> BinarySearchTree<T, Alloc>::iter_search(const shared_ptr<Node> node, const T& x) const {
     shared_ptr<Node> nd {node};
     while (nd and x != nd -> m_key)
         if (x < nd -> m_key)
@@ -435,24 +656,24 @@ shared_ptr<typename BinaryTree<T>::Node> BinarySearchTree<T>::iter_search(const
     return nd;
 }
 
-template <typename T>
-shared_ptr<typename BinaryTree<T>::Node> BinarySearchTree<T>::minimum(const shared_ptr<Node> node) const {
+template <typename T, typename Alloc>
+shared_ptr<typename BinaryTree<T, Alloc>::Node> BinarySearchTree<T, Alloc>::minimum(const shared_ptr<Node> node) const {
     auto nd {node};
     while (nd && nd -> m_left)
         nd = nd -> m_left;
     return nd;
 }
 
-template <typename T>
-shared_ptr<typename BinaryTree<T>::Node> BinarySearchTree<T>::maximum(const shared_ptr<Node> node) const {
+template <typename T, typename Alloc>
+shared_ptr<typename BinaryTree<T, Alloc>::Node> BinarySearchTree<T, Alloc>::maximum(const shared_ptr<Node> node) const {
     auto nd {node};
     while (nd && nd -> m_right)
         nd = nd -> m_right;
     return nd;
 }
 
-template <typename T>
-shared_ptr<typename BinaryTree<T>::Node> BinarySearchTree<T>::successor(const shared_ptr<Node> node) const {
+template <typename T, typename Alloc>
+shared_ptr<typename BinaryTree<T, Alloc>::Node> BinarySearchTree<T, Alloc>::successor(const shared_ptr<Node> node) const {
     if (!node) return nullptr;
     if (node -> m_right)
         return minimum(node -> m_right);
@@ -467,8 +688,8 @@ shared_ptr<typename BinaryTree<T>::Node> BinarySearchTree<T>::successor(const sh
     return par;
 }
 
-template <typename T>
-shared_ptr<typename BinaryTree<T>::Node> BinarySearchTree<T>::predecessor(const shared_ptr<Node> node) const {
+template <typename T, typename Alloc>
+shared_ptr<typename BinaryTree<T, Alloc>::Node> BinarySearchTree<T, Alloc>::predecessor(const shared_ptr<Node> node) const {
     if (!node) return nullptr;
     if (node -> m_left)
         return maximum(node -> m_left);
@@ -483,10 +704,10 @@ shared_ptr<typename BinaryTree<T>::Node> BinarySearchTree<T>::predecessor(const
     return par;
 }
 
-template <typename T>
-shared_ptr<typename BinaryTree<T>::Node> BinarySearchTree<T>::_iter_insert(const T& x) {
+template <typename T, typename Alloc>
+shared_ptr<typename BinaryTree<T, Alloc>::Node> BinarySearchTree<T, Alloc>::_iter_insert(const T& x) {
     // CLRS 12.3 TREE-INSERT(T, z)
-    auto new_nd = make_shared<Node>(x);
+    auto new_nd = this -> new_node(x);
     shared_ptr<Node> par_nd {nullptr};  // parent of current node x
     auto cur_nd = this -> m_root;
     while (cur_nd) {  // search correct position for new node and its parent
@@ -503,13 +724,14 @@ shared_ptr<typename BinaryTree<T>::Node> BinarySearchTree<T>::_iter_insert(const
         par_nd -> m_left = new_nd;
     else
         par_nd -> m_right = new_nd;
+    this -> update_path(par_nd);
     return new_nd;
 }
 
-template <typename T>
-shared_ptr<typename BinaryTree<T>::Node> BinarySearchTree<T>::_rec_insert(shared_ptr<Node> node, const T& x) {
+template <typename T, typename Alloc>
+shared_ptr<typename BinaryTree<T, Alloc>::Node> BinarySearchTree<T, Alloc>::_rec_insert(shared_ptr<Node> node, const T& x) {
     if (!node)
-        return make_shared<Node>(x);
+        return this -> new_node(x);
     else if (x < node -> m_key) {
         node -> m_left = _rec_insert(node -> m_left, x);
         node -> m_left -> m_parent = node;
@@ -518,14 +740,30 @@ shared_ptr<typename BinaryTree<T>::Node> BinarySearchTree<T>::_rec_insert(shared
         node -> m_right = _rec_insert(node -> m_right, x);
         node -> m_right -> m_parent = node;
     }
+    this -> update(node);
     return node;
 }
 
-template <typename T>
-void BinarySearchTree<T>::transplant(const shared_ptr<Node> u, shared_ptr<Node> v) {
+template <typename T, typename Alloc>
+shared_ptr<typename BinaryTree<T, Alloc>::Node> BinarySearchTree<T, Alloc>::build(
+        const vector<T>& sorted, size_t lo, size_t hi, const shared_ptr<Node>& parent) {
+    // Balanced subtree of sorted[lo, hi): the middle key at the root, the halves as children.
+    if (lo == hi)
+        return nullptr;
+    size_t mid = lo + (hi - lo) / 2;
+    auto nd = this -> new_node(sorted[mid]);
+    nd -> m_parent = parent;
+    nd -> m_left = build(sorted, lo, mid, nd);
+    nd -> m_right = build(sorted, mid + 1, hi, nd);
+    this -> update(nd);
+    return nd;
+}
+
+template <typename T, typename Alloc>
+void BinarySearchTree<T, Alloc>::transplant(const shared_ptr<Node> u, shared_ptr<Node> v) {
     if (this -> m_root == u) {
         this -> m_root = v;
-        v -> m_parent = u -> m_parent;
+        if (v) v -> m_parent = u -> m_parent;
         return;
     }
     auto par = u -> m_parent.lock();
@@ -537,16 +775,20 @@ void BinarySearchTree<T>::transplant(const shared_ptr<Node> u, shared_ptr<Node>
         v -> m_parent = weak_ptr<Node>(par);
 }
 
-template <typename T>
-void BinarySearchTree<T>::remove(const shared_ptr<Node> node) {
+template <typename T, typename Alloc>
+shared_ptr<typename BinaryTree<T, Alloc>::Node> BinarySearchTree<T, Alloc>::remove(const shared_ptr<Node> node) {
     // CLRS 12.3 TREE-DELETE(T, z)
+    // Return the lowest node whose subtree changed, after updating it and its ancestors.
+    shared_ptr<Node> changed = node -> m_parent.lock();
     if (!node -> m_left)
         transplant(node, node -> m_right);
     else if (!node -> m_right)
         transplant(node, node -> m_left);
     else {
         auto suc = successor(node);
+        changed = suc;
         if (node -> m_right != suc) {  // case D: delete successor, and move it to top of node's right branch
+            changed = suc -> m_parent.lock();
             transplant(suc, suc -> m_right);
             suc -> m_right = node -> m_right;
             suc -> m_right -> m_parent = weak_ptr<Node>(suc);
@@ -557,10 +799,12 @@ void BinarySearchTree<T>::remove(const shared_ptr<Node> node) {
         suc -> m_left = node -> m_left;
         suc -> m_left -> m_parent = weak_ptr<Node>(suc);
     }
+    this -> update_path(changed);
+    return changed;
 }
 
-template <typename T>
-void AVLTree<T>::left_rotate(shared_ptr<Node> x) {
+template <typename T, typename Alloc>
+void AVLTree<T, Alloc>::left_rotate(shared_ptr<Node> x) {
     /*
     CLRS 13.2 LEFT-ROTATE(T, x)
     */
@@ -583,10 +827,12 @@ void AVLTree<T>::left_rotate(shared_ptr<Node> x) {
     // Reconnect y to x
     y -> m_left = x;
     x -> m_parent = weak_ptr<Node>(y);
+    this -> update(x);
+    this -> update(y);
 }
 
-template <typename T>
-void AVLTree<T>::right_rotate(shared_ptr<Node> x) {
+template <typename T, typename Alloc>
+void AVLTree<T, Alloc>::right_rotate(shared_ptr<Node> x) {
     /*
     RIGHT-ROTATE(T, x) mirrors LEFT-ROTATE.
     */
@@ -609,15 +855,18 @@ void AVLTree<T>::right_rotate(shared_ptr<Node> x) {
     // Reconnect y to x
     y -> m_right = x;
     x -> m_parent = weak_ptr<Node>(y);
+    this -> update(x);
+    this -> update(y);
 }
 
-template <typename T>
-void AVLTree<T>::rebalance(shared_ptr<Node> x) {
+template <typename T, typename Alloc>
+void AVLTree<T, Alloc>::rebalance(shared_ptr<Node> x) {
     /*
     Check children height balance from node x up to root. If unbalance is
     found, rebalance and then keep checking until reaching root's parent.
     */
     while (x) {  // loop until x is root's parent
+        this -> update(x);
         if (this -> height(x -> m_left) > this -> height(x -> m_right) + 1) {  // left heavy
             if (this -> height(x -> m_left -> m_left) >= this -> height(x -> m_left -> m_right)) {  // straight-line case
                 this -> right_rotate(x);
@@ -1,238 +1,533 @@
 #ifndef __UNORDERED_MAP_H_
 #define __UNORDERED_MAP_H_
 
+#include <algorithm>
+#include <cmath>
 #include <utility>
 #include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
 #include "vector.hh"
 #include "hash.hh"
+#include "bucket_policy.hh"
+#include "allocator.hh"
+#include "map_stats.hh"
 
 namespace ADT {
 
 
-template <typename K, typename V>
-class unordered_map {
-    // TODO: Need const_iterator
+template <typename K, typename V, typename Hash = hasher<K>,
+          typename BucketPolicy = power_of_two_policy, typename RehashPolicy = eager_rehash,
+          typename Alloc = std::allocator<std::pair<K, V>>, typename Stats = no_stats>
+class unordered_map : private Stats {
+    /*
+    ** Separate chaining hash map.
+    ** With RehashPolicy = incremental_rehash<N>, growing keeps the old bucket array
+    ** and every operator[], find and erase migrates N more old buckets to the new one
+    ** (Redis style), instead of relinking all nodes inside one insert. Elements may
+    ** then move between bucket arrays on any of these calls: iterators are
+    ** invalidated, references to elements are not.
+    ** Nodes come from Alloc, e.g. ADT::pool_allocator to carve them out of slabs.
+    ** Stats = map_stats counts lookups, probes and rehashes (map_stats.hh).
+    ** With a transparent Hash, such as the default hasher<std::string>, find,
+    ** contains, erase, try_emplace and insert_or_assign also take any key type
+    ** that Hash hashes alike to the equal K and that compares to K with ==,
+    ** e.g. a string_view or C string for string keys, and build a K only to
+    ** insert it.
+    */
+    template <bool Const> class basic_iterator;
 
     public:
         using T = std::pair<K, V>;
-        class iterator;
-
-        unordered_map() { init_buckets(m_init_bucket_num); }
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        explicit unordered_map(size_t bucket_count = m_init_bucket_num, const Hash& hash = Hash(),
+                               const Alloc& alloc = Alloc())
+            : m_hash{hash}, m_alloc{alloc} { init_buckets(bucket_count); }
+        explicit unordered_map(const Alloc& alloc)
+            : unordered_map(m_init_bucket_num, Hash(), alloc) {}
+        unordered_map(const unordered_map&) = delete;
+        unordered_map& operator=(const unordered_map&) = delete;
         virtual ~unordered_map() { clear(); }
 
         // iterator
         iterator begin() { return iterator(this, true); }
         iterator end() { return iterator(this, false); }
+        const_iterator begin() const { return const_iterator(this, true); }
+        const_iterator end() const { return const_iterator(this, false); }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
 
         // Capacity
         bool empty() const noexcept { return m_size == 0; }
         size_t size() const noexcept { return m_size; }
         size_t bucket_count() const noexcept { return m_bcnt; } 
 
+        // Hash policy
+        double load_factor() const noexcept { return double(m_size) / m_bcnt; }
+        double max_load_factor() const noexcept { return m_max_load; }
+        void max_load_factor(double ml);
+        void rehash(size_t count);
+        void reserve(size_t n) { rehash(size_t(std::ceil(n / m_max_load))); }
+        bool rehashing() const noexcept { return m_old_bcnt != 0; }
+
+        // Statistics
+        hash_map_stats stats() const;
+        void reset_stats() { static_cast<Stats&>(*this) = Stats(); }
+
+    private:
+        // Enables the overloads for a key type Q other than K.
+        template <typename Q, typename R = void>
+        using if_transparent = typename std::enable_if<is_transparent_hash<Hash>::value &&
+                                                       !std::is_same<typename std::decay<Q>::type, K>::value, R>::type;
+
+    public:
         // Element access
-        V& operator[](const K& key);
-        
-        // Element lookup
-        iterator find(const K& key);
-         
+        V& operator[](const K& key) { return emplace_key(key).first -> second; }
+        V& operator[](K&& key) { return emplace_key(std::move(key)).first -> second; }
+
+        // Element lookup. The const overloads neither migrate buckets nor
+        // count for Stats.
+        iterator find(const K& key) { return find_key(key); }
+        template <typename Q, typename = if_transparent<Q>>
+        iterator find(const Q& key) { return find_key(key); }
+        const_iterator find(const K& key) const { return find_key(key); }
+        template <typename Q, typename = if_transparent<Q>>
+        const_iterator find(const Q& key) const { return find_key(key); }
+        bool contains(const K& key) const { return find_key(key) != end(); }
+        template <typename Q, typename = if_transparent<Q>>
+        bool contains(const Q& key) const { return find_key(key) != end(); }
+
         // Modifiers
         void insert(const T& p) { (*this)[p.first] = p.second; }
-        size_t erase(const K& key);
+        // Insert key with V(args...) unless key is in the map, in which case
+        // neither key nor args are touched. The bool tells if it inserted.
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+            return emplace_key(key, std::forward<Args>(args)...);
+        }
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+            return emplace_key(std::move(key), std::forward<Args>(args)...);
+        }
+        template <typename Q, typename... Args>
+        if_transparent<Q, std::pair<iterator, bool>> try_emplace(Q&& key, Args&&... args) {
+            return emplace_key(std::forward<Q>(key), std::forward<Args>(args)...);
+        }
+        // Assign obj to the value of key, inserting key if it is missing.
+        template <typename M>
+        std::pair<iterator, bool> insert_or_assign(const K& key, M&& obj) {
+            return assign_key(key, std::forward<M>(obj));
+        }
+        template <typename M>
+        std::pair<iterator, bool> insert_or_assign(K&& key, M&& obj) {
+            return assign_key(std::move(key), std::forward<M>(obj));
+        }
+        template <typename Q, typename M>
+        if_transparent<Q, std::pair<iterator, bool>> insert_or_assign(Q&& key, M&& obj) {
+            return assign_key(std::forward<Q>(key), std::forward<M>(obj));
+        }
+        size_t erase(const K& key) { return erase_key(key); }
+        template <typename Q, typename = if_transparent<Q>>
+        size_t erase(const Q& key) { return erase_key(key); }
         void clear();
-        
+
     private:
         struct Node {
+            template <typename Q, typename... Args>
+            Node(Node* nxt, Q&& key, Args&&... args)
+                : kv{std::piecewise_construct, std::forward_as_tuple(std::forward<Q>(key)),
+                     std::forward_as_tuple(std::forward<Args>(args)...)}, next{nxt} {}
             T kv;
             Node* next;
         };
+        using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+        using NodeTraits = std::allocator_traits<NodeAlloc>;
 
-        static constexpr int m_init_bucket_num = 100;
-        static constexpr double m_max_load = .8;  // 80%
-        int m_bcnt;  // number of buckets
-        int m_size;
+        static constexpr size_t m_init_bucket_num = 16;
+        double m_max_load = .8;  // 80%
+        size_t m_bcnt;  // number of buckets
+        size_t m_size;
         vector<Node*> m_buckets;
+        Hash m_hash;
+        NodeAlloc m_alloc;
+
+        // Incremental rehash state. Old buckets below m_migrate_idx are empty.
+        vector<Node*> m_old_buckets;
+        size_t m_old_bcnt = 0;  // 0 unless an incremental rehash is in progress
+        size_t m_migrate_idx = 0;  // next old bucket to migrate
 
         // supporting methods
-        void init_buckets(int k);
-        Node* insert_new_node(const K& key);
-        void reserve(int n);
-        Node* find_node(int bucket_idx, const K& key, Node*& prv);
+        size_t bucket_index(hash_t h) const { return BucketPolicy::index(h, m_bcnt); }
+        void init_buckets(size_t k);
+        template <typename Q, typename... Args>
+        Node* insert_new_node(hash_t h, Q&& key, Args&&... args);
+        void delete_node(Node* node);
+        template <typename Q>
+        Node* const* locate(const Q& key, hash_t h, size_t& it_idx, size_t& probes) const;
+        // locate, counted by Stats.
+        template <typename Q>
+        Node** find_link(const Q& key, hash_t h, size_t& it_idx) {
+            size_t probes = 0;
+            Node** link = const_cast<Node**>(locate(key, h, it_idx, probes));
+            Stats::on_lookup(*link != nullptr, probes);
+            return link;
+        }
+        template <typename Q>
+        static Node* const* find_in_bucket(Node* const* link, const Q& key, size_t& probes);
+        template <typename Q>
+        iterator find_key(const Q& key);
+        template <typename Q>
+        const_iterator find_key(const Q& key) const {
+            size_t it_idx, probes = 0;
+            const Node* node = *locate(key, m_hash(key), it_idx, probes);
+            return node ? const_iterator(this, it_idx, node) : end();
+        }
+        template <typename Q, typename... Args>
+        std::pair<iterator, bool> emplace_key(Q&& key, Args&&... args);
+        template <typename Q, typename M>
+        std::pair<iterator, bool> assign_key(Q&& key, M&& obj);
+        template <typename Q>
+        size_t erase_key(const Q& key);
+        void relink_all(size_t bcnt);
+        void migrate(size_t n);
+        void grow();
+
+        // Buckets as seen by iterators: old buckets first, then the current ones.
+        size_t iter_bucket_count() const { return m_old_bcnt + m_bcnt; }
+        Node* iter_bucket(size_t i) const {
+            return i < m_old_bcnt ? m_old_buckets[i] : m_buckets[i - m_old_bcnt];
+        }
+
+        template <bool Const>
+        class basic_iterator {
+            /*
+            ** Forward iterator, old buckets first during an incremental
+            ** rehash. An iterator converts to a const_iterator.
+             */
+            using map_ptr = typename std::conditional<Const, const unordered_map*, unordered_map*>::type;
+            using node_ptr = typename std::conditional<Const, const Node*, Node*>::type;
 
-    public:  // iterator
-        class iterator : public std::iterator<std::forward_iterator_tag, K> {
             public:
-                iterator() = default;
-                iterator(unordered_map<K, V> *ump, int bucket_idx, Node* node)
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = typename std::conditional<Const, const T*, T*>::type;
+                using reference = typename std::conditional<Const, const T&, T&>::type;
+
+                basic_iterator() = default;
+                basic_iterator(map_ptr ump, size_t bucket_idx, node_ptr node)
                     : m_ump{ump}, m_bucket_idx{bucket_idx}, m_node{node} {}
-                iterator(unordered_map<K, V> *ump, bool begin) {
-                    m_ump = ump;
+                basic_iterator(map_ptr ump, bool begin) : m_ump{ump} {
                     if (begin) {
                         m_bucket_idx = 0;
-                        m_node = ump -> m_buckets[m_bucket_idx];
-                        while (!m_node && ++m_bucket_idx < ump -> m_bcnt)
-                            m_node = ump -> m_buckets[m_bucket_idx];
+                        m_node = ump -> iter_bucket(m_bucket_idx);
+                        while (!m_node && ++m_bucket_idx < ump -> iter_bucket_count())
+                            m_node = ump -> iter_bucket(m_bucket_idx);
                     }
                     else {  // end
-                        m_bucket_idx = ump -> m_bcnt;
+                        m_bucket_idx = ump -> iter_bucket_count();
                         m_node = nullptr;
                     }
                 }
+                template <bool C = Const, typename = typename std::enable_if<C>::type>
+                basic_iterator(const basic_iterator<false>& it)
+                    : m_ump{it.m_ump}, m_bucket_idx{it.m_bucket_idx}, m_node{it.m_node} {}
 
-                iterator(const iterator& it) {
-                    m_ump = it.m_ump;
-                    m_bucket_idx = it.m_bucket_idx;
-                    m_node = it.m_node;
-                }
-
-                iterator& operator=(iterator it) {
-                    m_ump = it.m_ump;
-                    m_bucket_idx = it.m_bucket_idx;
-                    m_node = it.m_node;
-                }
-
-                iterator & operator++() {
+                basic_iterator& operator++() {
                     m_node = m_node->next;
-                    while (!m_node && ++m_bucket_idx < m_ump -> m_bcnt)
-                        m_node = m_ump -> m_buckets[m_bucket_idx];
+                    while (!m_node && ++m_bucket_idx < m_ump -> iter_bucket_count())
+                        m_node = m_ump -> iter_bucket(m_bucket_idx);
                     return *this;
                 }
 
-                iterator operator++(int) {
-                    iterator old(*this);
+                basic_iterator operator++(int) {
+                    basic_iterator old(*this);
                     operator++();
                     return old;
                 }
 
-                bool operator==(const iterator& it) {
-                    return m_ump == it.m_ump && m_bucket_idx == it.m_bucket_idx && m_node == it.m_node;
+                bool operator==(const basic_iterator& it) const {
+                    // Nodes are unique, and all end iterators have a null node.
+                    return m_ump == it.m_ump && m_node == it.m_node;
                 }
 
-                bool operator!=(const iterator& it) {
+                bool operator!=(const basic_iterator& it) const {
                     return !(*this == it);
                 }
 
-                T& operator*() {
+                reference operator*() const {
                     return m_node -> kv;
                 }
 
-                T* operator->() {
+                pointer operator->() const {
                     return &(m_node -> kv);
                 }
 
             private:
-                unordered_map<K, V> *m_ump;
-                int m_bucket_idx;
-                Node* m_node;
+                template <bool> friend class basic_iterator;
+
+                map_ptr m_ump = nullptr;
+                size_t m_bucket_idx = 0;
+                node_ptr m_node = nullptr;
         };
 };
 
 
-template <typename K, typename V>
-void unordered_map<K, V>::init_buckets(int k) {
-    k = k < 1 ? 1 : k;
-    m_buckets = vector<Node*>(k, nullptr);
-    m_bcnt = k;
+#define UNORDERED_MAP_TEMPLATE template <typename K, typename V, typename Hash, typename BucketPolicy, \
+                                          typename RehashPolicy, typename Alloc, typename Stats>
+#define UNORDERED_MAP unordered_map<K, V, Hash, BucketPolicy, RehashPolicy, Alloc, Stats>
+
+UNORDERED_MAP_TEMPLATE
+void UNORDERED_MAP::init_buckets(size_t k) {
+    m_bcnt = BucketPolicy::bucket_count(k);
+    m_buckets = vector<Node*>(m_bcnt, nullptr);
     m_size = 0;
 }
 
-template <typename K, typename V>
-typename unordered_map<K, V>::Node* unordered_map<K, V>::insert_new_node(const K& key) {
-    int bucket_idx = hash(key) % m_bcnt;
-    Node* node = new Node;
-    (node -> kv).first = key;
-    (node -> kv).second = V();
-    node -> next = m_buckets[bucket_idx];
+UNORDERED_MAP_TEMPLATE
+template <typename Q, typename... Args>
+typename UNORDERED_MAP::Node* UNORDERED_MAP::insert_new_node(hash_t h, Q&& key, Args&&... args) {
+    size_t bucket_idx = bucket_index(h);
+    Node* node = NodeTraits::allocate(m_alloc, 1);
+    try {
+        NodeTraits::construct(m_alloc, node, m_buckets[bucket_idx], std::forward<Q>(key), std::forward<Args>(args)...);
+    }
+    catch (...) {
+        NodeTraits::deallocate(m_alloc, node, 1);
+        throw;
+    }
     m_buckets[bucket_idx] = node;
     m_size++;
     return node;
 }
 
-template <typename K, typename V>
-void unordered_map<K, V>::reserve(int n) {
-    vector<Node*> b{m_buckets};
-    m_bcnt = n + (n >> 3) + (n < 9 ? 3: 6);
-    init_buckets(m_bcnt);
+UNORDERED_MAP_TEMPLATE
+void UNORDERED_MAP::delete_node(Node* node) {
+    NodeTraits::destroy(m_alloc, node);
+    NodeTraits::deallocate(m_alloc, node, 1);
+}
+
+UNORDERED_MAP_TEMPLATE
+void UNORDERED_MAP::max_load_factor(double ml) {
+    m_max_load = ml > 0 ? ml : m_max_load;
+    if (load_factor() > m_max_load)
+        rehash(0);
+}
+
+UNORDERED_MAP_TEMPLATE
+void UNORDERED_MAP::rehash(size_t count) {
+    // Relink all nodes into at least count buckets, and at least enough
+    // buckets to stay within the max load factor.
+    migrate(m_old_bcnt);
+    size_t min_count = size_t(std::ceil(m_size / m_max_load));
+    size_t bcnt = BucketPolicy::bucket_count(count > min_count ? count : min_count);
+    if (bcnt != m_bcnt)
+        relink_all(bcnt);
+}
+
+UNORDERED_MAP_TEMPLATE
+void UNORDERED_MAP::relink_all(size_t bcnt) {
+    auto started = Stats::rehash_begin();
+    vector<Node*> b(bcnt, nullptr);
+    swap(m_buckets, b);
+    m_bcnt = bcnt;
     for (size_t i = 0; i < b.size(); ++i) {
         Node* node = b[i];
         while (node) {
             Node* next = node -> next;
             // re-hash
-            const K& key = (node->kv).first;
-            int new_idx = hash(key) % m_bcnt;
+            size_t new_idx = bucket_index(m_hash((node->kv).first));
             node -> next = m_buckets[new_idx];
             m_buckets[new_idx] = node;
-            m_size++;
             node = next;
         }
     }
+    Stats::rehash_end(started);
 }
 
-template <typename K, typename V>
-typename unordered_map<K, V>::Node* unordered_map<K, V>::find_node(int bucket_idx, const K& key, Node*& prv) {
-    prv = nullptr;
-    Node* node = m_buckets[bucket_idx];
-    while (node && (node->kv).first != key) {
-        prv = node;
-        node = node -> next;    
+UNORDERED_MAP_TEMPLATE
+void UNORDERED_MAP::migrate(size_t n) {
+    // Move the nodes of the next n old buckets to the current bucket array.
+    if (!m_old_bcnt)
+        return;
+    for (size_t end = std::min(m_old_bcnt, m_migrate_idx + n); m_migrate_idx < end; ++m_migrate_idx) {
+        Node* node = m_old_buckets[m_migrate_idx];
+        while (node) {
+            Node* next = node -> next;
+            size_t new_idx = bucket_index(m_hash((node->kv).first));
+            node -> next = m_buckets[new_idx];
+            m_buckets[new_idx] = node;
+            node = next;
+        }
+        m_old_buckets[m_migrate_idx] = nullptr;
+    }
+    if (m_migrate_idx == m_old_bcnt) {  // done
+        m_old_buckets = vector<Node*>();
+        m_old_bcnt = m_migrate_idx = 0;
+    }
+}
+
+UNORDERED_MAP_TEMPLATE
+void UNORDERED_MAP::grow() {
+    size_t bcnt = BucketPolicy::bucket_count(m_bcnt * 2);
+    if constexpr (RehashPolicy::migrate_step == 0) {
+        relink_all(bcnt);
+    }
+    else {
+        // Start an incremental rehash. A previous one normally finished long
+        // ago, since the table has doubled.
+        migrate(m_old_bcnt);
+        auto started = Stats::rehash_begin();
+        m_old_buckets = vector<Node*>(bcnt, nullptr);
+        swap(m_old_buckets, m_buckets);
+        m_old_bcnt = m_bcnt;
+        m_bcnt = bcnt;
+        m_migrate_idx = 0;
+        Stats::rehash_end(started);
     }
-    return node;
 }
 
-template <typename K, typename V>
-V& unordered_map<K, V>::operator[](const K& key) {
-    int bucket_idx = hash(key) % m_bcnt;
-    Node* prv;
-    Node* node = find_node(bucket_idx, key, prv);
-    if (!node) {  // default initialize a node for key
-        if (m_size > m_max_load * m_bcnt)
-            reserve(int(m_size / m_max_load));
-        node = insert_new_node(key);
+UNORDERED_MAP_TEMPLATE
+template <typename Q>
+typename UNORDERED_MAP::Node* const* UNORDERED_MAP::find_in_bucket(Node* const* link, const Q& key, size_t& probes) {
+    // Return the link pointing at the node of key, or the null link ending the chain.
+    // Adds the number of nodes compared to probes.
+    for (; *link; link = &((*link) -> next)) {
+        ++probes;
+        if (((*link)->kv).first == key)
+            break;
     }
-    return (node -> kv).second;
-}    
-
-template <typename K, typename V>
-typename unordered_map<K, V>::iterator unordered_map<K, V>::find(const K& key) {
-    Node* prv;
-    int bucket_idx = hash(key) % m_bcnt;
-    Node* node = find_node(bucket_idx, key, prv);
+    return link;
+}
+
+UNORDERED_MAP_TEMPLATE
+template <typename Q>
+typename UNORDERED_MAP::Node* const* UNORDERED_MAP::locate(const Q& key, hash_t h, size_t& it_idx,
+                                                             size_t& probes) const {
+    // During an incremental rehash, key may still be in an old bucket
+    // that has not been migrated yet.
+    if (m_old_bcnt) {
+        size_t old_idx = BucketPolicy::index(h, m_old_bcnt);
+        if (old_idx >= m_migrate_idx) {
+            Node* const* link = find_in_bucket(&m_old_buckets[old_idx], key, probes);
+            if (*link) {
+                it_idx = old_idx;
+                return link;
+            }
+        }
+    }
+    size_t bucket_idx = bucket_index(h);
+    it_idx = m_old_bcnt + bucket_idx;
+    return find_in_bucket(&m_buckets[bucket_idx], key, probes);
+}
+
+UNORDERED_MAP_TEMPLATE
+template <typename Q>
+typename UNORDERED_MAP::iterator UNORDERED_MAP::find_key(const Q& key) {
+    migrate(RehashPolicy::migrate_step);
+    size_t it_idx;
+    Node* node = *find_link(key, m_hash(key), it_idx);
     if (!node)
         return end();
     else
-        return {this, bucket_idx, node};
+        return {this, it_idx, node};
+}
+
+UNORDERED_MAP_TEMPLATE
+template <typename Q, typename... Args>
+std::pair<typename UNORDERED_MAP::iterator, bool> UNORDERED_MAP::emplace_key(Q&& key, Args&&... args) {
+    // The node of key, made from key and args if there is none.
+    migrate(RehashPolicy::migrate_step);
+    hash_t h = m_hash(key);
+    size_t it_idx;
+    Node* node = *find_link(key, h, it_idx);
+    if (node)
+        return {{this, it_idx, node}, false};
+    if (m_size + 1 > m_max_load * m_bcnt)
+        grow();
+    node = insert_new_node(h, std::forward<Q>(key), std::forward<Args>(args)...);
+    return {{this, m_old_bcnt + bucket_index(h), node}, true};
+}
+
+UNORDERED_MAP_TEMPLATE
+template <typename Q, typename M>
+std::pair<typename UNORDERED_MAP::iterator, bool> UNORDERED_MAP::assign_key(Q&& key, M&& obj) {
+    migrate(RehashPolicy::migrate_step);
+    hash_t h = m_hash(key);
+    size_t it_idx;
+    Node* node = *find_link(key, h, it_idx);
+    if (node) {
+        (node -> kv).second = std::forward<M>(obj);
+        return {{this, it_idx, node}, false};
+    }
+    if (m_size + 1 > m_max_load * m_bcnt)
+        grow();
+    node = insert_new_node(h, std::forward<Q>(key), std::forward<M>(obj));
+    return {{this, m_old_bcnt + bucket_index(h), node}, true};
 }
 
-template <typename K, typename V>
-size_t unordered_map<K, V>::erase(const K& key) {
-    int bucket_idx = hash(key) % m_bcnt;
-    Node* prv;
-    Node* node = find_node(bucket_idx, key, prv);
+UNORDERED_MAP_TEMPLATE
+template <typename Q>
+size_t UNORDERED_MAP::erase_key(const Q& key) {
+    migrate(RehashPolicy::migrate_step);
+    size_t it_idx;
+    Node** link = find_link(key, m_hash(key), it_idx);
+    Node* node = *link;
     if (!node)
         return 0;
 
-    if (!prv)  // key is the first node in the bucket
-        m_buckets[bucket_idx] = node -> next;
-    else
-        prv -> next = node -> next;
-    delete node;
+    *link = node -> next;
+    delete_node(node);
     m_size--;
     return 1;
 }
 
-template <typename K, typename V>
-void unordered_map<K, V>::clear() {
-    for (size_t i = 0; i < m_bcnt; ++i) {
-        Node* node = m_buckets[i];
+UNORDERED_MAP_TEMPLATE
+void UNORDERED_MAP::clear() {
+    // Nodes of an arena need no visit unless they have destructors to run.
+    constexpr bool skip_nodes = is_monotonic_allocator<NodeAlloc>::value && std::is_trivially_destructible<Node>::value;
+    for (size_t i = 0; i < iter_bucket_count() && !skip_nodes; ++i) {
+        Node* node = iter_bucket(i);
         while (node) {
             Node* next = node -> next;
-            delete node;
+            delete_node(node);
             node = next;
         }
-        m_buckets[i] = nullptr;
     }
+    for (size_t i = 0; i < m_bcnt; ++i)
+        m_buckets[i] = nullptr;
+    m_old_buckets = vector<Node*>();
+    m_old_bcnt = m_migrate_idx = 0;
     m_size = 0;
 }
 
+UNORDERED_MAP_TEMPLATE
+hash_map_stats UNORDERED_MAP::stats() const {
+    hash_map_stats st;
+    st.size = m_size;
+    st.bucket_count = m_bcnt;
+    st.load_factor = load_factor();
+    st.bytes = (m_bcnt + m_old_bcnt) * sizeof(Node*) + m_size * sizeof(Node);
+    for (size_t i = m_migrate_idx; i < m_old_bcnt + m_bcnt; ++i) {  // skip migrated old buckets
+        size_t len = 0;
+        for (const Node* node = i < m_old_bcnt ? m_old_buckets[i] : m_buckets[i - m_old_bcnt]; node; node = node -> next)
+            ++len;
+        if (len >= st.histogram.size())
+            st.histogram.resize(len + 1, 0);
+        ++st.histogram[len];
+        st.max_chain = std::max(st.max_chain, len);
+    }
+    if constexpr (Stats::enabled)
+        st.counters = static_cast<const Stats&>(*this);
+    return st;
+}
+
+#undef UNORDERED_MAP
+#undef UNORDERED_MAP_TEMPLATE
+
 
 }  // end of namespace ADT
 
@@ -2,46 +2,113 @@
 #define __VECTOR_H_
 
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <utility>
 #include "exception.hh"
 
 
 namespace ADT {
 
+    /*
+    ** Growth policies: capacity to allocate when an insert needs required > capacity slots.
+    **   static size_t next_capacity(size_t capacity, size_t required);
+    ** A geometric factor makes n push_backs cost O(n) element moves in total.
+    */
+    template <size_t Num = 2, size_t Den = 1>
+    struct geometric_growth {
+        static_assert(Num > Den && Den > 0, "growth factor must be above 1");
+        static size_t next_capacity(size_t capacity, size_t required) {
+            size_t c = capacity * Num / Den;
+            if (c < 4)
+                c = 4;
+            return c > required ? c : required;
+        }
+    };
+
+    struct cpython_growth {
+        // Over-allocate by about 1/8, as CPython lists do. Less slack, more reallocations.
+        static size_t next_capacity(size_t, size_t required) {
+            return required + (required >> 3) + (required < 9 ? 3 : 6);
+        }
+    };
+
+
+    template <typename T, size_t N>
+    struct vector_inline_storage {
+        // Room for the first N elements inside the vector object.
+        T* data() { return std::launder(reinterpret_cast<T*>(m_bytes)); }
+        alignas(T) unsigned char m_bytes[N * sizeof(T)];
+    };
+
     template <typename T>
-    class vector {
+    struct vector_inline_storage<T, 0> {
+        T* data() { return nullptr; }
+    };
+
+
+    template <typename T, size_t N = 0, typename Growth = geometric_growth<>>
+    class basic_vector : private vector_inline_storage<T, N> {
         /*
+        ** Dynamic array over raw storage: slots past size() are uninitialized, and
+        ** elements are constructed in place. Growing relocates elements with one
+        ** memcpy when T is trivially copyable, else by move construction (copy if
+        ** the move may throw, so a failed growth leaves the vector untouched).
+        ** With N > 0 the first N elements live inside the object, and the heap is
+        ** only used past that (small_vector). Moving a small vector moves its
+        ** elements one by one.
         ** TODO: Need iterator, const_iterator and reverse iterator classes.
          */
 
+        // Moving the inline elements of a small vector may throw.
+        static constexpr bool nothrow_relocate = N == 0 || std::is_nothrow_move_constructible<T>::value;
+
         public:
             // Use pointer as iterator
             using iterator = T*;
-            using const_iterator = const T*; 
+            using const_iterator = const T*;
 
             // Constructors and destructor
-            vector() : m_size{0}, m_capacity{0}, m_buffer{nullptr} {}
-            explicit vector(size_t n) : m_size{n}, m_capacity{n}, m_buffer{new T[n]} {}
-            explicit vector(size_t n, const T& init_val)
-                : m_size{n}, m_capacity{n}, m_buffer{new T[n]} {
-                for (size_t i = 0; i < n; ++i)
-                    m_buffer[i] = init_val;
+            basic_vector() : m_size{0}, m_capacity{N}, m_buffer{inline_data()} {}
+            explicit basic_vector(size_t n) : basic_vector() {
+                reserve(n);
+                std::uninitialized_value_construct_n(m_buffer, n);
+                m_size = n;
+            }
+            explicit basic_vector(size_t n, const T& init_val) : basic_vector() {
+                reserve(n);
+                std::uninitialized_fill_n(m_buffer, n, init_val);
+                m_size = n;
+            }
+            ~basic_vector() {
+                std::destroy_n(m_buffer, m_size);
+                free_storage();
             }
-            ~vector() { delete[] m_buffer; }
 
             // Copy constructor, move constructor, and copy and move assignment operators
-            friend void swap(vector<T>& va, vector<T>& vb) noexcept {
-                std::swap(va.m_buffer, vb.m_buffer);
-                std::swap(va.m_size, vb.m_size);
-                std::swap(va.m_capacity, vb.m_capacity);
+            friend void swap(basic_vector& va, basic_vector& vb) noexcept(nothrow_relocate) {
+                if (!va.is_inline() && !vb.is_inline()) {
+                    std::swap(va.m_buffer, vb.m_buffer);
+                    std::swap(va.m_size, vb.m_size);
+                    std::swap(va.m_capacity, vb.m_capacity);
+                    return;
+                }
+                basic_vector tmp(std::move(va));
+                va.steal(vb);
+                vb.steal(tmp);
             }
-            vector(const vector<T>& v)
-                : m_size{v.m_size}, m_capacity{v.m_capacity}, m_buffer{new T[v.m_size]} {
-                std::memcpy(m_buffer, v.m_buffer, v.m_size * sizeof(T));
+            basic_vector(const basic_vector& v) : basic_vector() {
+                reserve(v.m_size);
+                std::uninitialized_copy_n(v.m_buffer, v.m_size, m_buffer);
+                m_size = v.m_size;
             }
-            vector(vector<T>&& v) noexcept : vector<T>() { swap(*this, v); }
-            vector<T>& operator=(vector<T> v) { swap(*this, v); return *this; }
+            basic_vector(basic_vector&& v) noexcept(nothrow_relocate) : basic_vector() { steal(v); }
+            basic_vector& operator=(basic_vector v) { swap(*this, v); return *this; }
 
             // Iterators
             iterator begin() { return m_buffer; }
@@ -54,75 +121,252 @@ namespace ADT {
             size_t size() const { return m_size; }
             size_t capacity() const { return m_capacity; }
             bool empty() const { return m_size == 0; }
-            void reserve(size_t capacity);
+            // Allocate exactly capacity slots, if more than now.
+            void reserve(size_t capacity) {
+                if (capacity > m_capacity)
+                    reallocate(capacity);
+            }
             void resize(size_t n, const T& val = T());
+            void shrink_to_fit();
 
             // Element access
             T& operator[](size_t index) { return m_buffer[index]; }
+            const T& operator[](size_t index) const { return m_buffer[index]; }
             T& front() { return m_buffer[0]; }
+            const T& front() const { return m_buffer[0]; }
             T& back() { return m_buffer[m_size - 1]; }
+            const T& back() const { return m_buffer[m_size - 1]; }
+            T* data() { return m_buffer; }
+            const T* data() const { return m_buffer; }
 
             // Modifiers
-            void push_back(const T& val);
+            void push_back(const T& val) { emplace_back(val); }
+            void push_back(T&& val) { emplace_back(std::move(val)); }
+            template <typename... Args> T& emplace_back(Args&&... args);
+            template <typename... Args> iterator emplace(const_iterator pos, Args&&... args);
+            iterator insert(const_iterator pos, const T& val) { return emplace(pos, val); }
+            iterator insert(const_iterator pos, T&& val) { return emplace(pos, std::move(val)); }
+            // [first, last) must not point into this vector.
+            template <typename InputIt> iterator insert(const_iterator pos, InputIt first, InputIt last);
+            iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+            iterator erase(const_iterator first, const_iterator last);
             void pop_back();
+            // Destroy all elements, keep the storage.
             void clear();
 
         private:
+            T* inline_data() { return vector_inline_storage<T, N>::data(); }
+            bool is_inline() { return N > 0 && m_buffer == inline_data(); }
+            void free_storage() {
+                if (m_buffer && !is_inline())
+                    std::allocator<T>().deallocate(m_buffer, m_capacity);
+            }
+            void grow(size_t required) {
+                reallocate(Growth::next_capacity(m_capacity, required));
+            }
+            static void relocate(T* src, size_t n, T* dst);
+            void reallocate(size_t capacity);
+            void steal(basic_vector& v);
+
             size_t m_size;
             size_t m_capacity;
             T* m_buffer;
     };
 
-    template <typename T>
-    void vector<T>::reserve(size_t capacity) {
-        // Resize the storage
-        if (capacity > m_capacity) {
-            size_t new_capacity = capacity + (capacity >> 3) + (capacity < 9 ? 3 : 6);  // CPython list resize strategy
-            T* new_array = new T[new_capacity];
-            std::memcpy(new_array, m_buffer, m_size * sizeof(T));
-            delete[] m_buffer;
-            m_buffer = new_array;
-            m_capacity = new_capacity;
+
+    template <typename T, typename Growth = geometric_growth<>>
+    using vector = basic_vector<T, 0, Growth>;
+
+    template <typename T, size_t N = 8, typename Growth = geometric_growth<>>
+    using small_vector = basic_vector<T, N, Growth>;
+
+
+#define BASIC_VECTOR_TEMPLATE template <typename T, size_t N, typename Growth>
+#define BASIC_VECTOR basic_vector<T, N, Growth>
+
+    BASIC_VECTOR_TEMPLATE
+    void BASIC_VECTOR::relocate(T* src, size_t n, T* dst) {
+        // Move n elements from src to uninitialized dst, and end their lifetime at src.
+        // If this throws, src is unchanged and dst holds no elements.
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            if (n)
+                std::memcpy(static_cast<void*>(dst), static_cast<const void*>(src), n * sizeof(T));
+        }
+        else {
+            size_t i = 0;
+            try {
+                for (; i < n; ++i)
+                    new (dst + i) T(std::move_if_noexcept(src[i]));
+            }
+            catch (...) {
+                std::destroy_n(dst, i);
+                throw;
+            }
+            std::destroy_n(src, n);
         }
     }
 
-    template <typename T>
-    void vector<T>::resize(size_t n, const T& val) {
+    BASIC_VECTOR_TEMPLATE
+    void BASIC_VECTOR::reallocate(size_t capacity) {
+        // Move the elements to a new heap buffer of exactly capacity slots.
+        T* new_array = std::allocator<T>().allocate(capacity);
+        try {
+            relocate(m_buffer, m_size, new_array);
+        }
+        catch (...) {
+            std::allocator<T>().deallocate(new_array, capacity);
+            throw;
+        }
+        free_storage();
+        m_buffer = new_array;
+        m_capacity = capacity;
+    }
+
+    BASIC_VECTOR_TEMPLATE
+    void BASIC_VECTOR::steal(basic_vector& v) {
+        // Take the elements of v, which is left empty. *this must be empty and
+        // on its inline storage.
+        if (v.is_inline()) {
+            relocate(v.m_buffer, v.m_size, m_buffer);
+            m_size = v.m_size;
+            v.m_size = 0;
+            return;
+        }
+        m_buffer = v.m_buffer;
+        m_size = v.m_size;
+        m_capacity = v.m_capacity;
+        v.m_buffer = v.inline_data();
+        v.m_size = 0;
+        v.m_capacity = N;
+    }
+
+    BASIC_VECTOR_TEMPLATE
+    void BASIC_VECTOR::shrink_to_fit() {
+        if (is_inline() || m_capacity == m_size)
+            return;
+        if (m_size > N) {
+            reallocate(m_size);
+            return;
+        }
+        // Back to the inline storage, or to no storage at all.
+        T* heap = m_buffer;
+        relocate(heap, m_size, inline_data());
+        std::allocator<T>().deallocate(heap, m_capacity);
+        m_buffer = inline_data();
+        m_capacity = N;
+    }
+
+    BASIC_VECTOR_TEMPLATE
+    void BASIC_VECTOR::resize(size_t n, const T& val) {
         // Resize the array with the same strategy as std::vector::resize().
-        if (n > m_capacity)
-            reserve(n);
         if (n < m_size) {  // shrink array
-            for (size_t i = n; i < m_size; ++i)
-                (m_buffer + i) -> ~T();
+            std::destroy(m_buffer + n, m_buffer + m_size);
+            m_size = n;
+            return;
         }
-        else {  // expand array
-            for (size_t i = m_size; i < n; ++i)
-                m_buffer[i] = val;
+        if (n > m_capacity) {  // val may be an element
+            T tmp(val);
+            grow(n);
+            std::uninitialized_fill(m_buffer + m_size, m_buffer + n, tmp);
         }
+        else  // expand array
+            std::uninitialized_fill(m_buffer + m_size, m_buffer + n, val);
         m_size = n;
     }
 
-    template <typename T>
-    void vector<T>::push_back(const T& val) {
-        if (m_size == m_capacity)
-            reserve(m_capacity + 1);
-        m_buffer[m_size++] = val;
+    BASIC_VECTOR_TEMPLATE
+    template <typename... Args>
+    T& BASIC_VECTOR::emplace_back(Args&&... args) {
+        if (m_size < m_capacity) {
+            new (m_buffer + m_size) T(std::forward<Args>(args)...);
+            return m_buffer[m_size++];
+        }
+        // Construct the new element before relocating, as args may refer to an element.
+        size_t capacity = Growth::next_capacity(m_capacity, m_size + 1);
+        T* new_array = std::allocator<T>().allocate(capacity);
+        try {
+            new (new_array + m_size) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            std::allocator<T>().deallocate(new_array, capacity);
+            throw;
+        }
+        try {
+            relocate(m_buffer, m_size, new_array);
+        }
+        catch (...) {
+            new_array[m_size].~T();
+            std::allocator<T>().deallocate(new_array, capacity);
+            throw;
+        }
+        free_storage();
+        m_buffer = new_array;
+        m_capacity = capacity;
+        return m_buffer[m_size++];
     }
 
-    template <typename T>
-    void vector<T>::pop_back() {
+    BASIC_VECTOR_TEMPLATE
+    template <typename... Args>
+    typename BASIC_VECTOR::iterator BASIC_VECTOR::emplace(const_iterator pos, Args&&... args) {
+        size_t idx = pos - m_buffer;
+        if (idx == m_size) {
+            emplace_back(std::forward<Args>(args)...);
+            return m_buffer + idx;
+        }
+        T tmp(std::forward<Args>(args)...);  // args may refer to an element
+        emplace_back(std::move(back()));
+        std::move_backward(m_buffer + idx, m_buffer + m_size - 2, m_buffer + m_size - 1);
+        m_buffer[idx] = std::move(tmp);
+        return m_buffer + idx;
+    }
+
+    BASIC_VECTOR_TEMPLATE
+    template <typename InputIt>
+    typename BASIC_VECTOR::iterator BASIC_VECTOR::insert(const_iterator pos, InputIt first, InputIt last) {
+        // Append the new elements, then rotate them into place.
+        size_t idx = pos - m_buffer;
+        size_t old_size = m_size;
+        using category = typename std::iterator_traits<InputIt>::iterator_category;
+        if constexpr (std::is_base_of<std::forward_iterator_tag, category>::value) {
+            size_t n = std::distance(first, last);
+            if (m_size + n > m_capacity)
+                grow(m_size + n);
+            std::uninitialized_copy(first, last, m_buffer + m_size);
+            m_size += n;
+        }
+        else {
+            for (; first != last; ++first)
+                emplace_back(*first);
+        }
+        std::rotate(m_buffer + idx, m_buffer + old_size, m_buffer + m_size);
+        return m_buffer + idx;
+    }
+
+    BASIC_VECTOR_TEMPLATE
+    typename BASIC_VECTOR::iterator BASIC_VECTOR::erase(const_iterator first, const_iterator last) {
+        T* f = m_buffer + (first - m_buffer);
+        T* l = m_buffer + (last - m_buffer);
+        if (f != l) {
+            T* new_end = std::move(l, end(), f);
+            std::destroy(new_end, end());
+            m_size = new_end - m_buffer;
+        }
+        return f;
+    }
+
+    BASIC_VECTOR_TEMPLATE
+    void BASIC_VECTOR::pop_back() {
         m_buffer[--m_size].~T();
     }
 
-    template <typename T>
-    void vector<T>::clear() {
-        delete[] m_buffer;
-        m_buffer = nullptr;
-        m_size = m_capacity = 0;
+    BASIC_VECTOR_TEMPLATE
+    void BASIC_VECTOR::clear() {
+        std::destroy_n(m_buffer, m_size);
+        m_size = 0;
     }
 
-    template <typename T>
-    std::ostream& operator<<(std::ostream& os, const vector<T>& v) {
+    BASIC_VECTOR_TEMPLATE
+    std::ostream& operator<<(std::ostream& os, const BASIC_VECTOR& v) {
         os << '[';
         for (auto p = v.begin(); p != v.end(); ++p) {
             os << *p;
@@ -131,7 +375,10 @@ namespace ADT {
         }
         return os << ']';
     }
-            
+
+#undef BASIC_VECTOR
+#undef BASIC_VECTOR_TEMPLATE
+
 
 }  // end of namespace ADT
 